@@ -0,0 +1,93 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <qtum/callstate.h>
+#include <qtum/qtumDGP.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <util/convert.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Stores 42 in slot 0 and deploys code that returns the value of slot 0
+static const char* STORAGE_READER_CODE = "602a600055600b6011600039600b6000f3" "60005460005260206000f3";
+
+static constexpr int CALLS_PER_THREAD = 50;
+
+// Executes read-only contract calls from num_threads threads at once, the way
+// callcontract does when served by that many -rpcthreads.
+static void ContractCall(benchmark::Bench& bench, int num_threads)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    ChainstateManager& chainman = *testing_setup->m_node.chainman;
+
+    dev::Address contract;
+    CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainman.ActiveChain().Tip();
+
+        CBlock block;
+        CMutableTransaction coinbase;
+        coinbase.vout.emplace_back(0, CScript() << OP_DUP << OP_HASH160 << ParseHex("abababababababababababababababababababab") << OP_EQUALVERIFY << OP_CHECKSIG);
+        block.vtx.push_back(MakeTransactionRef(CTransaction(coinbase)));
+
+        const dev::h256 hashTx(ParseHex("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+        QtumTransaction create(0, 1, 500000, ParseHex(STORAGE_READER_CODE), 0);
+        create.forceSender(dev::Address("0101010101010101010101010101010101010101"));
+        create.setHashWith(hashTx);
+        create.setNVout(0);
+        create.setVersion(VersionVM::GetEVMDefault());
+
+        QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
+        ByteCodeExec exec(block, {create}, qtumDGP.getBlockGasLimit(tip->nHeight + 1), tip, chainman.ActiveChain());
+        exec.performByteCode();
+        globalState->db().commit();
+        globalState->dbUtxo().commit();
+        contract = QtumState::createQtumAddress(hashTx, 0);
+
+        // Point the tip at the state the contract was deployed into
+        tip->hashStateRoot = h256Touint(globalState->rootHash());
+        tip->hashUTXORoot = h256Touint(globalState->rootHashUTXO());
+    }
+
+    auto call = [&] {
+        std::unique_ptr<CallStatePool::Lease> lease;
+        {
+            LOCK(cs_main);
+            lease = pcallstatepool->acquire(tip);
+        }
+        std::vector<ResultExecute> results = CallContract(contract, {}, chainman.ActiveChainstate(), lease->block());
+        assert(results.size() == 1 && results[0].execRes.output.size() == 32 && results[0].execRes.output.back() == 42);
+    };
+
+    bench.batch(num_threads * CALLS_PER_THREAD).unit("call").run([&] {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&] {
+                for (int j = 0; j < CALLS_PER_THREAD; ++j) {
+                    call();
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    });
+}
+
+static void ContractCall1Thread(benchmark::Bench& bench) { ContractCall(bench, 1); }
+static void ContractCall4Threads(benchmark::Bench& bench) { ContractCall(bench, 4); }
+static void ContractCall16Threads(benchmark::Bench& bench) { ContractCall(bench, 16); }
+
+BENCHMARK(ContractCall1Thread, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractCall4Threads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractCall16Threads, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,58 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <common/args.h>
+#include <random.h>
+#include <streams.h>
+#include <validators/delegation.h>
+
+#include <map>
+
+using namespace validators;
+
+static constexpr int NUM_DELEGATORS{100000};
+
+// Credits one block to a validator with NUM_DELEGATORS active delegations,
+// then reads and claims the pending rewards of a single delegator.
+static void DelegationRewardAccrual(benchmark::Bench& bench)
+{
+    ArgsManager bench_args;
+    const auto chain_params = CreateChainParams(bench_args, ChainType::REGTEST);
+    DelegationDB db(chain_params->GetConsensus());
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const CKeyID validator{uint160{rng.randbytes(20)}};
+
+    std::map<uint256, DelegationEntry> delegations;
+    std::map<CKeyID, ValidatorRewardPool> pools;
+    CKeyID delegator;
+    for (int i = 0; i < NUM_DELEGATORS; ++i) {
+        DelegationEntry entry;
+        entry.delegatorId = CKeyID{uint160{rng.randbytes(20)}};
+        entry.validatorId = validator;
+        entry.amount = MIN_DELEGATION_AMOUNT + rng.randrange(MIN_DELEGATION_AMOUNT);
+        entry.delegationHeight = i;
+        entry.status = DelegationStatus::ACTIVE;
+        pools[validator].totalActive += entry.amount;
+        delegations.emplace(entry.GetDelegationId(), entry);
+        delegator = entry.delegatorId;
+    }
+    DataStream ss{};
+    ss << delegations << pools;
+    db.Unserialize(ss);
+
+    RewardClaimRequest claim;
+    claim.delegatorId = delegator;
+    claim.validatorId = validator;
+
+    bench.run([&] {
+        db.DistributeBlockReward(validator, 5 * COIN);
+        ankerl::nanobench::doNotOptimizeAway(db.GetPendingRewardsForDelegator(delegator));
+        ankerl::nanobench::doNotOptimizeAway(db.ProcessRewardClaim(claim));
+    });
+}
+
+BENCHMARK(DelegationRewardAccrual, benchmark::PriorityLevel::HIGH);
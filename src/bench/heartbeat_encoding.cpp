@@ -0,0 +1,86 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <netbase.h>
+#include <random.h>
+#include <streams.h>
+#include <trust/heartbeat_net.h>
+
+static constexpr int NUM_VALIDATORS{1000};
+
+// A VALIDATORS message worth of active validators with known addresses.
+static trust::ValidatorList MakeValidatorList()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    trust::ValidatorList list;
+    for (int i = 0; i < NUM_VALIDATORS; ++i) {
+        trust::ValidatorInfo info;
+        info.validatorId = CKeyID{uint160{rng.randbytes(20)}};
+        info.stakeAmount = 100000 * COIN + rng.randrange(1000 * COIN);
+        info.poolFeeRate = rng.randrange(10000);
+        info.registrationHeight = rng.randrange(1000000);
+        info.lastHeartbeatHeight = info.registrationHeight + rng.randrange(100000);
+        info.heartbeatsExpected = rng.randrange(5000);
+        info.heartbeatsReceived = info.heartbeatsExpected;
+        info.isActive = true;
+        info.lastKnownAddress = LookupNumeric(strprintf("10.%d.%d.%d", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff), 18888);
+        info.lastCheckInTime = 1700000000 + i;
+        list.validators.push_back(info);
+    }
+    return list;
+}
+
+// Each benchmark reports its encoded size in bytes as the batch, so the
+// per-byte figures and the total sizes can be compared across formats.
+static void ValidatorListEncodeLegacy(benchmark::Bench& bench)
+{
+    const trust::ValidatorList list{MakeValidatorList()};
+    DataStream stream{};
+    stream << list;
+    bench.batch(stream.size()).unit("byte").run([&] {
+        stream.clear();
+        stream << list;
+    });
+}
+
+static void ValidatorListEncodeCompact(benchmark::Bench& bench)
+{
+    const trust::ValidatorList list{MakeValidatorList()};
+    DataStream stream{};
+    stream << Using<trust::CompactValidatorListFormatter>(list);
+    bench.batch(stream.size()).unit("byte").run([&] {
+        stream.clear();
+        stream << Using<trust::CompactValidatorListFormatter>(list);
+    });
+}
+
+static void ValidatorListDecodeLegacy(benchmark::Bench& bench)
+{
+    DataStream encoded{};
+    encoded << MakeValidatorList();
+    bench.batch(encoded.size()).unit("byte").run([&] {
+        DataStream stream{encoded};
+        trust::ValidatorList list;
+        stream >> list;
+        assert(list.validators.size() == NUM_VALIDATORS);
+    });
+}
+
+static void ValidatorListDecodeCompact(benchmark::Bench& bench)
+{
+    DataStream encoded{};
+    encoded << Using<trust::CompactValidatorListFormatter>(MakeValidatorList());
+    bench.batch(encoded.size()).unit("byte").run([&] {
+        DataStream stream{encoded};
+        trust::ValidatorList list;
+        stream >> Using<trust::CompactValidatorListFormatter>(list);
+        assert(list.validators.size() == NUM_VALIDATORS);
+    });
+}
+
+BENCHMARK(ValidatorListEncodeLegacy, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ValidatorListEncodeCompact, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ValidatorListDecodeLegacy, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ValidatorListDecodeCompact, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,58 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <common/args.h>
+#include <common/system.h>
+#include <key.h>
+#include <trust/heartbeat_net.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// Verifies and applies one heartbeat from each of num_validators validators
+// through the batched heartbeat pipeline.
+static void HeartbeatBatchVerify(benchmark::Bench& bench, int num_validators)
+{
+    ECC_Context ecc_context{};
+    ArgsManager bench_args;
+    const auto chain_params = CreateChainParams(bench_args, ChainType::REGTEST);
+    Consensus::Params params{chain_params->GetConsensus()};
+    params.nMinValidatorStake = 1;
+
+    std::vector<CKeyID> ids;
+    std::vector<trust::Heartbeat> heartbeats;
+    for (int i = 0; i < num_validators; ++i) {
+        CKey key{GenerateRandomKey()};
+        trust::Heartbeat hb;
+        hb.validatorId = key.GetPubKey().GetID();
+        hb.blockHeight = params.nHeartbeatInterval;
+        hb.timestamp = i;
+        hb.Sign(key);
+        ids.push_back(hb.validatorId);
+        heartbeats.push_back(hb);
+    }
+
+    int worker_threads_num{std::max(GetNumCores() - 1, 0)};
+
+    bench.batch(num_validators).unit("heartbeat").run([&] {
+        trust::TrustScoreManager trustManager(params);
+        for (const CKeyID& id : ids) {
+            trustManager.RegisterValidator(id, 1, 0, 0);
+        }
+        trust::HeartbeatManager manager(trustManager, params, worker_threads_num);
+        for (const trust::Heartbeat& hb : heartbeats) {
+            manager.QueueHeartbeat(hb, /*from=*/0);
+        }
+        assert(manager.ProcessPendingHeartbeats() == heartbeats.size());
+    });
+}
+
+static void HeartbeatBatchVerify1k(benchmark::Bench& bench) { HeartbeatBatchVerify(bench, 1000); }
+static void HeartbeatBatchVerify10k(benchmark::Bench& bench) { HeartbeatBatchVerify(bench, 10000); }
+
+BENCHMARK(HeartbeatBatchVerify1k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(HeartbeatBatchVerify10k, benchmark::PriorityLevel::HIGH);
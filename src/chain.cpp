@@ -4,10 +4,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chain.h>
+#include <logging.h>
 #include <tinyformat.h>
 #include <util/time.h>
 #include <pubkey.h>
 
+#include <list>
+#include <map>
+#include <stdexcept>
+
 std::string CBlockFileInfo::ToString() const
 {
     return strprintf("CBlockFileInfo(blocks=%u, size=%u, heights=%u...%u, time=%s...%s)", nBlocks, nSize, nHeightFirst, nHeightLast, FormatISO8601Date(nTimeFirst), FormatISO8601Date(nTimeLast));
@@ -180,8 +185,130 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     return pa;
 }
 
+static GlobalMutex g_cold_loader_mutex;
+static const void* g_cold_loader_owner GUARDED_BY(g_cold_loader_mutex){nullptr};
+static BlockIndexColdLoader g_cold_loader GUARDED_BY(g_cold_loader_mutex);
+
+/** Least recently used cold data read back through the loader, most recent first */
+static GlobalMutex g_cold_cache_mutex;
+static std::list<std::pair<uint256, std::shared_ptr<const BlockIndexColdData>>> g_cold_cache GUARDED_BY(g_cold_cache_mutex);
+static std::map<uint256, decltype(g_cold_cache)::iterator> g_cold_cache_index GUARDED_BY(g_cold_cache_mutex);
+
+static std::shared_ptr<const BlockIndexColdData> GetCachedColdData(const uint256& hash)
+{
+    LOCK(g_cold_cache_mutex);
+    auto it = g_cold_cache_index.find(hash);
+    if (it == g_cold_cache_index.end()) return nullptr;
+    g_cold_cache.splice(g_cold_cache.begin(), g_cold_cache, it->second);
+    return it->second->second;
+}
+
+static void CacheColdData(const uint256& hash, std::shared_ptr<const BlockIndexColdData> data)
+{
+    LOCK(g_cold_cache_mutex);
+    auto [it, inserted] = g_cold_cache_index.try_emplace(hash);
+    if (!inserted) {
+        g_cold_cache.erase(it->second);
+    }
+    g_cold_cache.emplace_front(hash, std::move(data));
+    it->second = g_cold_cache.begin();
+    if (g_cold_cache.size() > BLOCK_INDEX_COLD_CACHE_ENTRIES) {
+        g_cold_cache_index.erase(g_cold_cache.back().first);
+        g_cold_cache.pop_back();
+    }
+}
+
+static void UncacheColdData(const uint256& hash)
+{
+    LOCK(g_cold_cache_mutex);
+    auto it = g_cold_cache_index.find(hash);
+    if (it == g_cold_cache_index.end()) return;
+    g_cold_cache.erase(it->second);
+    g_cold_cache_index.erase(it);
+}
+
+static void ClearColdCache()
+{
+    LOCK(g_cold_cache_mutex);
+    g_cold_cache.clear();
+    g_cold_cache_index.clear();
+}
+
+void SetBlockIndexColdLoader(const void* owner, BlockIndexColdLoader loader)
+{
+    LOCK(g_cold_loader_mutex);
+    g_cold_loader_owner = owner;
+    g_cold_loader = std::move(loader);
+    ClearColdCache();
+}
+
+void ResetBlockIndexColdLoader(const void* owner)
+{
+    LOCK(g_cold_loader_mutex);
+    if (g_cold_loader_owner == owner) {
+        g_cold_loader_owner = nullptr;
+        g_cold_loader = nullptr;
+        ClearColdCache();
+    }
+}
+
+std::shared_ptr<const BlockIndexColdData> CBlockIndex::GetColdData() const
+{
+    std::shared_ptr<const BlockIndexColdData> cold = std::atomic_load(&m_cold_data);
+    if (cold) return cold;
+
+    // Released data is read back on access and only kept in a bounded cache,
+    // so blocks deep in the chain never grow the index again
+    BlockIndexColdLoader loader = WITH_LOCK(g_cold_loader_mutex, return g_cold_loader);
+    if (!phashBlock || !loader) {
+        // Not backed by a block tree DB, there is nothing to read back
+        return std::make_shared<const BlockIndexColdData>();
+    }
+
+    cold = GetCachedColdData(*phashBlock);
+    if (cold) return cold;
+
+    auto data = std::make_shared<BlockIndexColdData>();
+    if (!loader(*this, *data)) {
+        // Empty data would be written back by CDiskBlockIndex and corrupt the entry
+        LogError("%s: failed to read the cold data of block %s\n", __func__, GetBlockHash().ToString());
+        throw std::runtime_error(strprintf("%s: failed to read the cold data of block %s", __func__, GetBlockHash().ToString()));
+    }
+    cold = std::move(data);
+    CacheColdData(*phashBlock, cold);
+    return cold;
+}
+
+void CBlockIndex::SetColdData(std::vector<unsigned char> vchBlockSigDlgt, const uint256& hashProof)
+{
+    auto data = std::make_shared<BlockIndexColdData>();
+    data->vchBlockSigDlgt = std::move(vchBlockSigDlgt);
+    data->hashProof = hashProof;
+    nBlockSigSize = data->vchBlockSigDlgt.size();
+    std::atomic_store(&m_cold_data, std::shared_ptr<const BlockIndexColdData>(std::move(data)));
+    if (phashBlock) UncacheColdData(*phashBlock);
+}
+
+void CBlockIndex::ReleaseColdData()
+{
+    AssertLockHeld(::cs_main);
+    std::atomic_store(&m_cold_data, std::shared_ptr<const BlockIndexColdData>());
+}
+
+bool CBlockIndex::HasColdData() const
+{
+    return std::atomic_load(&m_cold_data) != nullptr;
+}
+
+void CBlockIndex::SetHashProof(const uint256& hashProof)
+{
+    SetColdData(GetColdData()->vchBlockSigDlgt, hashProof);
+}
+
 std::vector<unsigned char> CBlockIndex::GetBlockSignature() const
 {
+    std::shared_ptr<const BlockIndexColdData> cold = GetColdData();
+    const std::vector<unsigned char>& vchBlockSigDlgt = cold->vchBlockSigDlgt;
     if(vchBlockSigDlgt.size() < 2 * CPubKey::COMPACT_SIGNATURE_SIZE)
     {
         return vchBlockSigDlgt;
@@ -192,6 +319,13 @@ std::vector<unsigned char> CBlockIndex::GetBlockSignature() const
 
 std::vector<unsigned char> CBlockIndex::GetProofOfDelegation() const
 {
+    if(!HasProofOfDelegation())
+    {
+        return std::vector<unsigned char>();
+    }
+
+    std::shared_ptr<const BlockIndexColdData> cold = GetColdData();
+    const std::vector<unsigned char>& vchBlockSigDlgt = cold->vchBlockSigDlgt;
     if(vchBlockSigDlgt.size() < 2 * CPubKey::COMPACT_SIGNATURE_SIZE)
     {
         return std::vector<unsigned char>();
@@ -203,5 +337,5 @@ std::vector<unsigned char> CBlockIndex::GetProofOfDelegation() const
 
 bool CBlockIndex::HasProofOfDelegation() const
 {
-    return vchBlockSigDlgt.size() >= 2 * CPubKey::COMPACT_SIGNATURE_SIZE;
+    return nBlockSigSize >= 2 * CPubKey::COMPACT_SIGNATURE_SIZE;
 }
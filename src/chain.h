@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -132,6 +134,22 @@ enum BlockStatus : uint32_t {
                                       //!< ancestors before they were validated, and unset when they were validated.
 };
 
+/** Depth in the active chain below which a block index releases its cold data. */
+static constexpr int BLOCK_INDEX_COLD_DEPTH{5000};
+/** Released cold data read back from the block tree DB that is kept for reuse. */
+static constexpr size_t BLOCK_INDEX_COLD_CACHE_ENTRIES{10000};
+
+/** Fields of a block index that are only needed to rebuild the full header or
+ * for RPC. They are dropped from memory for blocks deep in the active chain and
+ * read back from the block tree DB on demand, see CBlockIndex::GetColdData.
+ */
+struct BlockIndexColdData
+{
+    // block signature - proof-of-stake protect the block by signing the block using a stake holder private key
+    std::vector<unsigned char> vchBlockSigDlgt{};
+    uint256 hashProof{}; // qtum
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -194,14 +212,14 @@ public:
     uint32_t nNonce{0};
     uint256 hashStateRoot{}; // qtum
     uint256 hashUTXORoot{}; // qtum
-    // block signature - proof-of-stake protect the block by signing the block using a stake holder private key
-    std::vector<unsigned char> vchBlockSigDlgt{};
     uint256 nStakeModifier{};
     // proof-of-stake specific fields
     COutPoint prevoutStake{};
-    uint256 hashProof{}; // qtum
     uint64_t nMoneySupply{0};
 
+    //! Size of the block signature, kept inline so HasProofOfDelegation never reads the cold data
+    uint32_t nBlockSigSize{0};
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId{0};
 
@@ -216,9 +234,9 @@ public:
           nNonce{block.nNonce},
           hashStateRoot{block.hashStateRoot},
           hashUTXORoot{block.hashUTXORoot},
-          vchBlockSigDlgt{block.vchBlockSigDlgt},
           prevoutStake{block.prevoutStake}
     {
+        SetColdData(block.vchBlockSigDlgt, uint256());
     }
 
     FlatFilePos GetBlockPos() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
@@ -255,11 +273,26 @@ public:
         block.nNonce = nNonce;
         block.hashStateRoot = hashStateRoot; // qtum
         block.hashUTXORoot = hashUTXORoot; // qtum
-        block.vchBlockSigDlgt = vchBlockSigDlgt;
+        block.vchBlockSigDlgt = GetColdData()->vchBlockSigDlgt;
         block.prevoutStake = prevoutStake;
         return block;
     }
 
+    //! Signature and proof hash of the block, read from the block tree DB if they were released
+    std::shared_ptr<const BlockIndexColdData> GetColdData() const;
+
+    //! Keep the signature and proof hash of the block in memory
+    void SetColdData(std::vector<unsigned char> vchBlockSigDlgt, const uint256& hashProof);
+
+    //! Drop the cold data from memory, the index must already be written to the block tree DB
+    void ReleaseColdData() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! Whether the cold data is currently held in memory
+    bool HasColdData() const;
+
+    uint256 GetHashProof() const { return GetColdData()->hashProof; }
+    void SetHashProof(const uint256& hashProof);
+
     uint256 GetBlockHash() const
     {
         assert(phashBlock != nullptr);
@@ -377,6 +410,10 @@ protected:
     CBlockIndex& operator=(const CBlockIndex&) = delete;
     CBlockIndex(CBlockIndex&&) = delete;
     CBlockIndex& operator=(CBlockIndex&&) = delete;
+
+private:
+    //! Signature and proof hash, null once released. Accessed with the atomic shared_ptr functions.
+    std::shared_ptr<const BlockIndexColdData> m_cold_data;
 };
 
 arith_uint256 GetBlockProof(const CBlockIndex& block);
@@ -385,6 +422,13 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
 /** Find the forking point between two chain tips. */
 const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex* pb);
 
+/** Reads the cold data of a block index back from the block tree DB, false if it cannot be read. */
+using BlockIndexColdLoader = std::function<bool(const CBlockIndex&, BlockIndexColdData&)>;
+/** Set the loader used for block indexes that released their cold data, owner identifies who installed it. */
+void SetBlockIndexColdLoader(const void* owner, BlockIndexColdLoader loader);
+/** Remove the loader if it was installed by owner. */
+void ResetBlockIndexColdLoader(const void* owner);
+
 
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex
@@ -399,6 +443,8 @@ class CDiskBlockIndex : public CBlockIndex
 
 public:
     uint256 hashPrev;
+    std::vector<unsigned char> vchBlockSigDlgt; // qtum
+    uint256 hashProof; // qtum
 
     CDiskBlockIndex()
     {
@@ -408,11 +454,22 @@ public:
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex)
     {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        std::shared_ptr<const BlockIndexColdData> cold = pindex->GetColdData();
+        vchBlockSigDlgt = cold->vchBlockSigDlgt;
+        hashProof = cold->hashProof;
     }
 
     SERIALIZE_METHODS(CDiskBlockIndex, obj)
     {
-        LOCK(::cs_main);
+        SerializeFields(obj, s, ser_action);
+    }
+
+    //! A CDiskBlockIndex is a private copy of an index, so its fields are
+    //! accessed without cs_main. This lets the block tree DB be parsed by
+    //! several threads while the loading thread holds cs_main.
+    template <typename Stream, typename Type, typename Operation>
+    static void SerializeFields(Type& obj, Stream& s, Operation ser_action) NO_THREAD_SAFETY_ANALYSIS
+    {
         int _nVersion = DUMMY_VERSION;
         READWRITE(VARINT_MODE(_nVersion, VarIntMode::NONNEGATIVE_SIGNED));
 
@@ -396,6 +396,50 @@ CDBIterator* CDBWrapper::NewIterator()
     return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions))};
 }
 
+struct CDBSnapshot::SnapshotImpl {
+    leveldb::DB* const pdb;
+    const leveldb::Snapshot* const snapshot;
+    leveldb::ReadOptions readoptions;
+    leveldb::ReadOptions iteroptions;
+
+    SnapshotImpl(leveldb::DB* _pdb, const LevelDBContext& context) : pdb{_pdb}, snapshot{_pdb->GetSnapshot()},
+                                                                      readoptions{context.readoptions}, iteroptions{context.iteroptions}
+    {
+        readoptions.snapshot = snapshot;
+        iteroptions.snapshot = snapshot;
+    }
+    ~SnapshotImpl() { pdb->ReleaseSnapshot(snapshot); }
+};
+
+CDBSnapshot::CDBSnapshot(const CDBWrapper& _parent, std::unique_ptr<SnapshotImpl> _psnapshot) : parent(_parent),
+                                                                                                m_impl_snapshot(std::move(_psnapshot)) {}
+
+CDBSnapshot::~CDBSnapshot() = default;
+
+CDBSnapshot* CDBWrapper::NewSnapshot() const
+{
+    return new CDBSnapshot{*this, std::make_unique<CDBSnapshot::SnapshotImpl>(DBContext().pdb, DBContext())};
+}
+
+std::optional<std::string> CDBSnapshot::ReadImpl(Span<const std::byte> key) const
+{
+    leveldb::Slice slKey(CharCast(key.data()), key.size());
+    std::string strValue;
+    leveldb::Status status = m_impl_snapshot->pdb->Get(m_impl_snapshot->readoptions, slKey, &strValue);
+    if (!status.ok()) {
+        if (status.IsNotFound())
+            return std::nullopt;
+        LogPrintf("LevelDB read failure: %s\n", status.ToString());
+        HandleError(status);
+    }
+    return strValue;
+}
+
+CDBIterator* CDBSnapshot::NewIterator() const
+{
+    return new CDBIterator{parent, std::make_unique<CDBIterator::IteratorImpl>(m_impl_snapshot->pdb->NewIterator(m_impl_snapshot->iteroptions))};
+}
+
 void CDBIterator::SeekImpl(Span<const std::byte> key)
 {
     leveldb::Slice slKey(CharCast(key.data()), key.size());
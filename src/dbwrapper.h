@@ -177,11 +177,51 @@ public:
     }
 };
 
+/** Read-only view of a CDBWrapper as of the moment it was taken */
+class CDBSnapshot
+{
+public:
+    struct SnapshotImpl;
+
+private:
+    const CDBWrapper &parent;
+    const std::unique_ptr<SnapshotImpl> m_impl_snapshot;
+
+    std::optional<std::string> ReadImpl(Span<const std::byte> key) const;
+
+public:
+    CDBSnapshot(const CDBWrapper& _parent, std::unique_ptr<SnapshotImpl> _psnapshot);
+    ~CDBSnapshot();
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) const
+    {
+        DataStream ssKey{};
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        std::optional<std::string> strValue{ReadImpl(ssKey)};
+        if (!strValue) {
+            return false;
+        }
+        try {
+            DataStream ssValue{MakeByteSpan(*strValue)};
+            ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    CDBIterator* NewIterator() const;
+};
+
 struct LevelDBContext;
 
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBSnapshot;
 private:
     //! holds all leveldb-specific fields of this class
     std::unique_ptr<LevelDBContext> m_db_context;
@@ -278,6 +318,12 @@ public:
 
     CDBIterator* NewIterator();
 
+    /**
+     * Pin the current state of the database. Reads through the snapshot do
+     * not see later writes, so they need no lock shared with the writer.
+     */
+    CDBSnapshot* NewSnapshot() const;
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -16,6 +16,7 @@ namespace po = boost::program_options;
 
 auto g_kind = DatabaseKind::LevelDB;
 fs::path g_dbPath;
+size_t g_cacheSize = 0;
 
 /// A helper type to build the table of DB implementations.
 ///
@@ -60,6 +61,16 @@ void setDatabasePath(std::string const& _path)
     g_dbPath = fs::path(_path);
 }
 
+void setDatabaseCacheSize(size_t _bytes)
+{
+    g_cacheSize = _bytes;
+}
+
+size_t databaseCacheSize()
+{
+    return g_cacheSize;
+}
+
 bool isDiskDatabase()
 {
     switch (g_kind)
@@ -31,6 +31,9 @@ DatabaseKind databaseKind();
 void setDatabaseKindByName(std::string const& _name);
 void setDatabaseKind(DatabaseKind _kind);
 boost::filesystem::path databasePath();
+/// Memory in bytes each database opened from now on uses for caching and write buffering
+void setDatabaseCacheSize(size_t _bytes);
+size_t databaseCacheSize();
 
 class DBFactory
 {
@@ -3,6 +3,9 @@
 // Licensed under the GNU General Public License, Version 3.
 #include "LevelDB.h"
 #include "Assertions.h"
+#include "DBFactory.h"
+
+#include <leveldb/filter_policy.h>
 
 namespace dev
 {
@@ -83,6 +86,10 @@ leveldb::Options LevelDB::defaultDBOptions()
     leveldb::Options options;
     options.create_if_missing = true;
     options.max_open_files = 256;
+    // Most state lookups are for nodes that are not in a given table
+    static std::unique_ptr<leveldb::FilterPolicy const> const filterPolicy(
+        leveldb::NewBloomFilterPolicy(10));
+    options.filter_policy = filterPolicy.get();
     return options;
 }
 
@@ -90,6 +97,15 @@ LevelDB::LevelDB(boost::filesystem::path const& _path, leveldb::ReadOptions _rea
     leveldb::WriteOptions _writeOptions, leveldb::Options _dbOptions)
   : m_db(nullptr), m_readOptions(std::move(_readOptions)), m_writeOptions(std::move(_writeOptions))
 {
+    // Split the cache like the block and coins databases do
+    size_t const cacheSize = databaseCacheSize();
+    if (!_dbOptions.block_cache && cacheSize)
+    {
+        m_blockCache.reset(leveldb::NewLRUCache(cacheSize / 2));
+        _dbOptions.block_cache = m_blockCache.get();
+        _dbOptions.write_buffer_size = cacheSize / 4;
+    }
+
     auto db = static_cast<leveldb::DB*>(nullptr);
     auto const status = leveldb::DB::Open(_dbOptions, _path.string(), &db);
     checkStatus(status, _path);
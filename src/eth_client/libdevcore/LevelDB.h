@@ -7,6 +7,7 @@
 #include "db.h"
 
 #include <boost/filesystem.hpp>
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
@@ -37,6 +38,7 @@ public:
     void forEach(std::function<bool(Slice, Slice)> _f) const override;
 
 private:
+    std::unique_ptr<leveldb::Cache> m_blockCache;  ///< Must outlive m_db
     std::unique_ptr<leveldb::DB> m_db;
     leveldb::ReadOptions const m_readOptions;
     leveldb::WriteOptions const m_writeOptions;
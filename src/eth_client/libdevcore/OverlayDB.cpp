@@ -7,6 +7,7 @@
 #include "SHA3.h"
 #include "OverlayDB.h"
 #include "TrieDB.h"
+#include "TrieNodeCache.h"
 
 namespace dev
 {
@@ -41,6 +42,14 @@ void OverlayDB::commit()
         DEV_READ_GUARDED(x_this)
 #endif
         {
+            for (auto const& i: m_staged)
+                writeBatch->insert(toSlice(i.first), toSlice(i.second));
+            for (auto const& i: m_stagedAux)
+            {
+                bytes b = i.first.asBytes();
+                b.push_back(255);   // for aux
+                writeBatch->insert(toSlice(b), toSlice(i.second));
+            }
             for (auto const& i: m_main)
             {
                 if (i.second.second)
@@ -75,6 +84,13 @@ void OverlayDB::commit()
                 std::this_thread::sleep_for(std::chrono::seconds(i + 1));
             }
         }
+        // Freshly written nodes are the ones most likely to be read next
+        TrieNodeCache& cache = trieNodeCache();
+        for (auto const& i: m_staged)
+            cache.insert(i.first, i.second);
+        for (auto const& i: m_main)
+            if (i.second.second)
+                cache.insert(i.first, i.second.first);
 #if DEV_GUARDED_DB
         DEV_WRITE_GUARDED(x_this)
 #endif
@@ -82,15 +98,56 @@ void OverlayDB::commit()
             m_aux.clear();
             m_main.clear();
         }
+        m_staged.clear();
+        m_stagedAux.clear();
     }
 }
 
+void OverlayDB::stage()
+{
+    if (!m_db)
+        return;
+#if DEV_GUARDED_DB
+    WriteGuard l(x_this);
+#endif
+    for (auto const& i: m_main)
+        if (i.second.second)
+            m_staged[i.first] = i.second.first;
+    for (auto const& i: m_aux)
+        if (i.second.second)
+            m_stagedAux[i.first] = i.second.first;
+    m_aux.clear();
+    m_main.clear();
+}
+
+void OverlayDB::stage(OverlayDB const& _other)
+{
+    if (!m_db)
+        return;
+    stage();
+#if DEV_GUARDED_DB
+    ReadGuard l(_other.x_this);
+#endif
+    m_staged.insert(_other.m_staged.begin(), _other.m_staged.end());
+    m_stagedAux.insert(_other.m_stagedAux.begin(), _other.m_stagedAux.end());
+    for (auto const& i: _other.m_main)
+        if (i.second.second)
+            m_staged.emplace(i.first, i.second.first);
+    for (auto const& i: _other.m_aux)
+        if (i.second.second)
+            m_stagedAux.emplace(i.first, i.second.first);
+}
+
 bytes OverlayDB::lookupAux(h256 const& _h) const
 {
     bytes ret = StateCacheDB::lookupAux(_h);
     if (!ret.empty() || !m_db)
         return ret;
 
+    auto it = m_stagedAux.find(_h);
+    if (it != m_stagedAux.end())
+        return it->second;
+
     bytes b = _h.asBytes();
     b.push_back(255);   // for aux
     std::string const v = m_db->lookup(toSlice(b));
@@ -106,6 +163,17 @@ void OverlayDB::rollback()
     WriteGuard l(x_this);
 #endif
     m_main.clear();
+    m_staged.clear();
+    m_stagedAux.clear();
+}
+
+void OverlayDB::discard()
+{
+#if DEV_GUARDED_DB
+    WriteGuard l(x_this);
+#endif
+    m_main.clear();
+    m_aux.clear();
 }
 
 std::string OverlayDB::lookup(h256 const& _h) const
@@ -114,23 +182,39 @@ std::string OverlayDB::lookup(h256 const& _h) const
     if (!ret.empty() || !m_db)
         return ret;
 
-    return m_db->lookup(toSlice(_h));
+    auto it = m_staged.find(_h);
+    if (it != m_staged.end())
+        return it->second;
+
+    return lookupDB(_h);
 }
 
 bool OverlayDB::exists(h256 const& _h) const
 {
-    if (StateCacheDB::exists(_h))
+    if (StateCacheDB::exists(_h) || m_staged.count(_h))
         return true;
-    return m_db && m_db->exists(toSlice(_h));
+    return m_db && !lookupDB(_h).empty();
+}
+
+std::string OverlayDB::lookupDB(h256 const& _h) const
+{
+    TrieNodeCache& cache = trieNodeCache();
+    std::string ret;
+    if (cache.lookup(_h, ret))
+        return ret;
+
+    ret = m_db->lookup(toSlice(_h));
+    cache.insert(_h, ret);
+    return ret;
 }
 
 void OverlayDB::kill(h256 const& _h)
 {
     if (!StateCacheDB::kill(_h))
     {
-        if (m_db)
+        if (m_db && !m_staged.count(_h))
         {
-            if (!m_db->exists(toSlice(_h)))
+            if (lookupDB(_h).empty())
             {
                 // No point node ref decreasing for EmptyTrie since we never bother incrementing it
                 // in the first place for empty storage tries.
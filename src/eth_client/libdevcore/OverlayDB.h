@@ -32,8 +32,18 @@ public:
     OverlayDB(OverlayDB&&) = default;
     OverlayDB& operator=(OverlayDB&&) = default;
 
+    /// Write staged and pending nodes to the database in one batch.
     void commit();
+    /// Keep the nodes pending so far in memory until the next commit(). Staged
+    /// nodes are no longer affected by kill(), so they are written exactly as a
+    /// commit() at this point would have written them.
+    void stage();
+    /// Stage the staged and pending nodes of another overlay as well.
+    void stage(OverlayDB const& _other);
+    /// Drop staged and pending nodes without writing them.
 	void rollback();
+    /// Drop the nodes pending since the last stage(), keeping the staged ones.
+    void discard();
 
 	std::string lookup(h256 const& _h) const;
 	bool exists(h256 const& _h) const;
@@ -44,7 +54,13 @@ public:
 private:
 	using StateCacheDB::clear;
 
+	/// Read a node from the database through the shared trie node cache.
+	std::string lookupDB(h256 const& _h) const;
+
     std::shared_ptr<db::DatabaseFace> m_db;
+
+    std::unordered_map<h256, std::string> m_staged;
+    std::unordered_map<h256, bytes> m_stagedAux;
 };
 
 }
@@ -0,0 +1,94 @@
+#include "TrieNodeCache.h"
+
+namespace dev
+{
+
+size_t TrieNodeCache::entryUsage(std::string const& _value)
+{
+    // Key and value plus the list node, index node and bucket around them
+    return sizeof(h256) + _value.capacity() + 4 * sizeof(void*) + sizeof(Entries::value_type);
+}
+
+void TrieNodeCache::setMaxSize(size_t _maxSize)
+{
+    Guard l(x_cache);
+    m_maxSize = _maxSize;
+    evict();
+}
+
+bool TrieNodeCache::lookup(h256 const& _h, std::string& _value)
+{
+    Guard l(x_cache);
+    auto it = m_index.find(_h);
+    if (it == m_index.end())
+    {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    _value = it->second->second;
+    return true;
+}
+
+bool TrieNodeCache::exists(h256 const& _h)
+{
+    Guard l(x_cache);
+    return m_index.count(_h);
+}
+
+void TrieNodeCache::insert(h256 const& _h, std::string const& _value)
+{
+    Guard l(x_cache);
+    if (!m_maxSize || _value.empty())
+        return;
+    auto it = m_index.find(_h);
+    if (it != m_index.end())
+    {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+    m_entries.emplace_front(_h, _value);
+    m_index.emplace(_h, m_entries.begin());
+    m_usage += entryUsage(_value);
+    evict();
+}
+
+void TrieNodeCache::clear()
+{
+    Guard l(x_cache);
+    m_index.clear();
+    m_entries.clear();
+    m_usage = 0;
+}
+
+TrieNodeCache::Stats TrieNodeCache::stats() const
+{
+    Guard l(x_cache);
+    Stats ret;
+    ret.usage = m_usage;
+    ret.maxSize = m_maxSize;
+    ret.entries = m_index.size();
+    ret.hits = m_hits;
+    ret.misses = m_misses;
+    return ret;
+}
+
+void TrieNodeCache::evict()
+{
+    while (m_usage > m_maxSize && !m_entries.empty())
+    {
+        auto const& oldest = m_entries.back();
+        m_usage -= entryUsage(oldest.second);
+        m_index.erase(oldest.first);
+        m_entries.pop_back();
+    }
+}
+
+TrieNodeCache& trieNodeCache()
+{
+    static TrieNodeCache s_cache;
+    return s_cache;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+#include <list>
+#include <unordered_map>
+
+namespace dev
+{
+
+/**
+ * Size bounded LRU cache of trie nodes read from the state databases.
+ * Nodes are stored under the hash of their content and never change once
+ * written, so entries stay valid and the cache can be shared by every
+ * OverlayDB on top of the state and UTXO databases.
+ */
+class TrieNodeCache
+{
+public:
+    struct Stats
+    {
+        size_t usage = 0;
+        size_t maxSize = 0;
+        size_t entries = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    /// Set the maximum memory usage in bytes, 0 disables the cache.
+    void setMaxSize(size_t _maxSize);
+
+    /// Copy the node into _value and return true if it is cached.
+    bool lookup(h256 const& _h, std::string& _value);
+    bool exists(h256 const& _h);
+    void insert(h256 const& _h, std::string const& _value);
+
+    void clear();
+
+    Stats stats() const;
+
+private:
+    using Entries = std::list<std::pair<h256, std::string>>;
+
+    static size_t entryUsage(std::string const& _value);
+
+    void evict();
+
+    mutable Mutex x_cache;
+
+    Entries m_entries;  ///< Most recently used first
+    std::unordered_map<h256, Entries::iterator> m_index;
+
+    size_t m_usage = 0;
+    size_t m_maxSize = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+/// The cache shared by the state databases
+TrieNodeCache& trieNodeCache();
+
+}
@@ -62,6 +62,7 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <protocol.h>
+#include <qtum/callstate.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
@@ -93,6 +94,7 @@
 #include <validationinterface.h>
 #include <validators/validatordb.h>
 #include <validators/delegation.h>
+#include <validators/validatorstore.h>
 #include <trust/trustscore.h>
 #include <trust/heartbeat_net.h>
 #include <walletinitinterface.h>
@@ -134,6 +136,7 @@ using common::ResolveErrMsg;
 using node::ApplyArgsManOptions;
 using node::BlockManager;
 using node::CalculateCacheSizes;
+using node::CalculateEVMStateCacheSize;
 using node::ChainstateLoadResult;
 using node::ChainstateLoadStatus;
 using node::DEFAULT_PERSIST_MEMPOOL;
@@ -388,6 +391,7 @@ void Shutdown(NodeContext& node)
     trust::ShutdownPeerDiscovery();
 
     // Shutdown validator and delegation databases
+    validators::ShutdownValidatorStore();
     validators::ShutdownValidatorDB();
     validators::ShutdownDelegationDB();
 
@@ -406,6 +410,7 @@ void Shutdown(NodeContext& node)
             }
         }
         pstorageresult.reset();
+        pcallstatepool.reset();
         globalState.reset();
         globalSealEngine.reset();
     }
@@ -558,6 +563,7 @@ void SetupServerArgs(ArgsManager& argsman, bool can_listen_ipc)
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-logevents", strprintf("Maintain a full EVM log index, used by searchlogs and gettransactionreceipt rpc calls (default: %u)", DEFAULT_LOGEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-evmstatecache=<n>", strprintf("Maximum cache size <n> MiB for the EVM state databases and their trie nodes (default: %d)", DEFAULT_EVM_STATE_CACHE >> 20), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-addrindex", strprintf("Maintain a full address index (default: %u)", DEFAULT_ADDRINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-deleteblockchaindata", "Delete the local copy of the block chain data", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-forceinitialblocksdownloadmode", strprintf("Force initial blocks download mode for the node (default: %u)", DEFAULT_FORCE_INITIAL_BLOCKS_DOWNLOAD_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -1676,6 +1682,7 @@ static ChainstateLoadResult InitAndLoadChainstate(
     options.record_log_opcodes = args.IsArgSet("-record-log-opcodes");
     options.addrindex = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
     options.logevents = args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
+    options.evm_state_cache = CalculateEVMStateCacheSize(args);
     uiInterface.InitMessage(_("Loading block index…"));
     auto catch_exceptions = [](auto&& f) -> ChainstateLoadResult {
         try {
@@ -2061,6 +2068,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                   index_cache_sizes.filter_index * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
     LogInfo("* Using %.1f MiB for chain state database", kernel_cache_sizes.coins_db * (1.0 / 1024 / 1024));
+    LogInfo("* Using %.1f MiB for EVM state databases", CalculateEVMStateCacheSize(args) * (1.0 / 1024 / 1024));
 
     assert(!node.mempool);
     assert(!node.chainman);
@@ -2115,6 +2123,12 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                                      peerman_opts);
     validation_signals.RegisterValidationInterface(node.peerman.get());
 
+    // Convert results stored in the legacy format a batch at a time, whether or not new blocks arrive
+    scheduler.scheduleEvery([] {
+        LOCK(cs_main);
+        if (pstorageresult) pstorageresult->migrateLegacyResults();
+    }, MIGRATION_INTERVAL);
+
     // ********************************************************* Step 8: start indexers
 
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
@@ -2139,11 +2153,21 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     LogPrintf("Initializing validator and delegation databases...\n");
     validators::InitValidatorDB(chainparams.GetConsensus());
     validators::InitDelegationDB(chainparams.GetConsensus());
+    if (!validators::InitValidatorStore(args.GetDataDirNet() / "validators")) {
+        return InitError(_("Error opening validator database"));
+    }
+    if (!WITH_LOCK(cs_main, return validators::SyncValidatorStore(chainman))) {
+        return InitError(_("Validator database does not match the active chain. Remove the validators directory to rebuild it."));
+    }
 
     // ********************************************************* Step 8c: initialize trust system
     LogPrintf("Initializing trust system...\n");
     static trust::TrustScoreManager trust_manager(chainparams.GetConsensus());
-    trust::InitHeartbeatManager(trust_manager, chainparams.GetConsensus());
+    trust::InitHeartbeatManager(trust_manager, chainparams.GetConsensus(), chainman.m_options.worker_threads_num);
+    trust::g_heartbeat_manager->OnNewBlock(WITH_LOCK(cs_main, return chainman.ActiveHeight()));
+    scheduler.scheduleEvery([] {
+        if (trust::g_heartbeat_manager) trust::g_heartbeat_manager->ProcessPendingHeartbeats();
+    }, trust::HEARTBEAT_PROCESS_INTERVAL);
     trust::InitPeerDiscovery(fs::PathToString(args.GetDataDirNet()));
 
     // ********************************************************* Step 9: load wallet
@@ -216,8 +216,8 @@ public:
         const FoundBlock& block1_out={},
         const FoundBlock& block2_out={}) = 0;
 
-    //! Get map of the immature stakes.
-    virtual std::map<COutPoint, uint32_t> getImmatureStakes() = 0;
+    //! Get map of the immature stakes, shared with other readers of the same tip.
+    virtual std::shared_ptr<const std::map<COutPoint, uint32_t>> getImmatureStakes() = 0;
 
     //! Look up unspent output information. Returns coins in the mempool and in
     //! the current chain UTXO set. Iterates through all the keys in the map and
@@ -133,6 +133,10 @@ static const unsigned int NODE_NETWORK_LIMITED_ALLOW_CONN_BLOCKS = 144;
 static constexpr auto AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL{24h};
 /** Average delay between peer address broadcasts */
 static constexpr auto AVG_ADDRESS_BROADCAST_INTERVAL{30s};
+/** Delay between validator set syncs with a peer */
+static constexpr auto VALIDATOR_SYNC_INTERVAL{10min};
+/** Minimum delay between answering validator set syncs from a peer */
+static constexpr auto MIN_VALIDATOR_SYNC_REPLY_INTERVAL{1min};
 /** Delay between rotating the peers we relay a particular address to */
 static constexpr auto ROTATE_ADDR_RELAY_DEST_INTERVAL{24h};
 /** Average delay between trickled inventory transmissions for inbound peers.
@@ -354,6 +358,16 @@ struct Peer {
     /** Whether the peer has signaled support for receiving ADDRv2 (BIP155)
      *  messages, indicating a preference to receive ADDRv2 instead of ADDR ones. */
     std::atomic_bool m_wants_addrv2{false};
+    /** Whether the peer has signaled support for receiving the compact
+     *  HEARTBEATV2 and VALIDATORSV2 encodings. */
+    std::atomic_bool m_wants_compact_trust{false};
+    /** The peer's validator change set and the last epoch of it we applied. */
+    uint256 m_validator_sync_id GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
+    uint64_t m_validator_sync_epoch GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
+    /** Time point to send the next getvalsync message to this peer. */
+    std::chrono::microseconds m_next_validator_sync GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
+    /** Earliest time point a getvalsync message from this peer is answered. */
+    std::chrono::microseconds m_next_validator_sync_reply GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
     /** Whether this peer has already sent us a getaddr message. */
     bool m_getaddr_recvd GUARDED_BY(NetEventsInterface::g_msgproc_mutex){false};
     /** Number of addresses that can be processed from this peer. Start at 1 to
@@ -824,6 +838,9 @@ private:
      */
     void RelayAddress(NodeId originator, const CAddress& addr, bool fReachable) EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, g_msgproc_mutex);
 
+    /** Send `getvalsync` messages on a regular schedule. */
+    void MaybeSendValidatorSync(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+
     /** Send `feefilter` message. */
     void MaybeSendFeefilter(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
 
@@ -2222,6 +2239,11 @@ void PeerManagerImpl::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlock
 {
     SetBestBlock(pindexNew->nHeight, std::chrono::seconds{pindexNew->GetBlockTime()});
 
+    // WATTx: Advance heartbeat expectations and the heartbeat replay window
+    if (trust::g_heartbeat_manager) {
+        trust::g_heartbeat_manager->OnNewBlock(pindexNew->nHeight);
+    }
+
     // Don't relay inventory during initial block download.
     if (fInitialDownload) return;
 
@@ -3744,6 +3766,10 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             MakeAndPushMessage(pfrom, NetMsgType::SENDADDRV2);
         }
 
+        // WATTx: Signal support for the compact heartbeat and validator list encoding.
+        // Peers that don't know it ignore unknown messages before VERACK.
+        MakeAndPushMessage(pfrom, NetMsgType::SENDTRUSTV2);
+
         pfrom.m_has_all_wanted_services = HasAllDesirableServiceFlags(nServices);
         peer->m_their_services = nServices;
         pfrom.SetAddrLocal(addrMe);
@@ -4012,6 +4038,17 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    // WATTx: Negotiation of the compact trust encoding, same rules as sendaddrv2
+    if (msg_type == NetMsgType::SENDTRUSTV2) {
+        if (pfrom.fSuccessfullyConnected) {
+            LogDebug(BCLog::NET, "sendtrustv2 received after verack, %s\n", pfrom.DisconnectMsg(fLogIPs));
+            pfrom.fDisconnect = true;
+            return;
+        }
+        peer->m_wants_compact_trust = true;
+        return;
+    }
+
     // Received from a peer demonstrating readiness to announce transactions via reconciliations.
     // This feature negotiation must happen between VERSION and VERACK to avoid relay problems
     // from switching announcement protocols after the connection is up.
@@ -5168,14 +5205,19 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
     }
 
     // WATTx: Handle heartbeat messages from validators
-    if (msg_type == NetMsgType::HEARTBEAT) {
+    if (msg_type == NetMsgType::HEARTBEAT || msg_type == NetMsgType::HEARTBEATV2) {
         trust::Heartbeat heartbeat;
-        vRecv >> heartbeat;
+        if (msg_type == NetMsgType::HEARTBEATV2) {
+            vRecv >> Using<trust::CompactHeartbeatFormatter>(heartbeat);
+        } else {
+            vRecv >> heartbeat;
+        }
 
-        // Process through heartbeat manager if available
+        // Queue for batched signature verification if available. Peers that
+        // did not negotiate trust v2 may still send DER signed heartbeats.
         if (trust::g_heartbeat_manager) {
-            if (trust::g_heartbeat_manager->ProcessHeartbeat(heartbeat, pfrom.GetId())) {
-                LogDebug(BCLog::NET, "Received valid heartbeat from validator %s via peer=%d\n",
+            if (trust::g_heartbeat_manager->QueueHeartbeat(heartbeat, pfrom.GetId(), /*fromLegacyPeer=*/!peer->m_wants_compact_trust)) {
+                LogDebug(BCLog::NET, "Queued heartbeat from validator %s via peer=%d\n",
                          heartbeat.validatorId.ToString(), pfrom.GetId());
             }
         }
@@ -5186,16 +5228,24 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         // Return list of known validators
         if (trust::g_heartbeat_manager) {
             trust::ValidatorList list = trust::g_heartbeat_manager->GetValidatorList();
-            MakeAndPushMessage(pfrom, NetMsgType::VALIDATORS, list);
+            if (peer->m_wants_compact_trust) {
+                MakeAndPushMessage(pfrom, NetMsgType::VALIDATORSV2, Using<trust::CompactValidatorListFormatter>(list));
+            } else {
+                MakeAndPushMessage(pfrom, NetMsgType::VALIDATORS, list);
+            }
             LogDebug(BCLog::NET, "Sent validator list (%d validators) to peer=%d\n",
                      list.validators.size(), pfrom.GetId());
         }
         return;
     }
 
-    if (msg_type == NetMsgType::VALIDATORS) {
+    if (msg_type == NetMsgType::VALIDATORS || msg_type == NetMsgType::VALIDATORSV2) {
         trust::ValidatorList list;
-        vRecv >> list;
+        if (msg_type == NetMsgType::VALIDATORSV2) {
+            vRecv >> Using<trust::CompactValidatorListFormatter>(list);
+        } else {
+            vRecv >> list;
+        }
 
         if (trust::g_heartbeat_manager) {
             trust::g_heartbeat_manager->ProcessValidatorList(list);
@@ -5205,6 +5255,36 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    if (msg_type == NetMsgType::GETVALSYNC) {
+        trust::ValidatorSyncRequest request;
+        vRecv >> request;
+
+        const auto current_time{GetTime<std::chrono::microseconds>()};
+        if (trust::g_heartbeat_manager && request.version == trust::VALIDATOR_SYNC_VERSION &&
+            current_time >= peer->m_next_validator_sync_reply) {
+            // Reconciling a sketch costs work proportional to the validator set, so rate-limit
+            peer->m_next_validator_sync_reply = current_time + MIN_VALIDATOR_SYNC_REPLY_INTERVAL;
+            const trust::ValidatorSyncReply reply{trust::g_heartbeat_manager->ProcessValidatorSyncRequest(request)};
+            MakeAndPushMessage(pfrom, NetMsgType::VALSYNC, reply);
+            LogDebug(BCLog::NET, "Sent validator sync mode %d (%d validators) to peer=%d\n",
+                     static_cast<int>(reply.mode), reply.validators.size(), pfrom.GetId());
+        }
+        return;
+    }
+
+    if (msg_type == NetMsgType::VALSYNC) {
+        trust::ValidatorSyncReply reply;
+        vRecv >> reply;
+
+        if (trust::g_heartbeat_manager && trust::g_heartbeat_manager->ProcessValidatorSyncReply(reply)) {
+            peer->m_validator_sync_id = reply.changeSetId;
+            peer->m_validator_sync_epoch = reply.epoch;
+            LogDebug(BCLog::NET, "Received validator sync mode %d (%d validators) from peer=%d\n",
+                     static_cast<int>(reply.mode), reply.validators.size(), pfrom.GetId());
+        }
+        return;
+    }
+
     if (msg_type == NetMsgType::REGVALIDATOR) {
         trust::ValidatorRegistration reg;
         vRecv >> reg;
@@ -5666,6 +5746,17 @@ void PeerManagerImpl::MaybeSendSendHeaders(CNode& node, Peer& peer)
     }
 }
 
+void PeerManagerImpl::MaybeSendValidatorSync(CNode& node, Peer& peer, std::chrono::microseconds current_time)
+{
+    if (!trust::g_heartbeat_manager || !peer.m_wants_compact_trust) return;
+    if (current_time < peer.m_next_validator_sync) return;
+
+    const trust::ValidatorSyncRequest request{
+        trust::g_heartbeat_manager->CreateValidatorSyncRequest(peer.m_validator_sync_id, peer.m_validator_sync_epoch)};
+    MakeAndPushMessage(node, NetMsgType::GETVALSYNC, request);
+    peer.m_next_validator_sync = current_time + VALIDATOR_SYNC_INTERVAL;
+}
+
 void PeerManagerImpl::MaybeSendFeefilter(CNode& pto, Peer& peer, std::chrono::microseconds current_time)
 {
     if (m_opts.ignore_incoming_txs) return;
@@ -5796,6 +5887,8 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
 
     MaybeSendSendHeaders(*pto, *peer);
 
+    MaybeSendValidatorSync(*pto, *peer, current_time);
+
     {
         LOCK(cs_main);
 
@@ -34,15 +34,53 @@
 #include <util/fs.h>
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <chainparams.h>
+#include <libdevcore/SHA3.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <map>
 #include <ranges>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
+////////////////////////////////////////// // qtum
+/** Bloom bits set by a log address or topic, as in dev::eth::LogEntry::bloom() */
+template <unsigned N>
+static dev::h2048 LogBloomPart(const dev::FixedHash<N>& value)
+{
+    dev::h2048 bloom;
+    bloom.shiftBloom<3>(dev::sha3(value.ref()));
+    return bloom;
+}
+
+static void AddLogTxHash(std::vector<uint256>& hashes, const uint256& txHash)
+{
+    if (hashes.empty() || hashes.back() != txHash) {
+        hashes.push_back(txHash);
+    }
+}
+
+void CBlockLogIndex::Add(const uint256& txHash, const dev::h160& address, const std::vector<dev::h256>& logTopics)
+{
+    AddLogTxHash(addresses[address], txHash);
+    bloom |= LogBloomPart(address);
+    for (size_t i = 0; i < logTopics.size(); ++i) {
+        bloom |= LogBloomPart(logTopics[i]);
+        if (i < LOG_INDEX_MAX_TOPICS) {
+            AddLogTxHash(topics[{uint8_t(i), logTopics[i], address}], txHash);
+        }
+    }
+}
+//////////////////////////////////////////
+
 namespace kernel {
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
 static constexpr uint8_t DB_BLOCK_INDEX{'b'};
@@ -63,6 +101,10 @@ static constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
 static constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
 static constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
 static constexpr uint8_t DB_SPENTINDEX{'p'};
+static constexpr uint8_t DB_LOGADDRESSINDEX{'e'};
+static constexpr uint8_t DB_LOGTOPICINDEX{'o'};
+static constexpr uint8_t DB_LOGRANGEINDEX{'r'};
+static constexpr uint8_t DB_LOGINDEXSTART{'L'};
 
 struct DelegateEntry {
     uint160 address;
@@ -90,6 +132,15 @@ bool BlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo& info)
     return Read(std::make_pair(DB_BLOCK_FILES, nFile), info);
 }
 
+bool BlockTreeDB::ReadBlockIndexColdData(const uint256& hash, BlockIndexColdData& data)
+{
+    CDiskBlockIndex diskindex;
+    if (!Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex)) return false;
+    data.vchBlockSigDlgt = std::move(diskindex.vchBlockSigDlgt);
+    data.hashProof = diskindex.hashProof;
+    return true;
+}
+
 bool BlockTreeDB::WriteReindexing(bool fReindexing)
 {
     if (fReindexing) {
@@ -137,55 +188,181 @@ bool BlockTreeDB::ReadFlag(const std::string& name, bool& fValue)
     return true;
 }
 
+/** Number of key ranges the block index is split into when it is loaded */
+static constexpr int BLOCK_INDEX_LOAD_RANGES{1024};
+/** Maximum number of threads parsing the block index when it is loaded */
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+/** Approximate size of a block index entry in the database, used to size the block map */
+static constexpr size_t BLOCK_INDEX_ENTRY_DISK_SIZE{200};
+
+namespace {
+//! First key of a range, the ranges split the block hashes by their first 10 bits
+std::pair<uint8_t, uint256> BlockIndexRangeStart(int range)
+{
+    uint256 hash;
+    hash.data()[0] = range >> 2;
+    hash.data()[1] = (range & 3) << 6;
+    return std::make_pair(DB_BLOCK_INDEX, hash);
+}
+
+int BlockIndexRangeOf(const uint256& hash)
+{
+    return (hash.data()[0] << 2) | (hash.data()[1] >> 6);
+}
+
+/**
+ * Parses the block index on worker threads, one key range at a time. The
+ * ranges are handed out in key order and at most a few ranges ahead of the
+ * consumer, so the parsed entries waiting to be inserted stay bounded.
+ */
+class BlockIndexRangeLoader
+{
+public:
+    using Entries = std::deque<std::pair<uint256, CDiskBlockIndex>>;
+
+    BlockIndexRangeLoader(CDBWrapper& db, int nThreads) : m_db(db), m_ranges(BLOCK_INDEX_LOAD_RANGES), m_window(2 * nThreads)
+    {
+        for (int n = 0; n < nThreads; ++n) {
+            m_threads.emplace_back([this, n] {
+                util::ThreadRename(strprintf("loadblk.%i", n));
+                ThreadLoad();
+            });
+        }
+    }
+
+    ~BlockIndexRangeLoader()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        for (std::thread& t : m_threads) {
+            t.join();
+        }
+    }
+
+    //! Wait for the next range in key order, false if it could not be read
+    bool Next(Entries& entries) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_ranges[m_consumed].done; });
+        Range& range = m_ranges[m_consumed++];
+        entries = std::move(range.entries);
+        m_cv.notify_all();
+        return !range.failed;
+    }
+
+private:
+    struct Range {
+        Entries entries;
+        bool done{false};
+        bool failed{false};
+    };
+
+    void ThreadLoad() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::unique_ptr<CDBIterator> pcursor(m_db.NewIterator());
+        while (true) {
+            int range;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_stop || m_next_range >= BLOCK_INDEX_LOAD_RANGES || m_next_range < m_consumed + m_window;
+                });
+                if (m_stop || m_next_range >= BLOCK_INDEX_LOAD_RANGES) return;
+                range = m_next_range++;
+            }
+            Entries entries;
+            bool fOk = ParseRange(*pcursor, range, entries);
+            {
+                LOCK(m_mutex);
+                m_ranges[range].entries = std::move(entries);
+                m_ranges[range].failed = !fOk;
+                m_ranges[range].done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    static bool ParseRange(CDBIterator& cursor, int range, Entries& entries)
+    {
+        cursor.Seek(BlockIndexRangeStart(range));
+        while (cursor.Valid()) {
+            std::pair<uint8_t, uint256> key;
+            if (!cursor.GetKey(key) || key.first != DB_BLOCK_INDEX || BlockIndexRangeOf(key.second) != range) break;
+            auto& [hash, diskindex] = entries.emplace_back();
+            if (!cursor.GetValue(diskindex)) return false;
+            hash = diskindex.ConstructBlockHash();
+            // qtum: the signature and proof hash stay on disk until they are needed
+            diskindex.nBlockSigSize = diskindex.vchBlockSigDlgt.size();
+            std::vector<unsigned char>().swap(diskindex.vchBlockSigDlgt);
+            cursor.Next();
+        }
+        return true;
+    }
+
+    CDBWrapper& m_db;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Range> m_ranges GUARDED_BY(m_mutex);
+    int m_next_range GUARDED_BY(m_mutex){0};
+    int m_consumed GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    const int m_window;
+    std::vector<std::thread> m_threads;
+};
+} // namespace
+
+size_t BlockTreeDB::EstimateBlockIndexEntries() const
+{
+    return EstimateSize(BlockIndexRangeStart(0), std::make_pair(uint8_t(DB_BLOCK_INDEX + 1), uint256())) / BLOCK_INDEX_ENTRY_DISK_SIZE;
+}
+
 bool BlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, const util::SignalInterrupt& interrupt)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+
+    // Parsing the entries and hashing the headers runs on the loader threads,
+    // the map is filled here in key order
+    const int nThreads{std::clamp<int>(std::thread::hardware_concurrency(), 1, MAX_BLOCK_INDEX_LOAD_THREADS)};
+    BlockIndexRangeLoader loader(*this, nThreads);
 
     // Load m_block_index
-    while (pcursor->Valid()) {
+    for (int range = 0; range < BLOCK_INDEX_LOAD_RANGES; ++range) {
         if (interrupt) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.ConstructBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nMoneySupply   = diskindex.nMoneySupply;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->hashStateRoot  = diskindex.hashStateRoot; // qtum
-                pindexNew->hashUTXORoot   = diskindex.hashUTXORoot; // qtum
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake   = diskindex.prevoutStake;
-                pindexNew->vchBlockSigDlgt    = diskindex.vchBlockSigDlgt; // qtum
-
-                if (!CheckIndexProof(*pindexNew, consensusParams)) {
-                    LogError("%s: CheckIndexProof failed: %s\n", __func__, pindexNew->ToString());
-                    return false;
-                }
-
-                // NovaCoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
-                pcursor->Next();
-            } else {
-                LogError("%s: failed to read value\n", __func__);
+        BlockIndexRangeLoader::Entries entries;
+        if (!loader.Next(entries)) {
+            LogError("%s: failed to read value\n", __func__);
+            return false;
+        }
+        for (const auto& [hash, diskindex] : entries) {
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nMoneySupply   = diskindex.nMoneySupply;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->hashStateRoot  = diskindex.hashStateRoot; // qtum
+            pindexNew->hashUTXORoot   = diskindex.hashUTXORoot; // qtum
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->prevoutStake   = diskindex.prevoutStake;
+            pindexNew->nBlockSigSize  = diskindex.nBlockSigSize; // qtum
+
+            if (!CheckIndexProof(*pindexNew, consensusParams)) {
+                LogError("%s: CheckIndexProof failed: %s\n", __func__, pindexNew->ToString());
                 return false;
             }
-        } else {
-            break;
+
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
         }
     }
 
@@ -199,40 +376,27 @@ bool BlockTreeDB::WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const s
     return WriteBatch(batch);
 }
 
-int BlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
-        std::vector<std::vector<uint256>> &blocksOfHashes,
-        std::set<dev::h160> const &addresses, ChainstateManager &chainman) {
-
-    if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
-       return -1;
-    }
+/** Collect height index entries in [low, high], see BlockTreeDB::ReadHeightIndex */
+static int ReadHeightIndexRange(CDBIterator& cursor, unsigned int low, unsigned int high,
+        std::vector<std::vector<uint256>> &blocksOfHashes, std::set<dev::h160> const &addresses) {
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(low)));
+    cursor.Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(low)));
 
     int curheight = 0;
 
-    for (size_t count = 0; pcursor->Valid(); pcursor->Next()) {
+    for (; cursor.Valid(); cursor.Next()) {
 
         std::pair<uint8_t, CHeightTxIndexKey> key;
-        if (!pcursor->GetKey(key) || key.first != DB_HEIGHTINDEX) {
+        if (!cursor.GetKey(key) || key.first != DB_HEIGHTINDEX) {
             break;
         }
 
-        int nextHeight = key.second.height;
+        unsigned int nextHeight = key.second.height;
 
-        if (high > -1 && nextHeight > high) {
+        if (nextHeight > high) {
             break;
         }
 
-        if (minconf > 0) {
-            int conf = chainman.ActiveChain().Height() - nextHeight;
-            if (conf < minconf) {
-                break;
-            }
-        }
-
         curheight = nextHeight;
 
         auto address = key.second.address;
@@ -242,18 +406,36 @@ int BlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
 
         std::vector<uint256> hashesTx;
 
-        if (!pcursor->GetValue(hashesTx)) {
+        if (!cursor.GetValue(hashesTx)) {
             break;
         }
 
-        count += hashesTx.size();
-
         blocksOfHashes.push_back(hashesTx);
     }
 
     return curheight;
 }
 
+int BlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
+        std::vector<std::vector<uint256>> &blocksOfHashes,
+        std::set<dev::h160> const &addresses, ChainstateManager &chainman) {
+
+    if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
+       return -1;
+    }
+
+    int last = high > -1 ? high : std::numeric_limits<int>::max();
+    if (minconf > 0) {
+        last = std::min(last, chainman.ActiveChain().Height() - minconf);
+    }
+    if (last < low) {
+        return 0;
+    }
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    return ReadHeightIndexRange(*pcursor, low, last, blocksOfHashes, addresses);
+}
+
 bool BlockTreeDB::EraseHeightIndex(const unsigned int &height) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -294,6 +476,345 @@ bool BlockTreeDB::WipeHeightIndex() {
     return WriteBatch(batch);
 }
 
+static unsigned int LogRangeStart(unsigned int height)
+{
+    return height - height % LOG_INDEX_RANGE_BLOCKS;
+}
+
+/** Whether a range bloom summary may contain logs matching the query */
+static bool LogRangeMayMatch(const dev::h2048& bloom, const CLogQuery& query)
+{
+    if (!query.addresses.empty() &&
+        std::none_of(query.addresses.begin(), query.addresses.end(), [&](const dev::h160& address) {
+            return bloom.contains(LogBloomPart(address));
+        })) {
+        return false;
+    }
+
+    bool anyTopic = false;
+    bool anyFound = false;
+    for (const auto& topic : query.topics) {
+        if (!topic) {
+            continue;
+        }
+        anyTopic = true;
+        const bool found = bloom.contains(LogBloomPart(*topic));
+        if (query.matchAllTopics && !found) {
+            return false;
+        }
+        anyFound |= found;
+    }
+    return !anyTopic || query.matchAllTopics || anyFound;
+}
+
+template <typename Key>
+static void EraseLogIndexKeys(CDBIterator& cursor, CDBBatch& batch, uint8_t prefix)
+{
+    cursor.Seek(prefix);
+    std::pair<uint8_t, Key> key;
+    while (cursor.Valid() && cursor.GetKey(key) && key.first == prefix) {
+        batch.Erase(key);
+        cursor.Next();
+    }
+}
+
+bool BlockTreeDB::WriteLogIndex(const CBlockLogIndex &logIndex) {
+    CDBBatch batch(*this);
+
+    if (!Exists(DB_LOGINDEXSTART)) {
+        // The address and topic indexes are complete from this block on, or
+        // from genesis if the height index has no older entries
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(0)));
+        std::pair<uint8_t, CHeightTxIndexKey> key;
+        bool hasOlder = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_HEIGHTINDEX && key.second.height < logIndex.height;
+        batch.Write(DB_LOGINDEXSTART, hasOlder ? int(logIndex.height) : 0);
+    }
+
+    for (const auto& [address, hashes] : logIndex.addresses) {
+        batch.Write(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexKey(logIndex.height, address)), hashes);
+        batch.Write(std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, logIndex.height)), hashes);
+    }
+    for (const auto& [key, hashes] : logIndex.topics) {
+        const auto& [position, topic, address] = key;
+        batch.Write(std::make_pair(DB_LOGTOPICINDEX, CLogTopicIndexKey(position, topic, logIndex.height, address)), hashes);
+    }
+
+    if (!logIndex.addresses.empty()) {
+        const auto rangeKey = std::make_pair(DB_LOGRANGEINDEX, CHeightTxIndexIteratorKey(LogRangeStart(logIndex.height)));
+        CLogRangeSummary summary;
+        Read(rangeKey, summary);
+        summary.bloom |= logIndex.bloom;
+        summary.lastHeight = std::max(summary.lastHeight, logIndex.height);
+        batch.Write(rangeKey, summary);
+    }
+
+    return WriteBatch(batch);
+}
+
+bool BlockTreeDB::EraseLogIndex(const CBlockLogIndex &logIndex) {
+    CDBBatch batch(*this);
+    for (const auto& [address, hashes] : logIndex.addresses) {
+        batch.Erase(std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, logIndex.height)));
+    }
+    for (const auto& [key, hashes] : logIndex.topics) {
+        const auto& [position, topic, address] = key;
+        batch.Erase(std::make_pair(DB_LOGTOPICINDEX, CLogTopicIndexKey(position, topic, logIndex.height, address)));
+    }
+
+    if (!logIndex.addresses.empty()) {
+        // Lower the range summary to the highest other block of the range that
+        // still has logs, so queries after a reorg do not report heights the
+        // replacement blocks have not reached. The bloom is left as a superset.
+        const unsigned int rangeStart = LogRangeStart(logIndex.height);
+        const auto rangeKey = std::make_pair(DB_LOGRANGEINDEX, CHeightTxIndexIteratorKey(rangeStart));
+        CLogRangeSummary summary;
+        if (Read(rangeKey, summary)) {
+            std::optional<unsigned int> lastHeight;
+            std::unique_ptr<CDBIterator> pcursor(NewIterator());
+            pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(rangeStart)));
+            for (; pcursor->Valid(); pcursor->Next()) {
+                std::pair<uint8_t, CHeightTxIndexKey> key;
+                if (!pcursor->GetKey(key) || key.first != DB_HEIGHTINDEX || key.second.height >= rangeStart + LOG_INDEX_RANGE_BLOCKS) {
+                    break;
+                }
+                if (key.second.height != logIndex.height) {
+                    lastHeight = key.second.height;
+                }
+            }
+            if (lastHeight) {
+                summary.lastHeight = *lastHeight;
+                batch.Write(rangeKey, summary);
+            } else {
+                batch.Erase(rangeKey);
+            }
+        }
+    }
+
+    return WriteBatch(batch);
+}
+
+bool BlockTreeDB::WipeLogIndex() {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    EraseLogIndexKeys<CLogAddressIndexKey>(*pcursor, batch, DB_LOGADDRESSINDEX);
+    EraseLogIndexKeys<CLogTopicIndexKey>(*pcursor, batch, DB_LOGTOPICINDEX);
+    EraseLogIndexKeys<CHeightTxIndexIteratorKey>(*pcursor, batch, DB_LOGRANGEINDEX);
+    batch.Erase(DB_LOGINDEXSTART);
+
+    return WriteBatch(batch);
+}
+
+CLogQueryPlan BlockTreeDB::PlanLogQuery(const CDBSnapshot &snapshot, const CLogQuery &query, int high) const {
+    CLogQueryPlan plan;
+
+    std::vector<uint8_t> positions;
+    for (size_t i = 0; i < query.topics.size() && i < LOG_INDEX_MAX_TOPICS; ++i) {
+        if (query.topics[i]) {
+            positions.push_back(i);
+        }
+    }
+    if (query.addresses.empty() && positions.empty()) {
+        return plan;
+    }
+
+    int start;
+    if (!snapshot.Read(DB_LOGINDEXSTART, start) || query.fromBlock < start || high < query.fromBlock) {
+        return plan;
+    }
+
+    // Estimated bytes each index would scan. Recent entries that are not yet
+    // compacted into table files are not counted, so ties go to the
+    // secondary indexes.
+    const unsigned int low = query.fromBlock;
+    const unsigned int end = (unsigned int)high + 1;
+    size_t bestCost = EstimateSize(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(low)),
+                                   std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(end)));
+
+    if (!positions.empty()) {
+        std::vector<std::pair<size_t, uint8_t>> costs;
+        for (uint8_t position : positions) {
+            const dev::h256& topic = *query.topics[position];
+            costs.emplace_back(EstimateSize(std::make_pair(DB_LOGTOPICINDEX, CLogTopicIndexKey(position, topic, low, dev::h160())),
+                                            std::make_pair(DB_LOGTOPICINDEX, CLogTopicIndexKey(position, topic, end, dev::h160()))),
+                               position);
+        }
+
+        size_t cost = 0;
+        std::vector<uint8_t> scanned;
+        if (query.matchAllTopics) {
+            // Every topic has to match, scanning the most selective one is enough
+            const auto best = std::min_element(costs.begin(), costs.end());
+            cost = best->first;
+            scanned.push_back(best->second);
+        } else {
+            for (const auto& [topicCost, position] : costs) {
+                cost += topicCost;
+                scanned.push_back(position);
+            }
+        }
+
+        if (cost <= bestCost) {
+            bestCost = cost;
+            plan.index = CLogQueryPlan::Index::TOPIC;
+            plan.topicPositions = scanned;
+        }
+    }
+
+    if (!query.addresses.empty()) {
+        size_t cost = 0;
+        for (const dev::h160& address : query.addresses) {
+            cost += EstimateSize(std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, low)),
+                                 std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, end)));
+        }
+
+        if (cost <= bestCost) {
+            plan.index = CLogQueryPlan::Index::ADDRESS;
+            plan.topicPositions.clear();
+        }
+    }
+
+    return plan;
+}
+
+int BlockTreeDB::ReadLogIndex(const CDBSnapshot &snapshot, const CLogQuery &query, int tipHeight,
+        std::vector<std::vector<uint256>> &blocksOfHashes) const {
+
+    const int low = query.fromBlock;
+    const int high = query.toBlock;
+    if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
+       return -1;
+    }
+
+    int last = tipHeight - std::max(query.minconf, 0);
+    if (high > -1) {
+        last = std::min(last, high);
+    }
+    if (last < low) {
+        return 0;
+    }
+
+    std::unique_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+
+    const CLogQueryPlan plan = PlanLogQuery(snapshot, query, last);
+    if (plan.index == CLogQueryPlan::Index::HEIGHT) {
+        return ReadHeightIndexRange(*pcursor, low, last, blocksOfHashes, query.addresses);
+    }
+
+    std::map<unsigned int, std::vector<std::vector<uint256>>> candidates;
+    unsigned int curheight = 0;
+
+    // Transactions at a height with a log from one of the queried addresses
+    std::map<unsigned int, std::set<uint256>> addressTxsByHeight;
+    auto txsByHeight = [&](unsigned int height) -> const std::set<uint256>& {
+        auto [it, inserted] = addressTxsByHeight.try_emplace(height);
+        if (inserted) {
+            for (const dev::h160& address : query.addresses) {
+                std::vector<uint256> hashesTx;
+                if (snapshot.Read(std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, height)), hashesTx)) {
+                    it->second.insert(hashesTx.begin(), hashesTx.end());
+                }
+            }
+        }
+        return it->second;
+    };
+
+    std::unique_ptr<CDBIterator> prange(snapshot.NewIterator());
+
+    prange->Seek(std::make_pair(DB_LOGRANGEINDEX, CHeightTxIndexIteratorKey(LogRangeStart(low))));
+
+    for (; prange->Valid(); prange->Next()) {
+
+        std::pair<uint8_t, CHeightTxIndexIteratorKey> rangeKey;
+        if (!prange->GetKey(rangeKey) || rangeKey.first != DB_LOGRANGEINDEX || rangeKey.second.height > (unsigned int)last) {
+            break;
+        }
+
+        CLogRangeSummary summary;
+        if (!prange->GetValue(summary)) {
+            LogError("%s: failed to read the log range summary at height %u\n", __func__, rangeKey.second.height);
+            throw std::runtime_error("Failed to read log index");
+        }
+
+        const unsigned int rangeLow = std::max((unsigned int)low, rangeKey.second.height);
+        const unsigned int rangeHigh = std::min((unsigned int)last, rangeKey.second.height + LOG_INDEX_RANGE_BLOCKS - 1);
+        if (summary.lastHeight < rangeLow) {
+            continue;
+        }
+        curheight = std::min(summary.lastHeight, rangeHigh);
+
+        if (!LogRangeMayMatch(summary.bloom, query)) {
+            continue;
+        }
+
+        if (plan.index == CLogQueryPlan::Index::ADDRESS) {
+            for (const dev::h160& address : query.addresses) {
+                if (!summary.bloom.contains(LogBloomPart(address))) {
+                    continue;
+                }
+
+                pcursor->Seek(std::make_pair(DB_LOGADDRESSINDEX, CLogAddressIndexKey(address, rangeLow)));
+                for (; pcursor->Valid(); pcursor->Next()) {
+                    std::pair<uint8_t, CLogAddressIndexKey> key;
+                    if (!pcursor->GetKey(key) || key.first != DB_LOGADDRESSINDEX ||
+                        key.second.address != address || key.second.height > rangeHigh) {
+                        break;
+                    }
+
+                    std::vector<uint256> hashesTx;
+                    if (!pcursor->GetValue(hashesTx)) {
+                        LogError("%s: failed to read the log address index at height %u\n", __func__, key.second.height);
+                        throw std::runtime_error("Failed to read log index");
+                    }
+                    candidates[key.second.height].push_back(std::move(hashesTx));
+                }
+            }
+        } else {
+            for (uint8_t position : plan.topicPositions) {
+                const dev::h256& topic = *query.topics[position];
+                if (!summary.bloom.contains(LogBloomPart(topic))) {
+                    continue;
+                }
+
+                pcursor->Seek(std::make_pair(DB_LOGTOPICINDEX, CLogTopicIndexKey(position, topic, rangeLow, dev::h160())));
+                for (; pcursor->Valid(); pcursor->Next()) {
+                    std::pair<uint8_t, CLogTopicIndexKey> key;
+                    if (!pcursor->GetKey(key) || key.first != DB_LOGTOPICINDEX || key.second.position != position ||
+                        key.second.topic != topic || key.second.height > rangeHigh) {
+                        break;
+                    }
+
+                    std::vector<uint256> hashesTx;
+                    if (!pcursor->GetValue(hashesTx)) {
+                        LogError("%s: failed to read the log topic index at height %u\n", __func__, key.second.height);
+                        throw std::runtime_error("Failed to read log index");
+                    }
+
+                    // Addresses match a transaction with a log from any of them, as
+                    // in the height and address indexes, not the log with the topic
+                    if (!query.addresses.empty()) {
+                        const std::set<uint256>& addressTxs = txsByHeight(key.second.height);
+                        std::erase_if(hashesTx, [&](const uint256& hash) { return !addressTxs.count(hash); });
+                        if (hashesTx.empty()) {
+                            continue;
+                        }
+                    }
+                    candidates[key.second.height].push_back(std::move(hashesTx));
+                }
+            }
+        }
+    }
+
+    for (auto& [height, hashes] : candidates) {
+        for (auto& hashesTx : hashes) {
+            blocksOfHashes.push_back(std::move(hashesTx));
+        }
+    }
+
+    return curheight;
+}
 
 bool BlockTreeDB::WriteStakeIndex(unsigned int height, uint160 address) {
     CDBBatch batch(*this);
@@ -825,6 +1346,8 @@ CBlockIndex* BlockManager::InsertBlockIndex(const uint256& hash)
 
 bool BlockManager::LoadBlockIndex(const std::optional<uint256>& snapshot_blockhash)
 {
+    // Size the map for the stored entries up front instead of rehashing while loading
+    m_block_index.reserve(m_block_index.size() + m_block_tree_db->EstimateBlockIndexEntries());
     if (!m_block_tree_db->LoadBlockIndexGuts(
             GetConsensus(), [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }, m_interrupt)) {
         return false;
@@ -1644,6 +2167,14 @@ BlockManager::BlockManager(const util::SignalInterrupt& interrupt, Options opts)
       m_interrupt{interrupt}
 {
     m_block_tree_db = std::make_unique<BlockTreeDB>(m_opts.block_tree_db_params);
+    SetBlockIndexColdLoader(this, [this](const CBlockIndex& index, BlockIndexColdData& data) {
+        if (m_block_tree_db && m_block_tree_db->ReadBlockIndexColdData(index.GetBlockHash(), data)) {
+            return true;
+        }
+        // The entry was written before the data was released, so this is a corrupted block index
+        m_opts.notifications.fatalError(strprintf(_("Failed to read block index entry %s from disk."), index.GetBlockHash().ToString()));
+        return false;
+    });
 
     if (m_opts.block_tree_db_params.wipe_data) {
         m_block_tree_db->WriteReindexing(true);
@@ -1655,6 +2186,11 @@ BlockManager::BlockManager(const util::SignalInterrupt& interrupt, Options opts)
     }
 }
 
+BlockManager::~BlockManager()
+{
+    ResetBlockIndexColdLoader(this);
+}
+
 class ImportingNow
 {
     std::atomic<bool>& m_importing;
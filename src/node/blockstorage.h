@@ -15,6 +15,7 @@
 #include <kernel/messagestartchars.h>
 #include <primitives/block.h>
 #include <streams.h>
+#include <support/allocators/pool.h>
 #include <sync.h>
 #include <uint256.h>
 #include <util/fs.h>
@@ -36,6 +37,7 @@
 #include <set>
 #include <span>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -47,6 +49,9 @@ class ChainstateManager;
 //////////////////////////////////// //qtum
 struct CHeightTxIndexKey;
 struct CHeightTxIndexIteratorKey;
+struct CBlockLogIndex;
+struct CLogQuery;
+struct CLogQueryPlan;
 struct CAddressIndexKey;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
@@ -71,11 +76,14 @@ public:
     using CDBWrapper::CDBWrapper;
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*>>& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& info);
+    bool ReadBlockIndexColdData(const uint256& hash, BlockIndexColdData& data);
     bool ReadLastBlockFile(int& nFile);
     bool WriteReindexing(bool fReindexing);
     void ReadReindexing(bool& fReindexing);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
+    //! Approximate number of block index entries, from the size of their key range on disk
+    size_t EstimateBlockIndexEntries() const;
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, const util::SignalInterrupt& interrupt)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
@@ -99,6 +107,42 @@ public:
     bool EraseHeightIndex(const unsigned int &height);
     bool WipeHeightIndex();
 
+    /**
+     * Write the height, address and topic index entries of a block's logs in
+     * one batch and fold them into the bloom summary of the block's range.
+     */
+    bool WriteLogIndex(const CBlockLogIndex &logIndex);
+
+    /**
+     * Erase the address and topic index entries of a disconnected block.
+     * Range bloom summaries are kept, they can only report false positives.
+     */
+    bool EraseLogIndex(const CBlockLogIndex &logIndex);
+    bool WipeLogIndex();
+
+    /**
+     * Pick the index expected to produce the fewest candidate blocks for a
+     * query over [query.fromBlock, high], based on the on-disk size of the
+     * key range each index would scan.
+     */
+    CLogQueryPlan PlanLogQuery(const CDBSnapshot &snapshot, const CLogQuery &query, int high) const;
+
+    /**
+     * Collect the transaction hashes of blocks that may contain logs matching
+     * the query, in block height order, using the index chosen by
+     * PlanLogQuery. Block ranges whose bloom summary rules out the filter are
+     * skipped. Receipts still need to be matched against the filter.
+     *
+     * Reads go through a snapshot taken together with tipHeight, so this
+     * does not need cs_main.
+     *
+     * @return the height of the latest block with logs covered by the query,
+     *         0 if there is none and -1 if the query range is invalid.
+     * @throws std::runtime_error if an index entry cannot be read.
+     */
+    int ReadLogIndex(const CDBSnapshot &snapshot, const CLogQuery &query, int tipHeight,
+            std::vector<std::vector<uint256>> &blocksOfHashes) const;
+
 
     bool WriteStakeIndex(unsigned int height, uint160 address);
     bool ReadStakeIndex(unsigned int height, uint160& address);
@@ -151,7 +195,18 @@ static constexpr size_t UNDO_DATA_DISK_OVERHEAD{BLOCK_SERIALIZATION_HEADER_SIZE
 // we ever switch to another associative container, we need to either use a
 // container that has stable addressing (true of all std associative
 // containers), or make the key a `std::unique_ptr<CBlockIndex>`
-using BlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+//
+// The nodes are allocated from a PoolAllocator, so loading tens of millions of
+// entries at startup fills large chunks instead of making one allocation each.
+// See CCoinsMap for the size of the pool blocks.
+using BlockMapPair = std::pair<const uint256, CBlockIndex>;
+using BlockMap = std::unordered_map<uint256,
+                                    CBlockIndex,
+                                    BlockHasher,
+                                    std::equal_to<uint256>,
+                                    PoolAllocator<BlockMapPair,
+                                                  sizeof(BlockMapPair) + sizeof(void*) * 4>>;
+using BlockMapMemoryResource = BlockMap::allocator_type::ResourceType;
 
 struct CBlockIndexWorkComparator {
     bool operator()(const CBlockIndex* pa, const CBlockIndex* pb) const;
@@ -329,6 +384,7 @@ public:
     using Options = kernel::BlockManagerOpts;
 
     explicit BlockManager(const util::SignalInterrupt& interrupt, Options opts);
+    ~BlockManager();
 
     const util::SignalInterrupt& m_interrupt;
     std::atomic<bool> m_importing{false};
@@ -341,7 +397,8 @@ public:
      */
     std::atomic_bool m_blockfiles_indexed{true};
 
-    BlockMap m_block_index GUARDED_BY(cs_main);
+    BlockMapMemoryResource m_block_index_memory_resource{};
+    BlockMap m_block_index GUARDED_BY(cs_main){0, BlockHasher{}, BlockMap::key_equal{}, &m_block_index_memory_resource};
 
     /**
      * The height of the base block of an assumeutxo snapshot, if one is in use.
@@ -568,6 +625,135 @@ struct CHeightTxIndexKey {
     }
 };
 
+// Blocks covered by one log bloom summary
+static constexpr unsigned int LOG_INDEX_RANGE_BLOCKS{128};
+
+// Topic positions covered by the topic log index (LOG0 to LOG4)
+static constexpr size_t LOG_INDEX_MAX_TOPICS{4};
+
+struct CLogAddressIndexKey {
+    dev::h160 address;
+    unsigned int height;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << address.asBytes();
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        valtype tmp;
+        s >> tmp;
+        address = dev::h160(tmp);
+        height = ser_readdata32be(s);
+    }
+
+    CLogAddressIndexKey(dev::h160 _address, unsigned int _height) {
+        address = _address;
+        height = _height;
+    }
+
+    CLogAddressIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        address.clear();
+        height = 0;
+    }
+};
+
+struct CLogTopicIndexKey {
+    uint8_t position;
+    dev::h256 topic;
+    unsigned int height;
+    dev::h160 address;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, position);
+        s << topic.asBytes();
+        ser_writedata32be(s, height);
+        s << address.asBytes();
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        position = ser_readdata8(s);
+        valtype tmp;
+        s >> tmp;
+        topic = dev::h256(tmp);
+        height = ser_readdata32be(s);
+        s >> tmp;
+        address = dev::h160(tmp);
+    }
+
+    CLogTopicIndexKey(uint8_t _position, dev::h256 _topic, unsigned int _height, dev::h160 _address) {
+        position = _position;
+        topic = _topic;
+        height = _height;
+        address = _address;
+    }
+
+    CLogTopicIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        position = 0;
+        topic.clear();
+        height = 0;
+        address.clear();
+    }
+};
+
+/** Union of the log blooms of a range of LOG_INDEX_RANGE_BLOCKS blocks */
+struct CLogRangeSummary {
+    dev::h2048 bloom;
+    unsigned int lastHeight{0}; // highest block in the range that emitted logs
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << bloom.asBytes();
+        ser_writedata32(s, lastHeight);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        valtype tmp;
+        s >> tmp;
+        bloom = dev::h2048(tmp);
+        lastHeight = ser_readdata32(s);
+    }
+};
+
+/** Logs emitted by one block, grouped the way the log indexes store them */
+struct CBlockLogIndex {
+    unsigned int height;
+    std::map<dev::h160, std::vector<uint256>> addresses;
+    std::map<std::tuple<uint8_t, dev::h256, dev::h160>, std::vector<uint256>> topics;
+    dev::h2048 bloom;
+
+    explicit CBlockLogIndex(unsigned int _height) : height(_height) {}
+
+    void Add(const uint256& txHash, const dev::h160& address, const std::vector<dev::h256>& logTopics);
+};
+
+/** Filter of a searchlogs or waitforlogs call */
+struct CLogQuery {
+    int fromBlock{0};
+    int toBlock{-1};
+    int minconf{0};
+    std::set<dev::h160> addresses;
+    std::vector<std::optional<dev::h256>> topics;
+    bool matchAllTopics{true}; // false: a log matches if any of the topics does
+};
+
+struct CLogQueryPlan {
+    enum class Index { HEIGHT, ADDRESS, TOPIC };
+
+    Index index{Index::HEIGHT};
+    std::vector<uint8_t> topicPositions; // positions scanned by a TOPIC plan
+};
+
 struct CTimestampIndexIteratorKey {
     unsigned int timestamp;
 
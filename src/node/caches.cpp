@@ -49,4 +49,11 @@ CacheSizes CalculateCacheSizes(const ArgsManager& args, size_t n_indexes)
     }
     return {index_sizes, kernel::CacheSizes{total_cache}};
 }
+
+size_t CalculateEVMStateCacheSize(const ArgsManager& args)
+{
+    int64_t evm_cache{std::max<int64_t>(0, args.GetIntArg("-evmstatecache", DEFAULT_EVM_STATE_CACHE >> 20))};
+    constexpr auto max_evm_cache{sizeof(void*) == 4 ? MAX_32BIT_DBCACHE : std::numeric_limits<size_t>::max()};
+    return std::min<uint64_t>(SaturatingLeftShift<uint64_t>(evm_cache, 20), max_evm_cache);
+}
 } // namespace node
@@ -16,6 +16,8 @@ class ArgsManager;
 static constexpr size_t MIN_DB_CACHE{4_MiB};
 //! -dbcache default (bytes)
 static constexpr size_t DEFAULT_DB_CACHE{DEFAULT_KERNEL_CACHE};
+//! -evmstatecache default (bytes)
+static constexpr size_t DEFAULT_EVM_STATE_CACHE{64_MiB};
 
 namespace node {
 struct IndexCacheSizes {
@@ -27,6 +29,8 @@ struct CacheSizes {
     kernel::CacheSizes kernel;
 };
 CacheSizes CalculateCacheSizes(const ArgsManager& args, size_t n_indexes = 0);
+//! Memory for the EVM state databases from -evmstatecache (bytes)
+size_t CalculateEVMStateCacheSize(const ArgsManager& args);
 } // namespace node
 
 #endif // BITCOIN_NODE_CACHES_H
@@ -11,6 +11,10 @@
 #include <kernel/caches.h>
 #include <logging.h>
 #include <node/blockstorage.h>
+#include <pos.h>
+#include <qtum/callstate.h>
+#include <libdevcore/DBFactory.h>
+#include <libdevcore/TrieNodeCache.h>
 #include <sync.h>
 #include <threadsafety.h>
 #include <tinyformat.h>
@@ -38,6 +42,7 @@ static ChainstateLoadResult CompleteChainstateInitialization(
     const ChainstateLoadOptions& options) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     pstorageresult.reset();
+    pcallstatepool.reset();
     globalState.reset();
     globalSealEngine.reset();
 
@@ -151,10 +156,16 @@ static ChainstateLoadResult CompleteChainstateInitialization(
     const std::string dirQtum = PathToString(qtumStateDir);
     const dev::h256 hashDB(dev::sha3(dev::rlp("")));
     dev::eth::BaseState existsQtumstate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
+    // Half for the trie node cache, a quarter for each of the state and UTXO databases
+    dev::trieNodeCache().clear();
+    dev::trieNodeCache().setMaxSize(options.evm_state_cache / 2);
+    dev::db::setDatabaseCacheSize(options.evm_state_cache / 4);
     globalState = std::unique_ptr<QtumState>(new QtumState(dev::u256(0), QtumState::openDB(dirQtum, hashDB, dev::WithExisting::Trust), dirQtum, existsQtumstate));
     const CChainParams& chainparams = Params();
     dev::eth::ChainParams cp(chainparams.EVMGenesisInfo());
     globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+    pcallstatepool.reset(new CallStatePool());
+    g_mpos_script_window.Clear();
 
     pstorageresult.reset(new StorageResults(PathToString(qtumStateDir)));
     if (options.wipe_chainstate_db) {
@@ -184,6 +195,7 @@ static ChainstateLoadResult CompleteChainstateInitialization(
     {
         pstorageresult->wipeResults();
         chainman.m_blockman.m_block_tree_db->WipeHeightIndex();
+        chainman.m_blockman.m_block_tree_db->WipeLogIndex();
         fLogEvents = false;
         chainman.m_blockman.m_block_tree_db->WriteFlag("logevents", fLogEvents);
     }
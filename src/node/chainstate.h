@@ -39,6 +39,8 @@ struct ChainstateLoadOptions {
     bool record_log_opcodes{false};
     bool addrindex{false};
     bool logevents{false};
+    //! Memory for the EVM state databases and their shared trie node cache (bytes)
+    size_t evm_state_cache{0};
 };
 
 //! Chainstate load status. Simple applications can just check for the success
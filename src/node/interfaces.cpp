@@ -654,9 +654,8 @@ public:
         const CBlockIndex* index = chainman().m_blockman.LookupBlockIndex(block_hash);
         return GetLocator(index);
     }
-    std::map<COutPoint, uint32_t> getImmatureStakes() override
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> getImmatureStakes() override
     {
-        LOCK(cs_main);
         return GetImmatureStakes(chainman());
     }
     std::optional<int> findLocatorFork(const CBlockLocator& locator) override
@@ -36,6 +36,11 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <span>
+#include <thread>
 #include <utility>
 
 namespace node {
@@ -278,8 +283,13 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(bool fProofOfStak
     }
 
     //////////////////////////////////////////////////////// qtum
-    QtumDGP qtumDGP(globalState.get(), m_chainstate, fGettingValuesDGP);
-    globalSealEngine->setQtumSchedule(qtumDGP.getGasSchedule(nHeight));
+    // Contracts are executed on a private copy of the parent state, so neither
+    // rejected candidates nor the template itself touch globalState
+    g_assembly_exec_cache.Clear();
+    scratchState = std::make_unique<CallState>(*globalState, *globalSealEngine);
+    std::optional<CallStateScope> scratchScope(std::in_place, *scratchState);
+    QtumDGP qtumDGP(&scratchState->state(), m_chainstate, fGettingValuesDGP);
+    scratchState->sealEngine().setQtumSchedule(qtumDGP.getGasSchedule(nHeight));
     uint32_t blockSizeDGP = qtumDGP.getBlockSize(nHeight);
     minGasPrice = qtumDGP.getMinGasPrice(nHeight);
     if(gArgs.IsArgSet("-staker-min-tx-gas-price")) {
@@ -293,12 +303,13 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(bool fProofOfStak
 
     m_options.nBlockMaxWeight = blockSizeDGP ? blockSizeDGP * WITNESS_SCALE_FACTOR : m_options.nBlockMaxWeight;
     
-    dev::h256 oldHashStateRoot(globalState->rootHash());
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
     ////////////////////////////////////////////////// deploy offline staking contract
     if(nHeight == chainparams.GetConsensus().nOfflineStakeHeight){
-        globalState->deployDelegationsContract();
+        scratchState->state().deployDelegationsContract();
     }
+    // Candidates discard their nodes when rejected, so keep what the template already has
+    scratchState->state().db().stage();
+    scratchState->state().dbUtxo().stage();
     /////////////////////////////////////////////////
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
@@ -306,10 +317,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(bool fProofOfStak
         LOCK(m_mempool->cs);
         addPackageTxs(nPackagesSelected, nDescendantsUpdated, minGasPrice, pblock);
     }
-    pblock->hashStateRoot = uint256(h256Touint(dev::h256(globalState->rootHash())));
-    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(globalState->rootHashUTXO())));
-    globalState->setRoot(oldHashStateRoot);
-    globalState->setRootUTXO(oldHashUTXORoot);
+    pblock->hashStateRoot = uint256(h256Touint(dev::h256(scratchState->state().rootHash())));
+    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(scratchState->state().rootHashUTXO())));
+    // Keep the trie nodes of the template, so connecting it can reuse the recorded results
+    g_assembly_exec_cache.SetNodes(std::move(scratchState->state().db()), std::move(scratchState->state().dbUtxo()));
+    scratchScope.reset();
+    scratchState.reset();
 
     //this should already be populated by AddBlock in case of contracts, but if no contracts
     //then it won't get populated
@@ -499,8 +512,9 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         return false;
     }
     
-    dev::h256 oldHashStateRoot(globalState->rootHash());
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
+    QtumState& state = scratchState->state();
+    dev::h256 oldHashStateRoot(state.rootHash());
+    dev::h256 oldHashUTXORoot(state.rootHashUTXO());
     // operate on local vars first, then later apply to `this`
     uint64_t nBlockWeight = this->nBlockWeight;
     uint64_t nBlockSigOpsCost = this->nBlockSigOpsCost;
@@ -542,24 +556,30 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     ByteCodeExec exec(*pblock, qtumTransactions, hardBlockGasLimit, m_chainstate.m_chain.Tip(), m_chainstate.m_chain);
     if(!exec.performByteCode()){
         //error, don't add contract
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        state.setRoot(oldHashStateRoot);
+        state.setRootUTXO(oldHashUTXORoot);
+        state.db().discard();
+        state.dbUtxo().discard();
         LogPrintf("AttemptToAddContractToBlock(): Perform byte code fails for the contract tx %s\n", iter->GetTx().GetHash().ToString());
         return false;
     }
 
     ByteCodeExecResult testExecResult;
     if(!exec.processingResults(testExecResult)){
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        state.setRoot(oldHashStateRoot);
+        state.setRootUTXO(oldHashUTXORoot);
+        state.db().discard();
+        state.dbUtxo().discard();
         LogPrintf("AttemptToAddContractToBlock(): Processing results fails for the contract tx %s\n", iter->GetTx().GetHash().ToString());
         return false;
     }
 
     if(bceResult.usedGas + testExecResult.usedGas > softBlockGasLimit){
         // If this transaction could cause block gas limit to be exceeded, then don't add it
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        state.setRoot(oldHashStateRoot);
+        state.setRootUTXO(oldHashUTXORoot);
+        state.db().discard();
+        state.dbUtxo().discard();
         // Log if the contract is the only contract tx
         if(bceResult.usedGas == 0)
             LogPrintf("AttemptToAddContractToBlock(): The gas used is bigger than -staker-soft-block-gas-limit for the contract tx %s\n", iter->GetTx().GetHash().ToString());
@@ -598,13 +618,22 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     if (nBlockSigOpsCost * WITNESS_SCALE_FACTOR > (uint64_t)dgpMaxBlockSigOps ||
             nBlockWeight > dgpMaxBlockWeight) {
         //contract will not be added to block, so revert state to before we tried
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        state.setRoot(oldHashStateRoot);
+        state.setRootUTXO(oldHashUTXORoot);
+        state.db().discard();
+        state.dbUtxo().discard();
         return false;
     }
 
     //block is not too big, so apply the contract execution and it's results to the actual block
 
+    //record the execution, so it is not repeated when our own block is connected
+    AssemblyExecCache::Entry entry{ByteCodeExec::executionHash(qtumTransactions), exec.getResult(), testExecResult, state.rootHash(), state.rootHashUTXO()};
+    g_assembly_exec_cache.Add(oldHashStateRoot, oldHashUTXORoot, iter->GetTx().GetHash(), pblock->vtx.size(), exec.environmentHash(), std::move(entry));
+    // Only the nodes of accepted candidates are kept for connecting the block
+    state.db().stage();
+    state.dbUtxo().stage();
+
     //apply local bytecode to global bytecode state
     bceResult.usedGas += testExecResult.usedGas;
     bceResult.refundSender += testExecResult.refundSender;
@@ -1456,6 +1485,113 @@ public:
     bool delegate = false;
 };
 
+/**
+ * Long lived worker threads for the kernel search of a staker.
+ * A search is split in chunks that the workers and the calling thread claim
+ * one at a time, so the threads that finish early keep taking the work left
+ * instead of waiting for the slower ones.
+ */
+class StakeWorkerPool
+{
+public:
+    StakeWorkerPool(int numWorkers, const std::string& threadName)
+    {
+        m_threads.reserve(numWorkers);
+        for(int n = 0; n < numWorkers; n++)
+        {
+            m_threads.emplace_back([this, threadName, n]() {
+                util::ThreadRename(strprintf("%s.%i", threadName, n));
+                Loop();
+            });
+        }
+    }
+
+    ~StakeWorkerPool()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_worker_cv.notify_all();
+        for(std::thread& t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    StakeWorkerPool(const StakeWorkerPool&) = delete;
+    StakeWorkerPool& operator=(const StakeWorkerPool&) = delete;
+
+    // Call job for every chunk in [0, chunks) and return once all of them are done
+    void Run(size_t chunks, const std::function<void(size_t)>& job) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            m_job = &job;
+            m_chunks = chunks;
+            m_next = 0;
+            m_generation++;
+        }
+        m_worker_cv.notify_all();
+
+        Work(job, chunks);
+
+        WAIT_LOCK(m_mutex, lock);
+        while(m_active > 0)
+        {
+            m_done_cv.wait(lock);
+        }
+        m_job = nullptr;
+    }
+
+private:
+    void Work(const std::function<void(size_t)>& job, size_t chunks)
+    {
+        for(size_t chunk = m_next++; chunk < chunks; chunk = m_next++)
+        {
+            job(chunk);
+        }
+    }
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t generation = 0;
+        while(true)
+        {
+            const std::function<void(size_t)>* job = nullptr;
+            size_t chunks = 0;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                while(!m_stop && generation == m_generation)
+                {
+                    m_worker_cv.wait(lock);
+                }
+                if(m_stop) return;
+                generation = m_generation;
+
+                // The search may already be over when a worker wakes up late
+                if(!m_job) continue;
+                job = m_job;
+                chunks = m_chunks;
+                m_active++;
+            }
+
+            Work(*job, chunks);
+
+            LOCK(m_mutex);
+            if(--m_active == 0) m_done_cv.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    Mutex m_mutex;
+    std::condition_variable m_worker_cv;
+    std::condition_variable m_done_cv;
+    const std::function<void(size_t)>* m_job GUARDED_BY(m_mutex) = nullptr;
+    size_t m_chunks GUARDED_BY(m_mutex) = 0;
+    uint64_t m_generation GUARDED_BY(m_mutex) = 0;
+    int m_active GUARDED_BY(m_mutex) = 0;
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::atomic<size_t> m_next{0};
+};
+
 class StakeMinerPriv
 {
 public:
@@ -1471,7 +1607,8 @@ public:
     bool fAggressiveStaking = false;
     bool fError = false;
     int numThreads = 1;
-    boost::thread_group threads;
+    std::string threadName;
+    std::unique_ptr<StakeWorkerPool> workerPool;
     mutable RecursiveMutex cs_worker;
     bool privateKeysDisabled = false;;
 
@@ -1514,7 +1651,7 @@ public:
 
     {
         // Make this thread recognisable as the mining thread
-        std::string threadName = "qtumstake";
+        threadName = "qtumstake";
         if(pwallet && pwallet->GetName() != "")
         {
             threadName = threadName + "-" + pwallet->GetName();
@@ -1601,6 +1738,9 @@ public:
                 d->beginningTime &= ~d->stakeTimestampMask;
                 d->endingTime = d->beginningTime + nMaxStakeLookahead;
 
+                // Find the kernels for the whole window before trying to create a block
+                PrecomputeKernels();
+
                 for(uint32_t blockTime = d->beginningTime; blockTime < d->endingTime; blockTime += d->stakeTimestampMask+1)
                 {
                     // Update status bar
@@ -1622,8 +1762,8 @@ public:
                 }
             }
 
-            // Miner sleep before the next try
-            Sleep(nMinerSleep);
+            // Miner sleep before the next try, a new tip or new coins wake it up earlier
+            Wait(nMinerSleep);
         }
     }
 
@@ -1647,6 +1787,12 @@ protected:
         return SleepStaker(d->pwallet, milliseconds);
     }
 
+    bool Wait(uint64_t milliseconds)
+    {
+        d->pwallet->WaitStakerNotification(std::chrono::milliseconds{milliseconds});
+        return !d->pwallet->IsStakeClosing();
+    }
+
     bool IsStale(std::shared_ptr<CBlock> pblock)
     {
         if(d->pwallet->IsStakeClosing())
@@ -1692,7 +1838,9 @@ protected:
         blokTime &= ~d->stakeTimestampMask;
         if(!IsCachedDataOld() && d->endingTime >= blokTime)
         {
-            Sleep(100);
+            // Wait for the end of the searched window unless the tip or the coins change before
+            int64_t waitTime = (int64_t(d->endingTime) + d->stakeTimestampMask + 1) * 1000 - TicksSinceEpoch<std::chrono::milliseconds>(NodeClock::now());
+            Wait(std::clamp<int64_t>(waitTime, 1, nMinerSleep));
             return false;
         }
 
@@ -1723,7 +1871,7 @@ protected:
     bool IsCachedDataOld()
     {
         if(d->pwallet->IsStakeClosing()) return false;
-        if(d->pindexPrev == 0 || d->forceUpdate) return true;
+        if(d->pindexPrev == 0 || d->forceUpdate || d->pwallet->m_staker_coins_changed) return true;
         LOCK(cs_main);
         return d->pwallet->chain().getTip() != d->pindexPrev;
     }
@@ -1770,6 +1918,7 @@ protected:
         LOCK(d->pwallet->cs_wallet);
 
         d->clearCache();
+        d->pwallet->m_staker_coins_changed = false;
         const auto bal = wallet::GetBalance(*d->pwallet);
         CAmount nBalance = bal.m_mine_trusted;
         if(d->privateKeysDisabled) nBalance += bal.m_watchonly_trusted;
@@ -1857,23 +2006,19 @@ protected:
 
     void SloveBlock(uint32_t blockTime, size_t delegateSize, size_t from, size_t to)
     {
-        std::multimap<uint256, SolveItem> tmpSolvedBlock;
-        for(size_t i = from; i < to; i++)
-        {
-            const COutPoint &prevoutStake = d->prevouts[i];
-            uint256 hashProofOfStake;
-            if (CheckKernelCache(d->pindexPrev, d->pblock->nBits, blockTime, prevoutStake, d->pwallet->minerStakeCache, hashProofOfStake))
-            {
-                bool delegate = i < delegateSize;
-                tmpSolvedBlock.insert(std::make_pair(hashProofOfStake, SolveItem(prevoutStake, blockTime, delegate)));
-            }
-        }
+        std::vector<std::pair<size_t, uint256>> found;
+        CheckKernelCacheBatch(d->pindexPrev, d->pblock->nBits, blockTime, std::span<const COutPoint>(d->prevouts).subspan(from, to - from), d->pwallet->minerStakeCache, found);
 
-        if(tmpSolvedBlock.size() > 0)
+        if(found.size() > 0)
         {
             LOCK(d->cs_worker);
             d->mapSolveBlockTime[blockTime] = true;
-            d->mapSolvedBlock.insert(tmpSolvedBlock.begin(), tmpSolvedBlock.end());
+            for(const auto& [pos, hashProofOfStake] : found)
+            {
+                size_t i = from + pos;
+                bool delegate = i < delegateSize;
+                d->mapSolvedBlock.insert(std::make_pair(hashProofOfStake, SolveItem(d->prevouts[i], blockTime, delegate)));
+            }
         }
     }
 
@@ -1884,27 +2029,33 @@ protected:
         size_t delegateSize = d->setDelegateCoins.size();
 
         // Solve block
-        int numThreads = std::min(d->numThreads, (int)listSize);
-        if(listSize < 1000 || numThreads < 2)
+        if(listSize < STAKE_KERNEL_CHUNK_SIZE * 4 || d->numThreads < 2)
         {
             SloveBlock(blockTime, delegateSize, 0, listSize);
         }
         else
         {
-            size_t chunk = listSize / numThreads;
-            for(int i = 0; i < numThreads; i++)
+            if(!d->workerPool)
             {
-                size_t from = i * chunk;
-                size_t to = i == (numThreads -1) ? listSize : from + chunk;
-                d->threads.create_thread([this, blockTime, delegateSize, from, to]{SloveBlock(blockTime, delegateSize, from, to);});
+                d->workerPool = std::make_unique<StakeWorkerPool>(d->numThreads - 1, d->threadName);
             }
-            d->threads.join_all();
+            size_t chunks = (listSize + STAKE_KERNEL_CHUNK_SIZE - 1) / STAKE_KERNEL_CHUNK_SIZE;
+            d->workerPool->Run(chunks, [this, blockTime, delegateSize, listSize](size_t chunk) {
+                size_t from = chunk * STAKE_KERNEL_CHUNK_SIZE;
+                size_t to = std::min(from + STAKE_KERNEL_CHUNK_SIZE, listSize);
+                SloveBlock(blockTime, delegateSize, from, to);
+            });
         }
 
         // Populate the list with the potential solwed blocks
         for (auto it = d->mapSolvedBlock.begin(); it != d->mapSolvedBlock.end(); ++it)
         {
             const SolveItem& item = (*it).second;
+            if(item.blockTime != blockTime)
+            {
+                // Already added when its own block time was solved
+                continue;
+            }
             if(item.delegate)
             {
                 d->mapSolveDelegateCoins[item.blockTime].push_back(item.prevoutStake);
@@ -1916,6 +2067,21 @@ protected:
         }
     }
 
+    void PrecomputeKernels()
+    {
+        for(uint32_t blockTime = d->beginningTime; blockTime < d->endingTime; blockTime += d->stakeTimestampMask+1)
+        {
+            if(d->pwallet->IsStakeClosing() || IsCachedDataOld())
+                break;
+
+            if(d->mapSolveBlockTime.find(blockTime) == d->mapSolveBlockTime.end())
+            {
+                d->mapSolveBlockTime[blockTime] = false;
+                SloveBlock(blockTime);
+            }
+        }
+    }
+
     bool CanCreateBlock(const uint32_t& blockTime)
     {
         d->pblock->nTime = blockTime;
@@ -1994,8 +2160,11 @@ protected:
                         //or receiving more stale/orphan blocks than normal. Use at your own risk.
                         if(!Sleep(100)) break;
                     }else{
-                        //too early, so wait 3 seconds and try again
-                        if(!Sleep(nMinerWaitWalidBlock)) break;
+                        //too early, so wait until the timestamp becomes valid, at most 3 seconds, and try again
+                        //a new tip wakes the staker up to check if the block is stale
+                        int64_t validTime = d->pblockfilled->GetBlockTime() - FutureDrift(0, d->nHeight, d->consensusParams);
+                        int64_t waitTime = validTime * 1000 - TicksSinceEpoch<std::chrono::milliseconds>(NodeClock::now());
+                        if(!Wait(std::clamp<int64_t>(waitTime, 1, nMinerWaitWalidBlock))) break;
                     }
                     continue;
                 }
@@ -9,6 +9,7 @@
 #include <node/types.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <qtum/callstate.h>
 #include <txmempool.h>
 #include <util/feefrac.h>
 #include <validation.h>
@@ -74,6 +75,9 @@ static const int32_t STAKER_WAIT_FOR_BEST_BLOCK_HEADER = 250;
 //How much max time to wait for best block header to be downloaded to the blockchain
 static const int32_t DEFAULT_MAX_STAKER_WAIT_FOR_BEST_BLOCK_HEADER = 4000;
 
+//How many prevouts a staker thread checks at a time, the kernel search is split in chunks of this size
+static const size_t STAKE_KERNEL_CHUNK_SIZE = 256;
+
 //How much time to spend trying to process transactions when using the generate RPC call
 static const int32_t POW_MINER_MAX_TIME = 60;
 
@@ -282,6 +286,8 @@ public:
 #endif
 
 ///////////////////////////////////////////// // qtum
+    // Private copy of the parent state the template's contracts are executed on
+    std::unique_ptr<CallState> scratchState;
     ByteCodeExecResult bceResult;
     uint64_t minGasPrice = 1;
     uint64_t hardBlockGasLimit;
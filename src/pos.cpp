@@ -342,7 +342,22 @@ bool CheckBlockInputPubKeyMatchesOutputPubKey(const CBlock& block, CCoinsViewCac
     return true;
 }
 
-bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBlockHeader& block, CCoinsViewCache& view, Chainstate& chainstate) {
+HeaderSigners RecoverHeaderSigners(const CBlockHeader& block)
+{
+    HeaderSigners signers;
+    CPubKey pubkey;
+    if(!pubkey.RecoverCompact(block.GetHashWithoutSign(), block.GetBlockSignature()))
+        return signers;
+
+    signers.staker = pubkey.GetID();
+    if(block.HasProofOfDelegation() && !SignStr::GetKeyIdMessage(signers.staker.GetReverseHex(), block.GetProofOfDelegation(), signers.delegator))
+        return signers;
+
+    signers.fRecovered = true;
+    return signers;
+}
+
+bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBlockHeader& block, CCoinsViewCache& view, Chainstate& chainstate, const HeaderSigners* signers) {
     Coin coinPrev;
     if(!ViewGetCoin(view, block.prevoutStake, coinPrev)){
         if(!GetSpentCoinFromMainChain(pindexPrev, block.prevoutStake, &coinPrev, chainstate)) {
@@ -351,10 +366,7 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
         }
     }
 
-    uint256 hash = block.GetHashWithoutSign();
-    CPubKey pubkey;
     std::vector<unsigned char> vchBlockSig = block.GetBlockSignature();
-    std::vector<unsigned char> vchPoD = block.GetProofOfDelegation();
     bool hasDelegation = block.HasProofOfDelegation();
 
     if(vchBlockSig.empty()) {
@@ -365,32 +377,23 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
     // Recover the public key
     if (pindexPrev->nHeight + 1 >= Params().GetConsensus().nOfflineStakeHeight)
     {
-        // Recover the public key from compact signature
-        if(hasDelegation)
+        // Recover the public key from compact signature, unless the caller already did
+        HeaderSigners recovered;
+        if(!signers)
         {
-            // Has delegation
-            CTxDestination address;
-            TxoutType txType=TxoutType::NONSTANDARD;
-            if(pubkey.RecoverCompact(hash, vchBlockSig) &&
-                    ExtractDestination(coinPrev.out.scriptPubKey, address, &txType, true)){
-                if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
-                    if(SignStr::VerifyMessage(ToKeyID(std::get<PKHash>(address)), pubkey.GetID().GetReverseHex(), vchPoD)) {
-                        return true;
-                    }
-                }
-            }
+            recovered = RecoverHeaderSigners(block);
+            signers = &recovered;
         }
-        else
-        {
-            // No delegation
-            CTxDestination address;
-            TxoutType txType=TxoutType::NONSTANDARD;
-            if(pubkey.RecoverCompact(hash, vchBlockSig) &&
-                    ExtractDestination(coinPrev.out.scriptPubKey, address, &txType, true)){
-                if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
-                    if(pubkey.GetID() == ToKeyID(std::get<PKHash>(address))) {
-                        return true;
-                    }
+
+        CTxDestination address;
+        TxoutType txType=TxoutType::NONSTANDARD;
+        if(signers->fRecovered &&
+                ExtractDestination(coinPrev.out.scriptPubKey, address, &txType, true)){
+            if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
+                // With a delegation the coin owner signs the staker address, without one the owner signs the header
+                const CKeyID& signer = hasDelegation ? signers->delegator : signers->staker;
+                if(signer == ToKeyID(std::get<PKHash>(address))) {
+                    return true;
                 }
             }
         }
@@ -398,6 +401,8 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
     else
     {
         // Recover the public key from LowS signature
+        uint256 hash = block.GetHashWithoutSign();
+        CPubKey pubkey;
         for(uint8_t recid = 0; recid <= 3; ++recid) {
             for(uint8_t compressed = 0; compressed < 2; ++compressed) {
                 if(!pubkey.RecoverLaxDER(hash, vchBlockSig, recid, compressed)) {
@@ -482,6 +487,68 @@ bool CheckKernelCache(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTim
     return false;
 }
 
+void CheckKernelCacheBatch(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTimeBlock, std::span<const COutPoint> prevouts, const std::map<COutPoint, CStakeCache> &cache, std::vector<std::pair<size_t, uint256>>& found)
+{
+    // Same checks as CheckStakeKernelHash with the per block values computed once
+    int nHeight = pindexPrev->nHeight + 1;
+    bool fNoBNOverflow = nHeight >= Params().GetConsensus().nReduceBlocktimeHeight;
+    bool fLogKernel = LogInstance().WillLogCategory(BCLog::COINSTAKE);
+
+    arith_uint256 bnBaseTarget;
+    bnBaseTarget.SetCompact(nBits);
+
+    // The kernel is the stake modifier followed by 44 bytes that depend on the prevout,
+    // so the hasher with the stake modifier already written is copied for each of them
+    const uint256& nStakeModifier = pindexPrev->nStakeModifier;
+    CSHA256 modifierHasher;
+    modifierHasher.Write(nStakeModifier.begin(), nStakeModifier.size());
+
+    unsigned char kernel[44];
+    WriteLE32(kernel + 40, nTimeBlock);
+    for(size_t i = 0; i < prevouts.size(); i++)
+    {
+        const COutPoint& prevout = prevouts[i];
+        auto it = cache.find(prevout);
+        if(it == cache.end())
+            continue;
+
+        const CStakeCache& stake = it->second;
+        if(nTimeBlock < stake.blockFromTime) {
+            LogError("CheckStakeKernelHash() : nTime violation");
+            continue;
+        }
+
+        WriteLE32(kernel, stake.blockFromTime);
+        memcpy(kernel + 4, prevout.hash.begin(), 32);
+        WriteLE32(kernel + 36, prevout.n);
+
+        uint256 hashProofOfStake;
+        CSHA256(modifierHasher).Write(kernel, sizeof(kernel)).Finalize(hashProofOfStake.begin());
+        CSHA256().Write(hashProofOfStake.begin(), CSHA256::OUTPUT_SIZE).Finalize(hashProofOfStake.begin());
+
+        arith_uint256 bnWeight = arith_uint256(stake.amount);
+        arith_uint256 bnProofOfStake = UintToArith256(hashProofOfStake);
+        if(fNoBNOverflow) {
+            bnProofOfStake /= bnWeight;
+            if (bnProofOfStake > bnBaseTarget)
+                continue;
+        } else {
+            if (bnProofOfStake > bnBaseTarget * bnWeight)
+                continue;
+        }
+
+        if (fLogKernel)
+        {
+            LogPrintf("CheckStakeKernelHash() : check modifier=%s nTimeBlockFrom=%u nPrevout=%u nTimeBlock=%u hashProof=%s\n",
+                nStakeModifier.GetHex().c_str(),
+                stake.blockFromTime, prevout.n, nTimeBlock,
+                hashProofOfStake.ToString());
+        }
+
+        found.emplace_back(i, hashProofOfStake);
+    }
+}
+
 void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view){
     if(cache.find(prevout) != cache.end()){
         //already in cache
@@ -510,29 +577,47 @@ void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevo
 /**
  * Proof-of-stake functions needed in the wallet but wallet independent
  */
-struct BlockScript{
-    CScript stakerScript;
-    CScript delegateScript;
-    uint8_t fee;
-    bool hasDelegate;
-
-    BlockScript(const CScript& _stakerScript = CScript()):
-        stakerScript(_stakerScript),
-        fee(0),
-        hasDelegate(false)
-    {}
-};
-
-struct ScriptsElement{
-    BlockScript script;
-    uint256 hash;
-};
+MPoSScriptWindow g_mpos_script_window;
 
-/**
- * Cache of the recent mpos scripts for the block reward recipients
- * The max size of the map is 2 * nCacheScripts - nMPoSRewardRecipients, so in this case it is 20
- */
-std::map<int, ScriptsElement> scriptsMap;
+void MPoSScriptWindow::Connect(const CBlockIndex* pindex, const BlockScript& script, const Consensus::Params& consensusParams)
+{
+    LOCK(m_mutex);
+    if (m_slots.empty()) {
+        // The recipients of a block are the stakers of the blocks just past coinbase maturity
+        int maturity = std::max(consensusParams.nCoinbaseMaturity, consensusParams.nRBTCoinbaseMaturity);
+        m_slots.resize(maturity + consensusParams.nMPoSRewardRecipients + 1);
+    }
+    Slot& slot = m_slots[pindex->nHeight % m_slots.size()];
+    slot.height = pindex->nHeight;
+    slot.hash = pindex->GetBlockHash();
+    slot.script = script;
+}
+
+void MPoSScriptWindow::Disconnect(const CBlockIndex* pindex)
+{
+    LOCK(m_mutex);
+    if (m_slots.empty()) return;
+    Slot& slot = m_slots[pindex->nHeight % m_slots.size()];
+    if (slot.height == pindex->nHeight) {
+        slot.height = -1;
+    }
+}
+
+bool MPoSScriptWindow::Get(const CBlockIndex* pindex, BlockScript& script) const
+{
+    LOCK(m_mutex);
+    if (m_slots.empty()) return false;
+    const Slot& slot = m_slots[pindex->nHeight % m_slots.size()];
+    if (slot.height != pindex->nHeight || slot.hash != pindex->GetBlockHash()) return false;
+    script = slot.script;
+    return true;
+}
+
+void MPoSScriptWindow::Clear()
+{
+    LOCK(m_mutex);
+    m_slots.clear();
+}
 
 unsigned int GetStakeMaxCombineInputs() { return 100; }
 
@@ -584,64 +669,35 @@ bool GetDelegationFeeFromContract(const uint160& address, uint8_t& fee, Chainsta
     return ret;
 }
 
-bool NeedToEraseScriptFromCache(int nBlockHeight, int nCacheScripts, int nScriptHeight, const ScriptsElement& scriptElement, CChain& chain)
-{
-    // Erase element from cache if not in range [nBlockHeight - nCacheScripts, nBlockHeight + nCacheScripts]
-    if(nScriptHeight < (nBlockHeight - nCacheScripts) ||
-            nScriptHeight > (nBlockHeight + nCacheScripts))
-        return true;
-
-    // Erase element from cache if hash different
-    CBlockIndex* pblockindex = chain[nScriptHeight];
-    if(pblockindex && pblockindex->GetBlockHash() != scriptElement.hash)
-        return true;
-
-    return false;
-}
-
-void CleanScriptCache(int nHeight, const Consensus::Params &consensusParams, CChain& chain)
+BlockScript MakeMPoSScript(const uint160& stakeAddress, const uint160* delegateAddress, uint8_t fee)
 {
-    int nCacheScripts = consensusParams.nMPoSRewardRecipients * 1.5;
-
-    // Remove the scripts from cache that are not used
-    for (std::map<int, ScriptsElement>::iterator it=scriptsMap.begin(); it!=scriptsMap.end();){
-        if(NeedToEraseScriptFromCache(nHeight, nCacheScripts, it->first, it->second, chain))
-        {
-            it = scriptsMap.erase(it);
-        }
-        else{
-            it++;
-        }
+    BlockScript blockScript;
+    if(stakeAddress == uint160())
+    {
+        LogDebug(BCLog::COINSTAKE, "Fail to solve script for mpos reward recipient\n");
+        //This should never fail, but in case it somehow did we don't want it to bring the network to a halt
+        //So, use an OP_RETURN script to burn the coins for the unknown staker
+        blockScript = CScript() << OP_RETURN;
+    }else{
+        // Make public key hash script
+        blockScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(stakeAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
     }
-}
-
-bool ReadFromScriptCache(BlockScript &script, CBlockIndex* pblockindex, int nHeight, const Consensus::Params &consensusParams, CChain& chain)
-{
-    CleanScriptCache(nHeight, consensusParams, chain);
 
-    // Find the script in the cache
-    std::map<int, ScriptsElement>::iterator it = scriptsMap.find(nHeight);
-    if(it != scriptsMap.end())
+    if(delegateAddress)
     {
-        if(it->second.hash == pblockindex->GetBlockHash())
+        if(*delegateAddress == uint160())
         {
-            script = it->second.script;
-            return true;
+            LogDebug(BCLog::COINSTAKE, "Fail to solve script for mpos delegate reward recipient\n");
+            blockScript.delegateScript = CScript() << OP_RETURN;
+        }else{
+            // Make public key hash script
+            blockScript.delegateScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(*delegateAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
         }
-    }
-
-    return false;
-}
 
-void AddToScriptCache(BlockScript script, CBlockIndex* pblockindex, int nHeight, const Consensus::Params &consensusParams, CChain& chain)
-{
-    CleanScriptCache(nHeight, consensusParams, chain);
-
-    // Add the script into the cache
-    ScriptsElement listElement;
-    listElement.script = script;
-    listElement.hash = pblockindex->GetBlockHash();
-    scriptsMap.insert(std::pair<int, ScriptsElement>(nHeight, listElement));
+        blockScript.fee = fee;
+        blockScript.hasDelegate = true;
+    }
+    return blockScript;
 }
 
 bool AddMPoSScript(std::vector<BlockScript> &mposScriptList, int nHeight, const Consensus::Params &consensusParams, CChain& chain, node::BlockManager& blockman)
@@ -654,9 +710,9 @@ bool AddMPoSScript(std::vector<BlockScript> &mposScriptList, int nHeight, const
         return false;
     }
 
-    // Try find the script from the cache
+    // Try find the script from the window of recent blocks
     BlockScript blockScript;
-    if(ReadFromScriptCache(blockScript, pblockindex, nHeight, consensusParams, chain))
+    if(g_mpos_script_window.Get(pblockindex, blockScript))
     {
         mposScriptList.push_back(blockScript);
         return true;
@@ -671,43 +727,19 @@ bool AddMPoSScript(std::vector<BlockScript> &mposScriptList, int nHeight, const
     // The block reward for PoS is in the second transaction (coinstake) and the second or third output
     if(pblockindex->IsProofOfStake())
     {
-        if(stakeAddress == uint160())
-        {
-            LogDebug(BCLog::COINSTAKE, "Fail to solve script for mpos reward recipient\n");
-            //This should never fail, but in case it somehow did we don't want it to bring the network to a halt
-            //So, use an OP_RETURN script to burn the coins for the unknown staker
-            blockScript = CScript() << OP_RETURN;
-        }else{
-            // Make public key hash script
-            blockScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(stakeAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
-        }
-
-        if(pblockindex->HasProofOfDelegation())
-        {
-            uint160 delegateAddress;
-            uint8_t fee;
-            if(!blockman.m_block_tree_db->ReadDelegateIndex(nHeight, delegateAddress, fee)){
-                return false;
-            }
-
-            if(delegateAddress == uint160())
-            {
-                LogDebug(BCLog::COINSTAKE, "Fail to solve script for mpos delegate reward recipient\n");
-                blockScript.delegateScript = CScript() << OP_RETURN;
-            }else{
-                // Make public key hash script
-                blockScript.delegateScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(delegateAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
-            }
-
-            blockScript.fee = fee;
-            blockScript.hasDelegate = true;
+        uint160 delegateAddress;
+        uint8_t fee = 0;
+        bool hasDelegate = pblockindex->HasProofOfDelegation();
+        if(hasDelegate && !blockman.m_block_tree_db->ReadDelegateIndex(nHeight, delegateAddress, fee)){
+            return false;
         }
+        blockScript = MakeMPoSScript(stakeAddress, hasDelegate ? &delegateAddress : nullptr, fee);
 
         // Add the script into the list
         mposScriptList.push_back(blockScript);
 
-        // Update script cache
-        AddToScriptCache(blockScript, pblockindex, nHeight, consensusParams, chain);
+        // Blocks connected before startup are not in the window yet
+        g_mpos_script_window.Connect(pblockindex, blockScript, consensusParams);
     }
     else
     {
@@ -911,8 +943,8 @@ bool CheckTieredProofOfStake(CBlockIndex* pindexPrev, BlockValidationState& stat
     trust::TrustTier tier = trustManager.GetValidatorTier(validatorId);
     if (tier == trust::TrustTier::NONE) {
         // Check if validator is registered but just doesn't meet uptime requirements
-        const trust::ValidatorInfo* info = trustManager.GetValidator(validatorId);
-        if (info == nullptr) {
+        std::optional<trust::ValidatorInfo> info = trustManager.GetValidator(validatorId);
+        if (!info) {
             return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "validator-not-registered",
                                 "CheckTieredProofOfStake(): Validator is not registered");
         }
@@ -17,6 +17,8 @@
 #include <qtum/posutils.h>
 #include <trust/trustscore.h>
 
+#include <span>
+
 void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view);
 
 // Compute the hash modifier for proof-of-stake
@@ -40,8 +42,21 @@ inline bool CheckCoinStakeTimestamp(uint32_t nTimeBlock, int nHeight, const Cons
 // Since it is only used in ConnectBlock, we know that we have access to the full contextual utxo set
 bool CheckBlockInputPubKeyMatchesOutputPubKey(const CBlock& block, CCoinsViewCache& view, bool delegateOutputExist);
 
+// Keys that signed a proof of stake header and its proof of delegation
+struct HeaderSigners
+{
+    bool fRecovered = false;
+    CKeyID staker;
+    CKeyID delegator;
+};
+
+// Recover the keys from the compact signatures of a header
+// Depends only on the header, so it can run on any thread without cs_main
+HeaderSigners RecoverHeaderSigners(const CBlockHeader& block);
+
 // Recover the pubkey and check that it matches the prevoutStake's scriptPubKey.
-bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBlockHeader& block, CCoinsViewCache& view, Chainstate& chainstate);
+// Uses the signers if they were already recovered from the header
+bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBlockHeader& block, CCoinsViewCache& view, Chainstate& chainstate, const HeaderSigners* signers = nullptr);
 
 // Wrapper around CheckStakeKernelHash()
 // Also checks existence of kernel input and min age
@@ -50,6 +65,11 @@ bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBloc
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const std::map<COutPoint, CStakeCache>& cache, Chainstate& chainstate);
 bool CheckKernelCache(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, const std::map<COutPoint, CStakeCache>& cache, uint256& hashProofOfStake);
 
+// Check the kernels of many cached prevouts for the same block
+// The stake modifier, target and hasher state are prepared once for the batch
+// Appends the positions in prevouts of the kernels that meet the target together with their proof hashes
+void CheckKernelCacheBatch(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, std::span<const COutPoint> prevouts, const std::map<COutPoint, CStakeCache>& cache, std::vector<std::pair<size_t, uint256>>& found);
+
 unsigned int GetStakeMaxCombineInputs();
 
 int64_t GetStakeCombineThreshold();
@@ -66,6 +86,53 @@ unsigned int GetStakeSplitOutputs();
 
 int64_t GetStakeSplitThreshold();
 
+struct BlockScript{
+    CScript stakerScript;
+    CScript delegateScript;
+    uint8_t fee;
+    bool hasDelegate;
+
+    BlockScript(const CScript& _stakerScript = CScript()):
+        stakerScript(_stakerScript),
+        fee(0),
+        hasDelegate(false)
+    {}
+};
+
+/**
+ * Ring buffer of the MPoS reward recipient scripts of the blocks in the active chain,
+ * one slot per height, deep enough to cover the blocks past coinbase maturity that
+ * receive a share of the next block reward. Slots are filled when blocks are connected
+ * and cleared when they are disconnected, so building the MPoS outputs reads no index.
+ */
+class MPoSScriptWindow
+{
+public:
+    void Connect(const CBlockIndex* pindex, const BlockScript& script, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Disconnect(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Script of the block if its slot still holds it */
+    bool Get(const CBlockIndex* pindex, BlockScript& script) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Slot {
+        int height{-1};
+        uint256 hash;
+        BlockScript script;
+    };
+
+    mutable Mutex m_mutex;
+    std::vector<Slot> m_slots GUARDED_BY(m_mutex);
+};
+
+extern MPoSScriptWindow g_mpos_script_window;
+
+/** Reward recipient scripts for a staker and the delegate, if the block has one */
+BlockScript MakeMPoSScript(const uint160& stakeAddress, const uint160* delegateAddress, uint8_t fee);
+
 bool GetMPoSOutputs(std::vector<CTxOut>& mposOutputList, int64_t nRewardPiece, int nHeight, const Consensus::Params& consensusParams, CChain& chain, node::BlockManager& blockman);
 
 bool CreateMPoSOutputs(CMutableTransaction& txNew, int64_t nRewardPiece, int nHeight, const Consensus::Params& consensusParams, CChain& chain, node::BlockManager& blockman);
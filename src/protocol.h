@@ -296,6 +296,41 @@ inline constexpr const char* VALIDATORS{"validators"};
  */
 inline constexpr const char* REGVALIDATOR{"regvalidator"};
 
+/**
+ * The sendtrustv2 message signals support for receiving HEARTBEATV2 and
+ * VALIDATORSV2 messages. Like sendaddrv2 it must be sent between VERSION
+ * and VERACK.
+ * @since WATTx protocol version 2.
+ */
+inline constexpr const char* SENDTRUSTV2{"sendtrustv2"};
+
+/**
+ * The heartbeatv2 message is a heartbeat in the compact encoding.
+ * @since WATTx protocol version 2.
+ */
+inline constexpr const char* HEARTBEATV2{"heartbeatv2"};
+
+/**
+ * The validatorsv2 message is a validator list in the compact encoding.
+ * @since WATTx protocol version 2.
+ */
+inline constexpr const char* VALIDATORSV2{"validatorsv2"};
+
+/**
+ * The getvalsync message asks a peer for the validator set entries we are
+ * missing, either as changes since an epoch of the peer's change set or by
+ * reconciling a minisketch of our active validator IDs. Only sent to peers
+ * that signalled sendtrustv2.
+ * @since WATTx protocol version 2.
+ */
+inline constexpr const char* GETVALSYNC{"getvalsync"};
+
+/**
+ * The valsync message answers a getvalsync message.
+ * @since WATTx protocol version 2.
+ */
+inline constexpr const char* VALSYNC{"valsync"};
+
 }; // namespace NetMsgType
 
 /** All known message types (see above). Keep this in the same order as the list of messages above. */
@@ -340,6 +375,11 @@ inline const std::array ALL_NET_MESSAGE_TYPES{std::to_array<std::string>({
     NetMsgType::GETVALIDATORS,
     NetMsgType::VALIDATORS,
     NetMsgType::REGVALIDATOR,
+    NetMsgType::SENDTRUSTV2,
+    NetMsgType::HEARTBEATV2,
+    NetMsgType::VALIDATORSV2,
+    NetMsgType::GETVALSYNC,
+    NetMsgType::VALSYNC,
 })};
 
 /** nServices flags */
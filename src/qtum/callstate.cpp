@@ -0,0 +1,83 @@
+#include <qtum/callstate.h>
+
+#include <chain.h>
+#include <util/check.h>
+#include <util/convert.h>
+#include <validation.h>
+
+std::unique_ptr<CallStatePool> pcallstatepool;
+
+// Execution state installed on this thread
+static thread_local CallState* t_callState{nullptr};
+
+CallState::CallState(QtumState const& _state, dev::eth::SealEngineFace const& _sealEngine) :
+    m_state(std::make_unique<QtumState>(_state.db(), _state.dbUtxo())),
+    m_sealEngine(dev::eth::SealEngineRegistrar::create(_sealEngine.chainParams()))
+{
+    m_state->setRoot(_state.rootHash());
+    m_state->setRootUTXO(_state.rootHashUTXO());
+    m_sealEngine->setQtumSchedule(_sealEngine.getQtumSchedule());
+}
+
+void CallState::pin(CBlockIndex* _block, dev::eth::EVMSchedule const& _schedule)
+{
+    m_state->setRoot(uintToh256(_block->hashStateRoot));
+    m_state->setRootUTXO(uintToh256(_block->hashUTXORoot));
+    m_sealEngine->setQtumSchedule(_schedule);
+    m_sealEngine->deleteAddresses.clear();
+    m_block = _block;
+}
+
+CallStateScope::CallStateScope(CallState& _callState)
+{
+    Assert(!t_callState);
+    t_callState = &_callState;
+}
+
+CallStateScope::~CallStateScope()
+{
+    t_callState = nullptr;
+}
+
+CallStatePool::Lease::Lease(CallStatePool& _pool, std::unique_ptr<CallState> _callState) :
+    m_pool(_pool), m_callState(std::move(_callState))
+{
+    m_scope.emplace(*m_callState);
+}
+
+CallStatePool::Lease::~Lease()
+{
+    m_scope.reset();
+    m_pool.release(std::move(m_callState));
+}
+
+std::unique_ptr<CallStatePool::Lease> CallStatePool::acquire(CBlockIndex* block)
+{
+    AssertLockHeld(::cs_main);
+
+    std::unique_ptr<CallState> callState;
+    {
+        LOCK(m_mutex);
+        if (!m_idle.empty()) {
+            callState = std::move(m_idle.back());
+            m_idle.pop_back();
+        }
+    }
+    if (!callState) {
+        callState = std::make_unique<CallState>(*globalState, *globalSealEngine);
+    }
+    callState->pin(block, globalSealEngine->getQtumSchedule());
+    return std::make_unique<Lease>(*this, std::move(callState));
+}
+
+CallState* CallStatePool::current()
+{
+    return t_callState;
+}
+
+void CallStatePool::release(std::unique_ptr<CallState> callState)
+{
+    // At most one state per thread that executed a call concurrently is kept
+    LOCK(m_mutex);
+    m_idle.push_back(std::move(callState));
+}
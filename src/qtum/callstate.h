@@ -0,0 +1,117 @@
+#ifndef QTUM_CALLSTATE_H
+#define QTUM_CALLSTATE_H
+
+#include <kernel/cs_main.h>
+#include <qtum/qtumstate.h>
+#include <sync.h>
+#include <threadsafety.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+class CBlockIndex;
+
+/**
+ * Private EVM state for executing contracts without touching globalState.
+ * It shares the LevelDB instances of globalState but has its own trie
+ * overlay, caches and seal engine. It starts at the current roots of
+ * globalState and can be pinned to the state roots of another block.
+ */
+class CallState{
+
+public:
+
+    CallState(QtumState const& _state, dev::eth::SealEngineFace const& _sealEngine);
+
+    CallState(const CallState&) = delete;
+    CallState& operator=(const CallState&) = delete;
+
+    void pin(CBlockIndex* _block, dev::eth::EVMSchedule const& _schedule);
+
+    QtumState& state() { return *m_state; }
+
+    dev::eth::SealEngineFace& sealEngine() { return *m_sealEngine; }
+
+    CBlockIndex* block() const { return m_block; }
+
+private:
+
+    std::unique_ptr<QtumState> m_state;
+
+    std::unique_ptr<dev::eth::SealEngineFace> m_sealEngine;
+
+    CBlockIndex* m_block{nullptr};
+};
+
+/**
+ * Installs a call state as the execution state of the calling thread, so
+ * CallContract and ByteCodeExec run against it instead of globalState
+ */
+class CallStateScope{
+
+public:
+
+    explicit CallStateScope(CallState& _callState);
+    ~CallStateScope();
+
+    CallStateScope(const CallStateScope&) = delete;
+    CallStateScope& operator=(const CallStateScope&) = delete;
+};
+
+/**
+ * Pool of call states shared by the RPC threads. A leased state is installed
+ * as the execution state of the calling thread, so CallContract runs against
+ * it instead of globalState until the lease is released.
+ */
+class CallStatePool{
+
+public:
+
+    class Lease{
+
+    public:
+
+        Lease(CallStatePool& _pool, std::unique_ptr<CallState> _callState);
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        QtumState& state() { return m_callState->state(); }
+
+        CBlockIndex* block() const { return m_callState->block(); }
+
+    private:
+
+        CallStatePool& m_pool;
+
+        std::unique_ptr<CallState> m_callState;
+
+        std::optional<CallStateScope> m_scope;
+    };
+
+    /**
+     * Lease a call state pinned to the given block. Taking cs_main is only
+     * needed to read the current seal engine schedule and database overlays;
+     * execution with the lease does not require it.
+     */
+    std::unique_ptr<Lease> acquire(CBlockIndex* block) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * Execution state installed on the calling thread, or nullptr if there is none
+     */
+    static CallState* current();
+
+private:
+
+    void release(std::unique_ptr<CallState> callState);
+
+    Mutex m_mutex;
+
+    std::vector<std::unique_ptr<CallState>> m_idle GUARDED_BY(m_mutex);
+};
+
+extern std::unique_ptr<CallStatePool> pcallstatepool;
+
+#endif // QTUM_CALLSTATE_H
@@ -17,12 +17,17 @@ QtumState::QtumState(u256 const& _accountStartNonce, OverlayDB const& _db, const
 	        stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+QtumState::QtumState(OverlayDB const& _db, OverlayDB const& _dbUTXO) :
+        State(u256(0), _db, BaseState::PreExisting), dbUTXO(_dbUTXO) {
+    stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
+}
+
 QtumState::QtumState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev::eth::BaseState::PreExisting) {
     dbUTXO = OverlayDB();
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
-ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, CChain& _chain, Permanence _p, OnOpFunc const& _onOp){
+ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, int _chainHeight, Permanence _p, OnOpFunc const& _onOp){
 
     assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
 
@@ -60,7 +65,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         startGasUsed = _envInfo.gasUsed();
         if (!e.execute()){
             e.go(onOp);
-            if(_chain.Height() >= consensusParams.QIP7Height){
+            if(_chainHeight >= consensusParams.QIP7Height){
             	validateTransfersWithChangeLog();
             }
         } else {
@@ -99,7 +104,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         printfErrorLog(dev::eth::toTransactionException(_e));
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
-        if(_chain.Height() < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
+        if(_chainHeight < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
             deleteAccounts(_sealEngine.deleteAddresses);
             commit(CommitBehaviour::RemoveEmptyAccounts);
         } else {
@@ -320,7 +325,7 @@ void QtumState::deployDelegationsContract(){
         QtumState::createContract(delegationsAddress);
         QtumState::setCode(delegationsAddress, bytes{fromHex(DELEGATIONS_CONTRACT_CODE)}, QtumState::version(delegationsAddress));
         commit(CommitBehaviour::RemoveEmptyAccounts);
-        db().commit();
+        db().stage();
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -86,8 +86,8 @@ dev::Address qtumutils::eth_getHistoryStorageAddress()
 
 qtumutils::HistoricalHashes &qtumutils::HistoricalHashes::instance()
 {
-    // Get instance
-    static qtumutils::HistoricalHashes _instance;
+    // Get instance, one per thread so contract calls can run in parallel with validation
+    static thread_local qtumutils::HistoricalHashes _instance;
     return _instance;
 }
 
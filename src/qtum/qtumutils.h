@@ -59,7 +59,7 @@ class HistoricalHashes
 public:
     /**
      * @brief instance Get instance from the historical hashages storage
-     * @return Instance of the storage
+     * @return Instance of the storage for the calling thread
      */
     static HistoricalHashes& instance();
 
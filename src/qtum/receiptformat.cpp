@@ -0,0 +1,348 @@
+#include <qtum/receiptformat.h>
+
+#include <crypto/common.h>
+
+#include <cstring>
+
+namespace {
+
+// Offsets of the fixed fields of a receipt
+constexpr size_t BLOCK_HASH = 0;
+constexpr size_t BLOCK_NUMBER = BLOCK_HASH + 32;
+constexpr size_t TRANSACTION_HASH = BLOCK_NUMBER + 4;
+constexpr size_t TRANSACTION_INDEX = TRANSACTION_HASH + 32;
+constexpr size_t FROM = TRANSACTION_INDEX + 4;
+constexpr size_t TO = FROM + 20;
+constexpr size_t CUMULATIVE_GAS_USED = TO + 20;
+constexpr size_t GAS_USED = CUMULATIVE_GAS_USED + 8;
+constexpr size_t CONTRACT_ADDRESS = GAS_USED + 8;
+constexpr size_t EXCEPTED = CONTRACT_ADDRESS + 20;
+constexpr size_t OUTPUT_INDEX = EXCEPTED + 4;
+constexpr size_t BLOOM = OUTPUT_INDEX + 4;
+constexpr size_t STATE_ROOT = BLOOM + 256;
+constexpr size_t UTXO_ROOT = STATE_ROOT + 32;
+constexpr size_t RECEIPT_FIXED_SIZE = UTXO_ROOT + 32;
+
+// Offsets inside a log
+constexpr size_t LOG_TOPIC_COUNT = 20;
+constexpr size_t LOG_TOPICS = LOG_TOPIC_COUNT + 4;
+
+template <typename Hash>
+Hash ReadHash(std::span<const uint8_t> data, size_t pos)
+{
+    return Hash(dev::bytesConstRef(data.data() + pos, Hash::size));
+}
+
+uint32_t Read32(std::span<const uint8_t> data, size_t pos)
+{
+    return ReadLE32(data.data() + pos);
+}
+
+class Writer{
+
+public:
+
+    explicit Writer(std::vector<uint8_t>& _out) : out(_out) {}
+
+    size_t pos() const { return out.size(); }
+
+    void write32(uint32_t x) { uint8_t b[4]; WriteLE32(b, x); write(b, 4); }
+
+    void write64(uint64_t x) { uint8_t b[8]; WriteLE64(b, x); write(b, 8); }
+
+    void write(const uint8_t* data, size_t size) { out.insert(out.end(), data, data + size); }
+
+    template <unsigned N>
+    void write(dev::FixedHash<N> const& hash) { write(hash.data(), N); }
+
+    void write(uint256 const& hash) { write(hash.begin(), hash.size()); }
+
+    void writeBytes(const uint8_t* data, size_t size) { write32(size); write(data, size); }
+
+    void set32(size_t at, uint32_t x) { WriteLE32(out.data() + at, x); }
+
+private:
+
+    std::vector<uint8_t>& out;
+};
+
+// Bounds checked reading used to validate a value before it is viewed
+class Reader{
+
+public:
+
+    Reader(std::span<const uint8_t> _data, size_t _pos) : data(_data), pos(_pos) {}
+
+    bool skip(size_t size)
+    {
+        if (size > data.size() - std::min(pos, data.size())) return false;
+        pos += size;
+        return true;
+    }
+
+    bool read32(uint32_t& x)
+    {
+        if (pos > data.size() || data.size() - pos < 4) return false;
+        x = Read32(data, pos);
+        pos += 4;
+        return true;
+    }
+
+    bool skipBytes()
+    {
+        uint32_t size;
+        return read32(size) && skip(size);
+    }
+
+    size_t position() const { return pos; }
+
+private:
+
+    std::span<const uint8_t> data;
+
+    size_t pos;
+};
+
+bool ValidateLog(std::span<const uint8_t> receipt, size_t start, size_t end)
+{
+    Reader reader(receipt.first(end), start);
+    uint32_t topics;
+    return reader.skip(20) && reader.read32(topics) && reader.skip(size_t(topics) * 32) && reader.skipBytes();
+}
+
+bool ValidateReceipt(std::span<const uint8_t> receipt)
+{
+    Reader reader(receipt, RECEIPT_FIXED_SIZE);
+    uint32_t logs;
+    if (receipt.size() < RECEIPT_FIXED_SIZE || !reader.read32(logs) || size_t(logs) > receipt.size() / 4) return false;
+    std::vector<uint32_t> offsets(logs + 1);
+    for (uint32_t& offset : offsets) {
+        if (!reader.read32(offset)) return false;
+    }
+    if (!reader.skipBytes()) return false;
+    size_t end = reader.position();
+    for (size_t i = 0; i < logs; i++) {
+        if (offsets[i] != end || offsets[i + 1] < offsets[i] || offsets[i + 1] > receipt.size() || !ValidateLog(receipt, offsets[i], offsets[i + 1])) return false;
+        end = offsets[i + 1];
+    }
+    if (offsets[logs] != end) return false;
+
+    reader = Reader(receipt, end);
+    uint32_t created, destructed;
+    if (!reader.read32(created)) return false;
+    for (size_t i = 0; i < created; i++) {
+        if (!reader.skip(20) || !reader.skipBytes()) return false;
+    }
+    return reader.read32(destructed) && reader.skip(size_t(destructed) * 20) && reader.position() == receipt.size();
+}
+
+} // namespace
+
+dev::Address ReceiptLogView::address() const
+{
+    return ReadHash<dev::Address>(data, 0);
+}
+
+size_t ReceiptLogView::topicCount() const
+{
+    return Read32(data, LOG_TOPIC_COUNT);
+}
+
+dev::h256 ReceiptLogView::topic(size_t i) const
+{
+    return ReadHash<dev::h256>(data, LOG_TOPICS + i * 32);
+}
+
+bool ReceiptLogView::topicEquals(size_t i, dev::h256 const& _topic) const
+{
+    return i < topicCount() && std::memcmp(data.data() + LOG_TOPICS + i * 32, _topic.data(), 32) == 0;
+}
+
+std::span<const uint8_t> ReceiptLogView::logData() const
+{
+    size_t pos = LOG_TOPICS + topicCount() * 32;
+    return data.subspan(pos + 4, Read32(data, pos));
+}
+
+dev::eth::LogEntry ReceiptLogView::materialize() const
+{
+    dev::h256s topics;
+    topics.reserve(topicCount());
+    for (size_t i = 0; i < topicCount(); i++) {
+        topics.push_back(topic(i));
+    }
+    std::span<const uint8_t> bytes = logData();
+    return dev::eth::LogEntry(address(), topics, dev::bytes(bytes.begin(), bytes.end()));
+}
+
+uint256 ReceiptView::blockHash() const
+{
+    return uint256(data.subspan(BLOCK_HASH, 32));
+}
+
+uint32_t ReceiptView::blockNumber() const
+{
+    return Read32(data, BLOCK_NUMBER);
+}
+
+uint256 ReceiptView::transactionHash() const
+{
+    return uint256(data.subspan(TRANSACTION_HASH, 32));
+}
+
+size_t ReceiptView::logCount() const
+{
+    return Read32(data, RECEIPT_FIXED_SIZE);
+}
+
+ReceiptLogView ReceiptView::log(size_t i) const
+{
+    size_t offsets = RECEIPT_FIXED_SIZE + 4;
+    uint32_t start = Read32(data, offsets + i * 4);
+    uint32_t end = Read32(data, offsets + (i + 1) * 4);
+    return ReceiptLogView(data.subspan(start, end - start));
+}
+
+TransactionReceiptInfo ReceiptView::materialize() const
+{
+    TransactionReceiptInfo tri{};
+    tri.blockHash = blockHash();
+    tri.blockNumber = blockNumber();
+    tri.transactionHash = transactionHash();
+    tri.transactionIndex = Read32(data, TRANSACTION_INDEX);
+    tri.from = ReadHash<dev::Address>(data, FROM);
+    tri.to = ReadHash<dev::Address>(data, TO);
+    tri.cumulativeGasUsed = ReadLE64(data.data() + CUMULATIVE_GAS_USED);
+    tri.gasUsed = ReadLE64(data.data() + GAS_USED);
+    tri.contractAddress = ReadHash<dev::Address>(data, CONTRACT_ADDRESS);
+    tri.excepted = static_cast<dev::eth::TransactionException>(Read32(data, EXCEPTED));
+    tri.outputIndex = Read32(data, OUTPUT_INDEX);
+    tri.bloom = ReadHash<dev::eth::LogBloom>(data, BLOOM);
+    tri.stateRoot = ReadHash<dev::h256>(data, STATE_ROOT);
+    tri.utxoRoot = ReadHash<dev::h256>(data, UTXO_ROOT);
+
+    size_t logs = logCount();
+    size_t pos = RECEIPT_FIXED_SIZE + 4 + (logs + 1) * 4;
+    uint32_t messageSize = Read32(data, pos);
+    tri.exceptedMessage.assign(reinterpret_cast<const char*>(data.data()) + pos + 4, messageSize);
+
+    tri.logs.reserve(logs);
+    for (size_t i = 0; i < logs; i++) {
+        tri.logs.push_back(log(i).materialize());
+    }
+
+    pos = Read32(data, RECEIPT_FIXED_SIZE + 4 + logs * 4);
+    uint32_t created = Read32(data, pos);
+    pos += 4;
+    for (size_t i = 0; i < created; i++) {
+        dev::Address address = ReadHash<dev::Address>(data, pos);
+        uint32_t codeSize = Read32(data, pos + 20);
+        tri.createdContracts.emplace_back(address, dev::bytes(data.begin() + pos + 24, data.begin() + pos + 24 + codeSize));
+        pos += 24 + codeSize;
+    }
+    uint32_t destructed = Read32(data, pos);
+    pos += 4;
+    for (size_t i = 0; i < destructed; i++) {
+        tri.destructedContracts.push_back(ReadHash<dev::Address>(data, pos + i * 20));
+    }
+    return tri;
+}
+
+ReceiptsView::ReceiptsView(std::span<const uint8_t> _data) : data(_data), valid(false)
+{
+    Reader reader(data, 0);
+    uint32_t receipts;
+    if (data.empty() || data[0] != RECEIPT_FORMAT_VERSION || !reader.skip(1) || !reader.read32(receipts) || size_t(receipts) > data.size() / 4) return;
+    size_t end = reader.position() + size_t(receipts) * 4;
+    for (size_t i = 0; i < receipts; i++) {
+        uint32_t start;
+        if (!reader.read32(start) || start != end) return;
+        // A receipt ends where the next one starts
+        uint32_t next = data.size();
+        if (i + 1 < receipts && !Reader(data, reader.position()).read32(next)) return;
+        if (next < start || !ValidateReceipt(data.subspan(start, next - start))) return;
+        end = next;
+    }
+    valid = end == data.size();
+}
+
+size_t ReceiptsView::size() const
+{
+    return valid ? Read32(data, 1) : 0;
+}
+
+ReceiptView ReceiptsView::operator[](size_t i) const
+{
+    uint32_t start = Read32(data, 5 + i * 4);
+    uint32_t end = i + 1 < size() ? Read32(data, 5 + (i + 1) * 4) : data.size();
+    return ReceiptView(data.subspan(start, end - start));
+}
+
+std::vector<TransactionReceiptInfo> ReceiptsView::materialize() const
+{
+    std::vector<TransactionReceiptInfo> result;
+    result.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        result.push_back((*this)[i].materialize());
+    }
+    return result;
+}
+
+std::vector<uint8_t> SerializeReceipts(std::vector<TransactionReceiptInfo> const& receipts)
+{
+    std::vector<uint8_t> out;
+    Writer writer(out);
+    out.push_back(RECEIPT_FORMAT_VERSION);
+    writer.write32(receipts.size());
+    size_t receiptOffsets = writer.pos();
+    out.resize(out.size() + receipts.size() * 4);
+
+    for (size_t r = 0; r < receipts.size(); r++) {
+        TransactionReceiptInfo const& tri = receipts[r];
+        size_t start = writer.pos();
+        writer.set32(receiptOffsets + r * 4, start);
+
+        writer.write(tri.blockHash);
+        writer.write32(tri.blockNumber);
+        writer.write(tri.transactionHash);
+        writer.write32(tri.transactionIndex);
+        writer.write(tri.from);
+        writer.write(tri.to);
+        writer.write64(tri.cumulativeGasUsed);
+        writer.write64(tri.gasUsed);
+        writer.write(tri.contractAddress);
+        writer.write32(static_cast<uint32_t>(tri.excepted));
+        writer.write32(tri.outputIndex);
+        writer.write(tri.bloom);
+        writer.write(tri.stateRoot);
+        writer.write(tri.utxoRoot);
+
+        writer.write32(tri.logs.size());
+        size_t logOffsets = writer.pos();
+        out.resize(out.size() + (tri.logs.size() + 1) * 4);
+        writer.writeBytes(reinterpret_cast<const uint8_t*>(tri.exceptedMessage.data()), tri.exceptedMessage.size());
+
+        for (size_t i = 0; i < tri.logs.size(); i++) {
+            dev::eth::LogEntry const& log = tri.logs[i];
+            writer.set32(logOffsets + i * 4, writer.pos() - start);
+            writer.write(log.address);
+            writer.write32(log.topics.size());
+            for (dev::h256 const& topic : log.topics) {
+                writer.write(topic);
+            }
+            writer.writeBytes(log.data.data(), log.data.size());
+        }
+        writer.set32(logOffsets + tri.logs.size() * 4, writer.pos() - start);
+
+        writer.write32(tri.createdContracts.size());
+        for (auto const& created : tri.createdContracts) {
+            writer.write(created.first);
+            writer.writeBytes(created.second.data(), created.second.size());
+        }
+        writer.write32(tri.destructedContracts.size());
+        for (dev::Address const& destructed : tri.destructedContracts) {
+            writer.write(destructed);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,100 @@
+#ifndef QTUM_RECEIPTFORMAT_H
+#define QTUM_RECEIPTFORMAT_H
+
+#include <qtum/storageresults.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Binary format of the receipts of a transaction in the results database.
+ *
+ *   u8  version
+ *   u32 receipt count, u32 receipt offsets
+ *   receipts:
+ *     fixed fields, see RECEIPT_FIXED_SIZE
+ *     u32 log count, u32 log offsets, u32 offset of the contract changes
+ *     u32 size and bytes of the exception message
+ *     logs: address, u32 topic count, topics, u32 size and bytes of the data
+ *     created contracts: u32 count, each address, u32 size and bytes of the code
+ *     destructed contracts: u32 count, addresses
+ *
+ * Integers are little endian and offsets are relative to the start of the
+ * value for receipts and to the start of the receipt for everything inside
+ * it. A value is validated once when it is opened; the views below then
+ * read fields in place without allocating.
+ */
+static constexpr uint8_t RECEIPT_FORMAT_VERSION = 1;
+
+class ReceiptLogView{
+
+public:
+
+    ReceiptLogView(std::span<const uint8_t> _data) : data(_data) {}
+
+    dev::Address address() const;
+
+    size_t topicCount() const;
+
+    dev::h256 topic(size_t i) const;
+
+    bool topicEquals(size_t i, dev::h256 const& _topic) const;
+
+    std::span<const uint8_t> logData() const;
+
+    dev::eth::LogEntry materialize() const;
+
+private:
+
+    std::span<const uint8_t> data;
+};
+
+class ReceiptView{
+
+public:
+
+    ReceiptView(std::span<const uint8_t> _data) : data(_data) {}
+
+    uint256 blockHash() const;
+
+    uint32_t blockNumber() const;
+
+    uint256 transactionHash() const;
+
+    size_t logCount() const;
+
+    ReceiptLogView log(size_t i) const;
+
+    TransactionReceiptInfo materialize() const;
+
+private:
+
+    std::span<const uint8_t> data;
+};
+
+class ReceiptsView{
+
+public:
+
+    /** Validate a serialized value, an invalid one has no receipts */
+    explicit ReceiptsView(std::span<const uint8_t> _data);
+
+    bool isValid() const { return valid; }
+
+    size_t size() const;
+
+    ReceiptView operator[](size_t i) const;
+
+    std::vector<TransactionReceiptInfo> materialize() const;
+
+private:
+
+    std::span<const uint8_t> data;
+
+    bool valid;
+};
+
+std::vector<uint8_t> SerializeReceipts(std::vector<TransactionReceiptInfo> const& receipts);
+
+#endif // QTUM_RECEIPTFORMAT_H
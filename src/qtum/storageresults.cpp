@@ -1,14 +1,34 @@
 #include <qtum/storageresults.h>
+#include <qtum/receiptformat.h>
 #include <util/convert.h>
 #include <logging.h>
+#include <memusage.h>
 
-StorageResults::StorageResults(std::string const& _path){
+#include <leveldb/write_batch.h>
+
+StorageResults::StorageResults(std::string const& _path, size_t _maxCacheSize) :
+    m_max_cache_size(_maxCacheSize)
+{
 	path = _path + "/resultsDB";
     leveldb::Options options;
     options.create_if_missing = true;
     leveldb::Status status = leveldb::DB::Open(options, path, &db);
     assert(status.ok());
     LogPrintf("Opened LevelDB successfully\n");
+
+    std::string version;
+    if(db->Get(leveldb::ReadOptions(), RESULTS_VERSION_KEY, &version).ok()){
+        m_legacy = false;
+    } else {
+        std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+        it->SeekToFirst();
+        if(it->Valid()){
+            LogPrintf("Migrating results database to format version %d\n", RECEIPT_FORMAT_VERSION);
+            m_legacy = true;
+        } else {
+            writeVersion();
+        }
+    }
 }
 
 StorageResults::~StorageResults()
@@ -18,15 +38,21 @@ StorageResults::~StorageResults()
 }
 
 void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result){
-	m_cache_result.insert(std::make_pair(hashTx, result));
+	m_pending_result.insert(std::make_pair(hashTx, std::make_shared<const std::vector<TransactionReceiptInfo>>(result)));
 }
 
 void StorageResults::clearCacheResult(){
-    m_cache_result.clear();
+    m_pending_result.clear();
 }
 
 void StorageResults::wipeResults(){
     LogPrintf("Wiping LevelDB in %s\n", path);
+    {
+        LOCK(m_cache_mutex);
+        m_cache_result.clear();
+        m_cache_index.clear();
+        m_cache_usage = 0;
+    }
     bool opened = db;
     if (opened) {
         delete db;
@@ -37,156 +63,302 @@ void StorageResults::wipeResults(){
         options.create_if_missing = true;
         leveldb::Status status = leveldb::DB::Open(options, path, &db);
         assert(status.ok());
+        writeVersion();
     }
 }
 
+void StorageResults::writeVersion(){
+    leveldb::Status status = db->Put(leveldb::WriteOptions(), RESULTS_VERSION_KEY, std::string(1, RECEIPT_FORMAT_VERSION));
+    assert(status.ok());
+    m_legacy = false;
+    m_migration_cursor.clear();
+}
+
 void StorageResults::deleteResults(std::vector<CTransactionRef> const& txs){
+    leveldb::WriteBatch batch;
+    {
+        LOCK(m_cache_mutex);
+        for(CTransactionRef tx : txs){
+            dev::h256 hashTx = uintToh256(tx->GetHash());
+            m_pending_result.erase(hashTx);
+            uncacheResult(hashTx);
+            batch.Delete(resultKey(hashTx));
+            if(m_legacy)
+                batch.Delete(hashTx.hex());
+        }
+    }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
+}
 
-    for(CTransactionRef tx : txs){
-        dev::h256 hashTx = uintToh256(tx->GetHash());
-        m_cache_result.erase(hashTx);
+std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
+	auto pending = m_pending_result.find(hashTx);
+	if (pending != m_pending_result.end())
+		return *pending->second;
 
-        std::string keyTemp = hashTx.hex();
-	    leveldb::Slice key(keyTemp);
-        leveldb::Status status = db->Delete(leveldb::WriteOptions(), key);
-        assert(status.ok());
+    {
+        LOCK(m_cache_mutex);
+        auto it = m_cache_index.find(hashTx);
+        if (it != m_cache_index.end()){
+            ++m_cache_hits;
+            m_cache_result.splice(m_cache_result.begin(), m_cache_result, it->second);
+            return *it->second->second;
+        }
+        ++m_cache_misses;
+    }
+
+    std::vector<TransactionReceiptInfo> result;
+	if(readResult(db, leveldb::ReadOptions(), hashTx, result, m_legacy)){
+        LOCK(m_cache_mutex);
+        cacheResult(std::make_pair(hashTx, std::make_shared<const std::vector<TransactionReceiptInfo>>(result)));
     }
+	return result;
 }
 
-std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
+std::unique_ptr<StorageResultsView> StorageResults::getView() const{
+    return std::make_unique<StorageResultsView>(db, m_pending_result, m_legacy);
+}
+
+StorageResults::CacheStats StorageResults::getCacheStats() const{
+    LOCK(m_cache_mutex);
+    CacheStats stats;
+    stats.usage = m_cache_usage;
+    stats.maxSize = m_max_cache_size;
+    stats.entries = m_cache_index.size();
+    stats.hits = m_cache_hits;
+    stats.misses = m_cache_misses;
+    return stats;
+}
+
+size_t StorageResults::resultUsage(std::vector<TransactionReceiptInfo> const& _result){
+    size_t usage = sizeof(CachedResult) + memusage::MallocUsage(sizeof(std::vector<TransactionReceiptInfo>)) + memusage::DynamicUsage(_result);
+    for(TransactionReceiptInfo const& tri : _result){
+        usage += memusage::MallocUsage(tri.exceptedMessage.capacity());
+        usage += memusage::MallocUsage(tri.logs.capacity() * sizeof(dev::eth::LogEntry));
+        for(dev::eth::LogEntry const& log : tri.logs){
+            usage += memusage::MallocUsage(log.topics.capacity() * sizeof(dev::h256)) + memusage::MallocUsage(log.data.capacity());
+        }
+        usage += memusage::MallocUsage(tri.createdContracts.capacity() * sizeof(std::pair<dev::Address, dev::bytes>));
+        for(auto const& created : tri.createdContracts){
+            usage += memusage::MallocUsage(created.second.capacity());
+        }
+        usage += memusage::MallocUsage(tri.destructedContracts.capacity() * sizeof(dev::Address));
+    }
+    // List node and index entry
+    return usage + 2 * memusage::MallocUsage(sizeof(void*) * 3 + sizeof(dev::h256));
+}
+
+void StorageResults::cacheResult(CachedResult _result){
+    uncacheResult(_result.first);
+    m_cache_usage += resultUsage(*_result.second);
+    m_cache_result.push_front(std::move(_result));
+    m_cache_index.emplace(m_cache_result.front().first, m_cache_result.begin());
+    while(m_cache_usage > m_max_cache_size && !m_cache_result.empty()){
+        uncacheResult(m_cache_result.back().first);
+    }
+}
+
+void StorageResults::uncacheResult(dev::h256 const& hashTx){
+    auto it = m_cache_index.find(hashTx);
+    if(it == m_cache_index.end())
+        return;
+    m_cache_usage -= resultUsage(*it->second->second);
+    m_cache_result.erase(it->second);
+    m_cache_index.erase(it);
+}
+
+StorageResultsView::StorageResultsView(leveldb::DB* _db, ResultsCache _cache, bool _legacy) :
+    db(_db), snapshot(_db->GetSnapshot()), m_cache_result(std::move(_cache)), legacy(_legacy)
+{
+    readOptions.snapshot = snapshot;
+}
+
+StorageResultsView::~StorageResultsView()
+{
+    db->ReleaseSnapshot(snapshot);
+}
+
+std::vector<TransactionReceiptInfo> StorageResultsView::getResult(dev::h256 const& hashTx) const{
     std::vector<TransactionReceiptInfo> result;
-	auto it = m_cache_result.find(hashTx);
-	if (it == m_cache_result.end()){
-		if(readResult(hashTx, result))
-			m_cache_result.insert(std::make_pair(hashTx, result));
+    auto it = m_cache_result.find(hashTx);
+    if (it == m_cache_result.end()){
+        StorageResults::readResult(db, readOptions, hashTx, result, legacy);
     } else {
-		result = it->second;
+        result = *it->second;
     }
-	return result;
+    return result;
+}
+
+std::vector<TransactionReceiptInfo> StorageResultsView::getResult(dev::h256 const& hashTx, std::function<bool(ReceiptView const&)> const& filter) const{
+    std::string value;
+    auto it = m_cache_result.find(hashTx);
+    if (it != m_cache_result.end()){
+        std::vector<uint8_t> data = SerializeReceipts(*it->second);
+        value.assign(data.begin(), data.end());
+    } else if (!StorageResults::readRawResult(db, readOptions, hashTx, value, legacy)){
+        return {};
+    }
+
+    // Only the receipts that pass the filter are decoded
+    std::vector<TransactionReceiptInfo> result;
+    ReceiptsView receipts(MakeUCharSpan(value));
+    for (size_t i = 0; i < receipts.size(); i++){
+        if (filter(receipts[i]))
+            result.push_back(receipts[i].materialize());
+    }
+    return result;
 }
 
 void StorageResults::commitResults(){
-    if(m_cache_result.size()){
-
-        for (auto const& i: m_cache_result){
-            std::string valueTemp;
-            std::string keyTemp = i.first.hex();
-            leveldb::Slice key(keyTemp);
-            leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &valueTemp);
-
-            if(status.IsNotFound()){
-
-                TransactionReceiptInfoSerialized tris;
-
-                for(size_t j = 0; j < i.second.size(); j++){
-                    tris.blockHashes.push_back(uintToh256(i.second[j].blockHash));
-                    tris.blockNumbers.push_back(i.second[j].blockNumber);
-                    tris.transactionHashes.push_back(uintToh256(i.second[j].transactionHash));
-                    tris.transactionIndexes.push_back(i.second[j].transactionIndex);
-                    tris.senders.push_back(i.second[j].from);
-                    tris.receivers.push_back(i.second[j].to);
-                    tris.cumulativeGasUsed.push_back(dev::u256(i.second[j].cumulativeGasUsed));
-                    tris.gasUsed.push_back(dev::u256(i.second[j].gasUsed));
-                    tris.contractAddresses.push_back(i.second[j].contractAddress);
-                    tris.logs.push_back(logEntriesSerialization(i.second[j].logs));
-                    tris.excepted.push_back(uint32_t(static_cast<int>(i.second[j].excepted)));
-                    tris.exceptedMessage.push_back(i.second[j].exceptedMessage);
-                    tris.outputIndexes.push_back(i.second[j].outputIndex);
-                    tris.blooms.push_back(i.second[j].bloom);
-                    tris.stateRoots.push_back(i.second[j].stateRoot);
-                    tris.utxoRoots.push_back(i.second[j].utxoRoot);
-                    tris.createdContracts.push_back(i.second[j].createdContracts);
-                    tris.destructedContracts.push_back(i.second[j].destructedContracts);
-                }
-
-                dev::RLPStream streamRLP(18);
-                streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
-                streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs << tris.excepted << tris.exceptedMessage << tris.outputIndexes << tris.blooms << tris.stateRoots << tris.utxoRoots << tris.createdContracts << tris.destructedContracts;
-
-                dev::bytes data = streamRLP.out();
-                std::string stringData(data.begin(), data.end());
-                leveldb::Slice value(stringData);
-                status = db->Put(leveldb::WriteOptions(), key, value);
-                assert(status.ok());
+    if(m_pending_result.empty())
+        return;
+
+    // Results are written as they are, a reconnected transaction replaces its old result
+    leveldb::WriteBatch batch;
+    for (auto const& i: m_pending_result){
+        std::vector<uint8_t> data = SerializeReceipts(*i.second);
+        batch.Put(resultKey(i.first), leveldb::Slice(reinterpret_cast<const char*>(data.data()), data.size()));
+        if(m_legacy)
+            batch.Delete(i.first.hex());
+    }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
+
+    // Results of recent blocks are the ones most likely to be queried
+    {
+        LOCK(m_cache_mutex);
+        for (auto& i: m_pending_result){
+            cacheResult(std::move(i));
+        }
+    }
+    m_pending_result.clear();
+}
+
+bool StorageResults::migrateLegacyResults(){
+    if(!m_legacy)
+        return false;
+    migrateResults(MIGRATION_BATCH_SIZE);
+    return m_legacy;
+}
+
+void StorageResults::migrateResults(size_t limit){
+    // Legacy results are stored under hex keys, twice the size of the binary ones
+    leveldb::WriteBatch batch;
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    size_t scanned = 0;
+    for(it->Seek(m_migration_cursor); it->Valid() && scanned < limit; it->Next(), scanned++){
+        if(it->key().size() != 64)
+            continue;
+        std::optional<dev::h256> hashTx;
+        std::string keyTemp = it->key().ToString();
+        if(IsHex(keyTemp))
+            hashTx = dev::h256(keyTemp);
+        std::vector<TransactionReceiptInfo> result;
+        if(hashTx && decodeLegacyResult(it->value().ToString(), result)){
+            std::string value;
+            if(!db->Get(leveldb::ReadOptions(), resultKey(*hashTx), &value).ok()){
+                std::vector<uint8_t> data = SerializeReceipts(result);
+                batch.Put(resultKey(*hashTx), leveldb::Slice(reinterpret_cast<const char*>(data.data()), data.size()));
             }
         }
-        m_cache_result.clear();
+        batch.Delete(it->key());
+    }
+    bool done = !it->Valid();
+    if(!done)
+        m_migration_cursor = it->key().ToString();
+    assert(it->status().ok());
+    it.reset();
+
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
+    if(done){
+        writeVersion();
+        LogPrintf("Results database migrated to format version %d\n", RECEIPT_FORMAT_VERSION);
     }
 }
 
-bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result){
+std::string StorageResults::resultKey(dev::h256 const& hashTx){
+    return std::string(reinterpret_cast<const char*>(hashTx.data()), hashTx.size);
+}
 
+bool StorageResults::readRawResult(leveldb::DB* db, leveldb::ReadOptions const& options, dev::h256 const& _key, std::string& _value, bool legacy){
+    leveldb::Status s = db->Get(options, resultKey(_key), &_value);
+    if(s.ok())
+        return true;
+    std::vector<TransactionReceiptInfo> result;
+    if(!legacy || !db->Get(options, _key.hex(), &_value).ok() || !decodeLegacyResult(_value, result))
+        return false;
+    std::vector<uint8_t> data = SerializeReceipts(result);
+    _value.assign(data.begin(), data.end());
+    return true;
+}
+
+bool StorageResults::readResult(leveldb::DB* db, leveldb::ReadOptions const& options, dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result, bool legacy){
     std::string value;
-    std::string keyTemp = _key.hex();;
-    leveldb::Slice key(keyTemp);
-    leveldb::Status s = db->Get(leveldb::ReadOptions(), key, &value);
-
-	if(!s.IsNotFound() && s.ok()){
-
-        TransactionReceiptInfoSerialized tris;
-
-		dev::RLP state(value);
-        tris.blockHashes = state[0].toVector<dev::h256>();
-		tris.blockNumbers = state[1].toVector<uint32_t>();
-		tris.transactionHashes = state[2].toVector<dev::h256>();
-        tris.transactionIndexes = state[3].toVector<uint32_t>();
-        tris.senders = state[4].toVector<dev::h160>();
-        tris.receivers = state[5].toVector<dev::h160>();
-        tris.cumulativeGasUsed = state[6].toVector<dev::u256>();
-        tris.gasUsed = state[7].toVector<dev::u256>();
-        tris.contractAddresses = state[8].toVector<dev::h160>();
-        tris.logs = state[9].toVector<logEntriesSerialize>();
-        if(state.itemCount() >= 11)
-            tris.excepted = state[10].toVector<uint32_t>();
-        if(state.itemCount() >= 12)
-            tris.exceptedMessage = state[11].toVector<std::string>();
-        if(state.itemCount() >= 13)
-            tris.outputIndexes = state[12].toVector<uint32_t>();
-        if(state.itemCount() >= 14)
-            tris.blooms = state[13].toVector<dev::h2048>();
-        if(state.itemCount() >= 15)
-            tris.stateRoots = state[14].toVector<dev::h256>();
-        if(state.itemCount() >= 16)
-            tris.utxoRoots = state[15].toVector<dev::h256>();
-        if (state.itemCount() >= 17)
-            tris.createdContracts = state[16].toVector<std::vector<std::pair<dev::Address, dev::bytes>>>();
-        if (state.itemCount() >= 18)
-            tris.destructedContracts = state[17].toVector<std::vector<dev::h160>>();
-
-        for(size_t j = 0; j < tris.blockHashes.size(); j++){
-            TransactionReceiptInfo tri{
-                h256Touint(tris.blockHashes[j]),
-                tris.blockNumbers[j],
-                h256Touint(tris.transactionHashes[j]),
-                tris.transactionIndexes[j],
-                tris.senders[j],
-                tris.receivers[j],
-                uint64_t(tris.cumulativeGasUsed[j]),
-                uint64_t(tris.gasUsed[j]),
-                tris.contractAddresses[j],
-                logEntriesDeserialize(tris.logs[j]),
-                state.itemCount() >= 11 ? static_cast<dev::eth::TransactionException>(tris.excepted[j]) : dev::eth::TransactionException::NoInformation,
-                state.itemCount() >= 12 ? tris.exceptedMessage[j] : "",
-                state.itemCount() >= 13 ? tris.outputIndexes[j] : 0xffffffff,
-                state.itemCount() >= 14 ? tris.blooms[j] : dev::h2048(),
-                state.itemCount() >= 15 ? tris.stateRoots[j] : dev::h256(),
-                state.itemCount() >= 16 ? tris.utxoRoots[j] : dev::h256(),
-                state.itemCount() >= 17 ? tris.createdContracts[j] : std::vector<std::pair<dev::h160, dev::bytes>>(),
-                state.itemCount() >= 18 ? tris.destructedContracts[j] : std::vector<dev::h160>()
-            };
-            _result.push_back(tri);
-        }
-		return true;
-	}
-	return false;
+    if(!readRawResult(db, options, _key, value, legacy))
+        return false;
+    ReceiptsView receipts(MakeUCharSpan(value));
+    if(!receipts.isValid())
+        return false;
+    _result = receipts.materialize();
+    return true;
 }
 
-logEntriesSerialize StorageResults::logEntriesSerialization(dev::eth::LogEntries const& _logs){
-	logEntriesSerialize result;
-	for(dev::eth::LogEntry i : _logs){
-		result.push_back(std::make_pair(i.address, std::make_pair(i.topics, i.data)));
-	}
-	return result;
+bool StorageResults::decodeLegacyResult(std::string const& value, std::vector<TransactionReceiptInfo>& _result){
+    TransactionReceiptInfoSerialized tris;
+
+	dev::RLP state(value);
+    tris.blockHashes = state[0].toVector<dev::h256>();
+	tris.blockNumbers = state[1].toVector<uint32_t>();
+	tris.transactionHashes = state[2].toVector<dev::h256>();
+    tris.transactionIndexes = state[3].toVector<uint32_t>();
+    tris.senders = state[4].toVector<dev::h160>();
+    tris.receivers = state[5].toVector<dev::h160>();
+    tris.cumulativeGasUsed = state[6].toVector<dev::u256>();
+    tris.gasUsed = state[7].toVector<dev::u256>();
+    tris.contractAddresses = state[8].toVector<dev::h160>();
+    tris.logs = state[9].toVector<logEntriesSerialize>();
+    if(state.itemCount() >= 11)
+        tris.excepted = state[10].toVector<uint32_t>();
+    if(state.itemCount() >= 12)
+        tris.exceptedMessage = state[11].toVector<std::string>();
+    if(state.itemCount() >= 13)
+        tris.outputIndexes = state[12].toVector<uint32_t>();
+    if(state.itemCount() >= 14)
+        tris.blooms = state[13].toVector<dev::h2048>();
+    if(state.itemCount() >= 15)
+        tris.stateRoots = state[14].toVector<dev::h256>();
+    if(state.itemCount() >= 16)
+        tris.utxoRoots = state[15].toVector<dev::h256>();
+    if (state.itemCount() >= 17)
+        tris.createdContracts = state[16].toVector<std::vector<std::pair<dev::Address, dev::bytes>>>();
+    if (state.itemCount() >= 18)
+        tris.destructedContracts = state[17].toVector<std::vector<dev::h160>>();
+
+    for(size_t j = 0; j < tris.blockHashes.size(); j++){
+        TransactionReceiptInfo tri{
+            h256Touint(tris.blockHashes[j]),
+            tris.blockNumbers[j],
+            h256Touint(tris.transactionHashes[j]),
+            tris.transactionIndexes[j],
+            tris.senders[j],
+            tris.receivers[j],
+            uint64_t(tris.cumulativeGasUsed[j]),
+            uint64_t(tris.gasUsed[j]),
+            tris.contractAddresses[j],
+            logEntriesDeserialize(tris.logs[j]),
+            state.itemCount() >= 11 ? static_cast<dev::eth::TransactionException>(tris.excepted[j]) : dev::eth::TransactionException::NoInformation,
+            state.itemCount() >= 12 ? tris.exceptedMessage[j] : "",
+            state.itemCount() >= 13 ? tris.outputIndexes[j] : 0xffffffff,
+            state.itemCount() >= 14 ? tris.blooms[j] : dev::h2048(),
+            state.itemCount() >= 15 ? tris.stateRoots[j] : dev::h256(),
+            state.itemCount() >= 16 ? tris.utxoRoots[j] : dev::h256(),
+            state.itemCount() >= 17 ? tris.createdContracts[j] : std::vector<std::pair<dev::h160, dev::bytes>>(),
+            state.itemCount() >= 18 ? tris.destructedContracts[j] : std::vector<dev::h160>()
+        };
+        _result.push_back(tri);
+    }
+	return true;
 }
 
 dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerialize const& _logs){
@@ -1,3 +1,6 @@
+#ifndef QTUM_STORAGERESULTS_H
+#define QTUM_STORAGERESULTS_H
+
 #include <uint256.h>
 #include <primitives/transaction.h>
 #include <libethereum/State.h>
@@ -5,6 +8,13 @@
 #include <leveldb/db.h>
 #include <common/system.h>
 
+#include <sync.h>
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+
 using logEntriesSerialize = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
 
 struct TransactionReceiptInfo{
@@ -49,11 +59,70 @@ struct TransactionReceiptInfoSerialized{
     std::vector<std::vector<dev::h160>> destructedContracts;
 };
 
+class ReceiptView;
+
+using ResultsCache = std::unordered_map<dev::h256, std::shared_ptr<const std::vector<TransactionReceiptInfo>>>;
+
+/**
+ * Read-only view of the stored results as of the moment it was taken.
+ * Lookups read a LevelDB snapshot and a copy of the uncommitted results,
+ * so they are safe without cs_main while blocks are connected.
+ */
+class StorageResultsView{
+
+public:
+
+    StorageResultsView(leveldb::DB* _db, ResultsCache _cache, bool _legacy);
+    ~StorageResultsView();
+
+    StorageResultsView(const StorageResultsView&) = delete;
+    StorageResultsView& operator=(const StorageResultsView&) = delete;
+
+    std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx) const;
+
+    /**
+     * Like getResult, but only the receipts accepted by the filter are decoded.
+     * The filter reads the stored receipt in place.
+     */
+    std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx, std::function<bool(ReceiptView const&)> const& filter) const;
+
+private:
+
+    leveldb::DB* db;
+
+    const leveldb::Snapshot* snapshot;
+
+    leveldb::ReadOptions readOptions;
+
+    ResultsCache m_cache_result;
+
+    bool legacy;
+};
+
+static const std::string RESULTS_VERSION_KEY = "version";
+
+/** Number of keys scanned for legacy results in each migration batch */
+static constexpr size_t MIGRATION_BATCH_SIZE = 1000;
+
+/** Interval between the migration batches run by the scheduler */
+static constexpr auto MIGRATION_INTERVAL{std::chrono::milliseconds{100}};
+
+/** Default for the memory used by the cache of results read from disk */
+static constexpr size_t DEFAULT_RESULTS_CACHE_SIZE{32 << 20};
+
 class StorageResults{
 
 public:
 
-	StorageResults(std::string const& _path);
+    struct CacheStats{
+        size_t usage{0};
+        size_t maxSize{0};
+        size_t entries{0};
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+	StorageResults(std::string const& _path, size_t _maxCacheSize = DEFAULT_RESULTS_CACHE_SIZE);
     ~StorageResults();
 
 	void addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result);
@@ -64,21 +133,80 @@ public:
 
 	void commitResults();
 
+    /**
+     * Convert the next batch of legacy results, returns false once none are left.
+     * Must be called under cs_main, like the other accessors.
+     */
+    bool migrateLegacyResults();
+
     void clearCacheResult();
 
     void wipeResults();
 
+    /**
+     * Take a read-only view for serving queries outside cs_main.
+     * Must be called under cs_main, like the other accessors.
+     * The view must not outlive this object or a wipeResults() call.
+     */
+    std::unique_ptr<StorageResultsView> getView() const;
+
+    CacheStats getCacheStats() const;
+
 private:
 
-	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
+    using CachedResult = std::pair<dev::h256, std::shared_ptr<const std::vector<TransactionReceiptInfo>>>;
+
+    friend class StorageResultsView;
+
+	static bool readResult(leveldb::DB* db, leveldb::ReadOptions const& options, dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result, bool legacy);
+
+	/** Read the serialized receipts of a transaction, converting a legacy result if there is one */
+	static bool readRawResult(leveldb::DB* db, leveldb::ReadOptions const& options, dev::h256 const& _key, std::string& _value, bool legacy);
+
+	static bool decodeLegacyResult(std::string const& value, std::vector<TransactionReceiptInfo>& _result);
+
+	static std::string resultKey(dev::h256 const& hashTx);
+
+	void writeVersion();
+
+	/** Convert up to limit legacy results, continuing where the last call stopped */
+	void migrateResults(size_t limit);
 
-	logEntriesSerialize logEntriesSerialization(dev::eth::LogEntries const& _logs);
+	static dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs);
 
-	dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs);
+	static size_t resultUsage(std::vector<TransactionReceiptInfo> const& _result);
+
+	void cacheResult(CachedResult _result) EXCLUSIVE_LOCKS_REQUIRED(m_cache_mutex);
+
+	void uncacheResult(dev::h256 const& hashTx) EXCLUSIVE_LOCKS_REQUIRED(m_cache_mutex);
 
 	std::string path;
 
     leveldb::DB* db;
 
-	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
+    // Whether results of the RLP format before RECEIPT_FORMAT_VERSION may still exist
+    bool m_legacy{false};
+
+    std::string m_migration_cursor;
+
+    // Results of connected blocks not yet written to disk
+	ResultsCache m_pending_result;
+
+    // Least recently used cache of results read from or written to disk,
+    // most recently used first
+    mutable Mutex m_cache_mutex;
+
+    std::list<CachedResult> m_cache_result GUARDED_BY(m_cache_mutex);
+
+    std::unordered_map<dev::h256, std::list<CachedResult>::iterator> m_cache_index GUARDED_BY(m_cache_mutex);
+
+    size_t m_cache_usage GUARDED_BY(m_cache_mutex){0};
+
+    const size_t m_max_cache_size;
+
+    uint64_t m_cache_hits GUARDED_BY(m_cache_mutex){0};
+
+    uint64_t m_cache_misses GUARDED_BY(m_cache_mutex){0};
 };
+
+#endif // QTUM_STORAGERESULTS_H
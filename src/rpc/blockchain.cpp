@@ -58,6 +58,7 @@
 #include <txdb.h>
 #include <util/convert.h>
 #include <qtum/qtumdelegation.h>
+#include <qtum/receiptformat.h>
 #include <util/tokenstr.h>
 #include <rpc/contract_util.h>
 
@@ -290,7 +291,7 @@ UniValue blockheaderToJSON(const CBlockIndex& tip, const CBlockIndex& blockindex
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
 
     result.pushKV("flags", strprintf("%s", blockindex.IsProofOfStake()? "proof-of-stake" : "proof-of-work"));
-    result.pushKV("proofhash", blockindex.hashProof.GetHex());
+    result.pushKV("proofhash", blockindex.GetHashProof().GetHex());
     result.pushKV("modifier", blockindex.nStakeModifier.GetHex());
 
     if (blockindex.IsProofOfStake())
@@ -1415,15 +1416,23 @@ RPCHelpMan waitforlogs()
 
     int curheight = 0;
 
-    auto& addresses = params.addresses;
     auto& filterTopics = params.topics;
 
+    CLogQuery query;
+    query.fromBlock = params.fromBlock;
+    query.toBlock = params.toBlock;
+    query.minconf = params.minconf;
+    query.addresses = params.addresses;
+    for (const auto& topic : filterTopics) {
+        query.topics.push_back(topic ? std::optional<dev::h256>(topic.get()) : std::nullopt);
+    }
+
+    std::unique_ptr<LogQuerySnapshot> snapshot;
+
     while (curheight == 0) {
-        {
-            LOCK(cs_main);
-            curheight = chainman.m_blockman.m_block_tree_db->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf,
-                    hashesToBlock, addresses, chainman);
-        }
+        // Index and receipts are read from a snapshot, cs_main is only held to take it
+        snapshot = std::make_unique<LogQuerySnapshot>(chainman);
+        curheight = snapshot->ReadLogIndex(query, hashesToBlock);
 
         // if curheight >= fromBlock. Blockchain extended with new log entries. Return next block height to client.
         //    nextBlock = curheight + 1
@@ -1460,10 +1469,28 @@ RPCHelpMan waitforlogs()
         }
     }
 
-    LOCK(cs_main);
-
     UniValue jsonLogs(UniValue::VARR);
 
+    // Whether a stored log matches every given topic
+    auto logFilter = [&filterTopics](const ReceiptLogView& log) {
+        for (size_t i = 0; i < filterTopics.size(); i++) {
+            if (filterTopics[i] && !log.topicEquals(i, filterTopics[i].get())) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Only receipts with a matching log are decoded
+    auto receiptFilter = [&logFilter](const ReceiptView& receipt) {
+        for (size_t i = 0; i < receipt.logCount(); i++) {
+            if (logFilter(receipt.log(i))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
     std::set<uint256> dupes;
 
     for (const auto& txHashes : hashesToBlock) {
@@ -1474,8 +1501,7 @@ RPCHelpMan waitforlogs()
             }
             dupes.insert(txHash);
 
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(
-                    uintToh256(txHash));
+            std::vector<TransactionReceiptInfo> receipts = snapshot->GetResult(txHash, receiptFilter);
 
             for (const auto& receipt : receipts) {
                 for (const auto& log : receipt.logs) {
@@ -1491,9 +1517,8 @@ RPCHelpMan waitforlogs()
                             }
 
                             auto filterTopicContent = filterTopic.get();
-                            auto topicContent = log.topics[i];
 
-                            if (topicContent != filterTopicContent) {
+                            if (i >= log.topics.size() || log.topics[i] != filterTopicContent) {
                                 includeLog = false;
                                 break;
                             }
@@ -1934,7 +1959,8 @@ RPCHelpMan getdelegationsforstaker()
     std::map<uint160, Delegation> delegations = qtumDelegation.DelegationsFromEvents(events);
 
     // Get chain parameters
-    std::map<COutPoint, uint32_t> immatureStakes = GetImmatureStakes(chainman);
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> pImmatureStakes = GetImmatureStakes(chainman);
+    const std::map<COutPoint, uint32_t>& immatureStakes = *pImmatureStakes;
     int height = chainman.ActiveChain().Height();
 
     // Fill the json object with information
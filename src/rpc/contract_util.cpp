@@ -2,6 +2,8 @@
 #include <rpc/util.h>
 #include <common/system.h>
 #include <key_io.h>
+#include <qtum/callstate.h>
+#include <qtum/receiptformat.h>
 #include <rpc/server.h>
 #include <txdb.h>
 
@@ -61,9 +63,6 @@ UniValue transactionReceiptToJSON(const QtumTransactionReceipt& txRec)
 
 UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
 {
-    LOCK(cs_main);
-
-    CChain& active_chain = chainman.ActiveChain();
     std::string strAddr = params[0].get_str();
     std::string data = params[1].get_str();
 
@@ -93,21 +92,25 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid amount for send");
     }
 
-    TemporaryState ts(globalState);
-    int blockNum;
-    if (params.size() >= 6) {
-        if (params[5].isNum()) {
-            blockNum = params[5].getInt<int>();
-            if ((blockNum < 0 && blockNum != -1) || blockNum > active_chain.Height())
+    // Only pinning the block needs cs_main, the call runs on a leased state without it
+    std::unique_ptr<CallStatePool::Lease> lease;
+    {
+        LOCK(cs_main);
+        CChain& active_chain = chainman.ActiveChain();
+        int blockNum = active_chain.Height();
+        if (params.size() >= 6) {
+            if (params[5].isNum()) {
+                blockNum = params[5].getInt<int>();
+                if ((blockNum < 0 && blockNum != -1) || blockNum > active_chain.Height())
+                    throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+                if (blockNum == -1) {
+                    blockNum = active_chain.Height();
+                }
+            } else {
                 throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
-            if (blockNum != -1) {
-                ts.SetRoot(uintToh256(active_chain[blockNum]->hashStateRoot), uintToh256(active_chain[blockNum]->hashUTXORoot));
             }
-        } else {
-            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
         }
-    } else {
-        blockNum = active_chain.Height();
+        lease = pcallstatepool->acquire(active_chain[blockNum]);
     }
 
     dev::Address addrAccount;
@@ -115,13 +118,14 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
         if (strAddr.size() != 40 || !CheckHex(strAddr))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
         addrAccount = dev::Address(strAddr);
-        if (!globalState->addressInUse(addrAccount))
+        if (!lease->state().addressInUse(addrAccount))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
     }
 
-    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), chainman.ActiveChainstate(), blockNum, senderAddress, gasLimit, nAmount);
+    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), chainman.ActiveChainstate(), lease->block(), senderAddress, gasLimit, nAmount);
 
     if(fRecordLogOpcodes){
+        LOCK(cs_main);
         writeVMlog(execResults, chainman.ActiveChain());
     }
 
@@ -352,6 +356,30 @@ private:
 
 };
 
+LogQuerySnapshot::LogQuerySnapshot(ChainstateManager &chainman)
+{
+    LOCK(cs_main);
+    tipHeight = chainman.ActiveChain().Height();
+    blockTreeDB = chainman.m_blockman.m_block_tree_db.get();
+    index.reset(blockTreeDB->NewSnapshot());
+    results = pstorageresult->getView();
+}
+
+int LogQuerySnapshot::ReadLogIndex(const CLogQuery &query, std::vector<std::vector<uint256>> &blocksOfHashes) const
+{
+    return blockTreeDB->ReadLogIndex(*index, query, tipHeight, blocksOfHashes);
+}
+
+std::vector<TransactionReceiptInfo> LogQuerySnapshot::GetResult(const uint256 &txHash) const
+{
+    return results->getResult(uintToh256(txHash));
+}
+
+std::vector<TransactionReceiptInfo> LogQuerySnapshot::GetResult(const uint256 &txHash, const std::function<bool(const ReceiptView&)> &filter) const
+{
+    return results->getResult(uintToh256(txHash), filter);
+}
+
 UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
 {
     if(!fLogEvents)
@@ -359,13 +387,24 @@ UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
 
     int curheight = 0;
 
-    LOCK(cs_main);
+    LogQuerySnapshot snapshot(chainman);
 
-    SearchLogsParams params(_params, chainman.ActiveChain().Height());
+    SearchLogsParams params(_params, snapshot.TipHeight());
 
     std::vector<std::vector<uint256>> hashesToBlock;
 
-    curheight = chainman.m_blockman.m_block_tree_db->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses, chainman);
+    CLogQuery query;
+    query.fromBlock = params.fromBlock;
+    query.toBlock = params.toBlock;
+    query.minconf = params.minconf;
+    query.addresses = params.addresses;
+    for (const auto& topic : params.topics) {
+        query.topics.push_back(topic ? std::optional<dev::h256>(topic.get()) : std::nullopt);
+    }
+    // A receipt is returned if any of its logs matches one of the topics
+    query.matchAllTopics = false;
+
+    curheight = snapshot.ReadLogIndex(query, hashesToBlock);
 
     if (curheight == -1) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
@@ -375,6 +414,27 @@ UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
 
     auto topics = params.topics;
 
+    // Receipts with a log that matches one of the topics, checked without decoding them
+    auto receiptFilter = [&topics](const ReceiptView& receipt) {
+        if (receipt.logCount() == 0) {
+            return false;
+        }
+        if (topics.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i < topics.size(); i++) {
+            if (!topics[i]) {
+                continue;
+            }
+            for (size_t j = 0; j < receipt.logCount(); j++) {
+                if (receipt.log(j).topicEquals(i, topics[i].get())) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
     std::set<uint256> dupes;
 
     for(const auto& hashesTx : hashesToBlock)
@@ -387,40 +447,9 @@ UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
             }
             dupes.insert(e);
 
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e));
+            std::vector<TransactionReceiptInfo> receipts = snapshot.GetResult(e, receiptFilter);
 
             for(const auto& receipt : receipts) {
-                if(receipt.logs.empty()) {
-                    continue;
-                }
-
-                if (!topics.empty()) {
-                    for (size_t i = 0; i < topics.size(); i++) {
-                        const auto& tc = topics[i];
-
-                        if (!tc) {
-                            continue;
-                        }
-
-                        for (const auto& log: receipt.logs) {
-                            auto filterTopicContent = tc.get();
-
-                            if (i >= log.topics.size()) {
-                                continue;
-                            }
-
-                            if (filterTopicContent == log.topics[i]) {
-                                goto push;
-                            }
-                        }
-                    }
-
-                    // Skip the log if none of the topics are matched
-                    continue;
-                }
-
-            push:
-
                 UniValue tri(UniValue::VOBJ);
                 transactionReceiptInfoToJSON(receipt, tri);
                 result.push_back(tri);
@@ -11,6 +11,32 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman);
 
 UniValue SearchLogs(const UniValue& params, ChainstateManager &chainman);
 
+/**
+ * Log index and receipts pinned at the active tip. Taking it holds cs_main
+ * only briefly, reading from it does not need cs_main.
+ */
+class LogQuerySnapshot
+{
+public:
+    explicit LogQuerySnapshot(ChainstateManager &chainman) EXCLUSIVE_LOCKS_REQUIRED(!::cs_main);
+
+    int TipHeight() const { return tipHeight; }
+
+    /** See BlockTreeDB::ReadLogIndex */
+    int ReadLogIndex(const CLogQuery &query, std::vector<std::vector<uint256>> &blocksOfHashes) const;
+
+    std::vector<TransactionReceiptInfo> GetResult(const uint256 &txHash) const;
+
+    /** Receipts of the transaction accepted by the filter, see StorageResultsView::getResult */
+    std::vector<TransactionReceiptInfo> GetResult(const uint256 &txHash, const std::function<bool(const ReceiptView&)> &filter) const;
+
+private:
+    int tipHeight;
+    const kernel::BlockTreeDB* blockTreeDB;
+    std::unique_ptr<CDBSnapshot> index;
+    std::unique_ptr<StorageResultsView> results;
+};
+
 void assignJSON(UniValue& entry, const TransactionReceiptInfo& resExec);
 
 void assignJSON(UniValue& logEntry, const dev::eth::LogEntry& log,
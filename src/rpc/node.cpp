@@ -29,6 +29,7 @@
 #include <key_io.h>
 #include <common/args.h>
 #include <util/time.h>
+#include <libdevcore/TrieNodeCache.h>
 
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
@@ -122,6 +123,31 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCEVMStateMemoryInfo()
+{
+    dev::TrieNodeCache::Stats stats = dev::trieNodeCache().stats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("usage", uint64_t(stats.usage));
+    obj.pushKV("max", uint64_t(stats.maxSize));
+    obj.pushKV("entries", uint64_t(stats.entries));
+    obj.pushKV("hits", stats.hits);
+    obj.pushKV("misses", stats.misses);
+    return obj;
+}
+
+static UniValue RPCReceiptMemoryInfo()
+{
+    UniValue obj(UniValue::VOBJ);
+    if (!pstorageresult) return obj;
+    StorageResults::CacheStats stats = pstorageresult->getCacheStats();
+    obj.pushKV("usage", uint64_t(stats.usage));
+    obj.pushKV("max", uint64_t(stats.maxSize));
+    obj.pushKV("entries", uint64_t(stats.entries));
+    obj.pushKV("hits", stats.hits);
+    obj.pushKV("misses", stats.misses);
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -166,6 +192,22 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "evmstate", "Information about the EVM state trie node cache",
+                            {
+                                {RPCResult::Type::NUM, "usage", "Number of bytes used"},
+                                {RPCResult::Type::NUM, "max", "Maximum number of bytes used (see -evmstatecache)"},
+                                {RPCResult::Type::NUM, "entries", "Number of cached trie nodes"},
+                                {RPCResult::Type::NUM, "hits", "Number of lookups served from the cache"},
+                                {RPCResult::Type::NUM, "misses", "Number of lookups read from the databases"},
+                            }},
+                            {RPCResult::Type::OBJ, "receipts", "Information about the transaction receipt cache",
+                            {
+                                {RPCResult::Type::NUM, "usage", "Number of bytes used"},
+                                {RPCResult::Type::NUM, "max", "Maximum number of bytes used"},
+                                {RPCResult::Type::NUM, "entries", "Number of cached transactions"},
+                                {RPCResult::Type::NUM, "hits", "Number of lookups served from the cache"},
+                                {RPCResult::Type::NUM, "misses", "Number of lookups read from the database"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -182,6 +224,8 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("evmstate", RPCEVMStateMemoryInfo());
+        obj.pushKV("receipts", RPCReceiptMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
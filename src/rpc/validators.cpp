@@ -100,7 +100,7 @@ static RPCHelpMan listvalidators()
                 if (trust::g_heartbeat_manager) {
                     const trust::TrustScoreManager* trustManager = trust::g_heartbeat_manager->GetTrustManager();
                     if (trustManager) {
-                        const trust::ValidatorInfo* info = trustManager->GetValidator(v.validatorId);
+                        std::optional<trust::ValidatorInfo> info = trustManager->GetValidator(v.validatorId);
                         if (info) {
                             entry.pushKV("trustTier", trust::TrustTierToString(info->GetTrustTier(Params().GetConsensus())));
                             entry.pushKV("uptimePercent", info->GetUptimePercentage());
@@ -172,7 +172,7 @@ static RPCHelpMan getvalidator()
             if (trust::g_heartbeat_manager) {
                 const trust::TrustScoreManager* trustManager = trust::g_heartbeat_manager->GetTrustManager();
                 if (trustManager) {
-                    const trust::ValidatorInfo* info = trustManager->GetValidator(validatorId);
+                    std::optional<trust::ValidatorInfo> info = trustManager->GetValidator(validatorId);
                     if (info) {
                         trust::TrustTier tier = info->GetTrustTier(Params().GetConsensus());
                         result.pushKV("trustTier", trust::TrustTierToString(tier));
@@ -231,7 +231,7 @@ static RPCHelpMan getvalidatorstats()
                 if (trust::g_heartbeat_manager) {
                     const trust::TrustScoreManager* trustManager = trust::g_heartbeat_manager->GetTrustManager();
                     if (trustManager) {
-                        const trust::ValidatorInfo* info = trustManager->GetValidator(v.validatorId);
+                        std::optional<trust::ValidatorInfo> info = trustManager->GetValidator(v.validatorId);
                         if (info) {
                             trust::TrustTier tier = info->GetTrustTier(Params().GetConsensus());
                             switch (tier) {
@@ -533,13 +533,17 @@ struct CustomUintFormatter
 
     template <typename Stream, typename I> void Ser(Stream& s, I v)
     {
-        if (v < 0 || v > MAX) throw std::ios_base::failure("CustomUintFormatter value out of range");
-        if (BigEndian) {
-            uint64_t raw = htobe64_internal(v);
-            s.write(AsBytes(Span{&raw, 1}).last(Bytes));
+        if constexpr (std::is_enum_v<I>) {
+            Ser(s, static_cast<std::underlying_type_t<I>>(v));
         } else {
-            uint64_t raw = htole64_internal(v);
-            s.write(AsBytes(Span{&raw, 1}).first(Bytes));
+            if (v < 0 || v > MAX) throw std::ios_base::failure("CustomUintFormatter value out of range");
+            if (BigEndian) {
+                uint64_t raw = htobe64_internal(v);
+                s.write(AsBytes(Span{&raw, 1}).last(Bytes));
+            } else {
+                uint64_t raw = htole64_internal(v);
+                s.write(AsBytes(Span{&raw, 1}).first(Bytes));
+            }
         }
     }
 
@@ -5,13 +5,17 @@
 #include <boost/test/unit_test.hpp>
 
 #include <chain.h>
+#include <chainparams.h>
 #include <node/blockstorage.h>
+#include <pubkey.h>
 #include <rpc/blockchain.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
 #include <util/string.h>
 
 #include <cstdlib>
+#include <map>
+#include <memory>
 
 using util::ToString;
 
@@ -117,4 +121,100 @@ BOOST_AUTO_TEST_CASE(num_chain_tx_max)
     BOOST_CHECK_EQUAL(block_index.m_chain_tx_count, std::numeric_limits<uint64_t>::max());
 }
 
+BOOST_AUTO_TEST_CASE(block_index_cold_data)
+{
+    CBlockHeader header;
+    header.vchBlockSigDlgt = std::vector<unsigned char>(2 * CPubKey::COMPACT_SIGNATURE_SIZE + 5, 0x42);
+    const uint256 hash{header.GetHash()};
+    CBlockIndex index{header};
+    index.phashBlock = &hash;
+    index.SetHashProof(uint256::ONE);
+    BOOST_CHECK(index.HasColdData());
+    BOOST_CHECK(index.HasProofOfDelegation());
+
+    // The cold data round trips through the block tree DB
+    kernel::BlockTreeDB db{DBParams{.path = m_args.GetDataDirNet() / "index", .cache_bytes = 1 << 20, .memory_only = true}};
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, {&index}));
+    BlockIndexColdData data;
+    BOOST_REQUIRE(db.ReadBlockIndexColdData(hash, data));
+    BOOST_CHECK(data.vchBlockSigDlgt == header.vchBlockSigDlgt);
+    BOOST_CHECK(data.hashProof == uint256::ONE);
+
+    // Released data is read back on access and kept in a bounded cache
+    int reads{0};
+    SetBlockIndexColdLoader(this, [&](const CBlockIndex& pindex, BlockIndexColdData& cold) {
+        ++reads;
+        return db.ReadBlockIndexColdData(pindex.GetBlockHash(), cold);
+    });
+    WITH_LOCK(::cs_main, index.ReleaseColdData());
+    BOOST_CHECK(!index.HasColdData());
+    BOOST_CHECK(index.HasProofOfDelegation());
+    BOOST_CHECK_EQUAL(reads, 0);
+    BOOST_CHECK(index.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK(index.GetHashProof() == uint256::ONE);
+    BOOST_CHECK_EQUAL(index.GetProofOfDelegation().size(), CPubKey::COMPACT_SIGNATURE_SIZE);
+    BOOST_CHECK_EQUAL(reads, 1);
+    BOOST_CHECK(!index.HasColdData());
+
+    // Setting the data again drops the cached copy
+    index.SetHashProof(uint256::ZERO);
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, {&index}));
+    WITH_LOCK(::cs_main, index.ReleaseColdData());
+    BOOST_CHECK(index.GetHashProof() == uint256::ZERO);
+    BOOST_CHECK_EQUAL(reads, 2);
+
+    // A failed read is an error rather than an empty signature that would be written back
+    const uint256 missing{m_rng.rand256()};
+    CBlockIndex unknown{header};
+    unknown.phashBlock = &missing;
+    WITH_LOCK(::cs_main, unknown.ReleaseColdData());
+    BOOST_CHECK_THROW(unknown.GetBlockHeader(), std::runtime_error);
+    BOOST_CHECK_EQUAL(reads, 3);
+    ResetBlockIndexColdLoader(this);
+}
+
+BOOST_AUTO_TEST_CASE(block_index_parallel_load)
+{
+    kernel::BlockTreeDB db{DBParams{.path = m_args.GetDataDirNet() / "index", .cache_bytes = 1 << 20, .memory_only = true}};
+
+    // Entries spread over the key ranges the loader threads split the index into
+    std::vector<CBlockHeader> headers(500);
+    std::vector<uint256> hashes;
+    std::vector<std::unique_ptr<CBlockIndex>> indexes;
+    for (CBlockHeader& header : headers) {
+        header.hashMerkleRoot = m_rng.rand256();
+        header.prevoutStake = COutPoint(Txid::FromUint256(m_rng.rand256()), 1);
+        header.vchBlockSigDlgt = std::vector<unsigned char>(72, 0x42);
+        hashes.push_back(header.GetHash());
+    }
+    for (size_t i = 0; i < headers.size(); ++i) {
+        indexes.push_back(std::make_unique<CBlockIndex>(headers[i]));
+        indexes.back()->phashBlock = &hashes[i];
+        indexes.back()->nHeight = i;
+    }
+    std::vector<const CBlockIndex*> blockinfo;
+    for (const auto& index : indexes) blockinfo.push_back(index.get());
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, blockinfo));
+
+    std::map<uint256, std::unique_ptr<CBlockIndex>> loaded;
+    auto insert = [&](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull()) return nullptr;
+        std::unique_ptr<CBlockIndex>& index = loaded[hash];
+        if (!index) index = std::make_unique<CBlockIndex>();
+        return index.get();
+    };
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return db.LoadBlockIndexGuts(Params().GetConsensus(), insert, m_interrupt)));
+
+    // Every entry comes back under its hash
+    BOOST_CHECK_EQUAL(loaded.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        BOOST_REQUIRE(loaded.count(hashes[i]));
+        const CBlockIndex& index = *loaded[hashes[i]];
+        BOOST_CHECK_EQUAL(index.nHeight, int(i));
+        BOOST_CHECK(index.hashMerkleRoot == headers[i].hashMerkleRoot);
+        BOOST_CHECK_EQUAL(index.nBlockSigSize, 72U);
+        BOOST_CHECK(!index.HasColdData());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <streams.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <validators/delegation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <vector>
+
+using namespace validators;
+
+namespace {
+
+/** Load a set of delegations directly, bypassing request signatures. */
+void LoadDelegations(DelegationDB& db, const std::vector<DelegationEntry>& entries)
+{
+    std::map<uint256, DelegationEntry> delegations;
+    std::map<CKeyID, ValidatorRewardPool> pools;
+    for (const auto& entry : entries) {
+        delegations.emplace(entry.GetDelegationId(), entry);
+        if (entry.IsActive()) pools[entry.validatorId].totalActive += entry.amount;
+    }
+    DataStream ss{};
+    ss << delegations << pools;
+    db.Unserialize(ss);
+}
+
+/** floor(share * amount / total), computed without overflowing the product. */
+CAmount ProportionalSplit(CAmount share, CAmount amount, CAmount total)
+{
+    arith_uint256 split{static_cast<uint64_t>(share)};
+    split *= static_cast<uint64_t>(amount);
+    split /= arith_uint256{static_cast<uint64_t>(total)};
+    return static_cast<CAmount>(split.GetLow64());
+}
+
+CKeyID RandomKeyID(FastRandomContext& rng)
+{
+    return CKeyID{uint160{rng.randbytes(20)}};
+}
+
+DelegationEntry MakeEntry(FastRandomContext& rng, const CKeyID& validator, CAmount amount, DelegationStatus status)
+{
+    DelegationEntry entry;
+    entry.delegatorId = RandomKeyID(rng);
+    entry.validatorId = validator;
+    entry.amount = amount;
+    entry.status = status;
+    return entry;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(delegationdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(reward_accrual_bounded_by_proportional_split)
+{
+    DelegationDB db(Params().GetConsensus());
+    const CKeyID validator{RandomKeyID(m_rng)};
+
+    std::vector<DelegationEntry> entries;
+    CAmount total{0};
+    for (int i = 0; i < 50; ++i) {
+        entries.push_back(MakeEntry(m_rng, validator, MIN_DELEGATION_AMOUNT + m_rng.randrange(MIN_DELEGATION_AMOUNT), DelegationStatus::ACTIVE));
+        total += entries.back().amount;
+    }
+    LoadDelegations(db, entries);
+    BOOST_CHECK_EQUAL(db.GetTotalDelegationForValidator(validator), total);
+
+    // A single block must give every delegator exactly floor(share * amount / total)
+    const CAmount share{m_rng.randrange(10 * COIN) + 1};
+    BOOST_CHECK(db.DistributeBlockReward(validator, share));
+    CAmount paid{0};
+    for (const auto& entry : db.GetDelegationsForValidator(validator)) {
+        BOOST_CHECK_EQUAL(entry.pendingRewards, ProportionalSplit(share, entry.amount, total));
+        paid += entry.pendingRewards;
+    }
+    BOOST_CHECK(paid <= share);
+
+    // Over n blocks the accrual is at least the sum of the per-block splits and
+    // less than n satoshis more, and never pays out more than was credited
+    std::map<CKeyID, CAmount> per_block;
+    for (const auto& entry : db.GetDelegationsForValidator(validator)) {
+        per_block[entry.delegatorId] = entry.pendingRewards;
+    }
+    CAmount credited{share};
+    int blocks{1};
+    for (; blocks <= 100; ++blocks) {
+        const CAmount block_share{m_rng.randrange(10 * COIN) + 1};
+        BOOST_CHECK(db.DistributeBlockReward(validator, block_share));
+        credited += block_share;
+        for (const auto& entry : entries) {
+            per_block[entry.delegatorId] += ProportionalSplit(block_share, entry.amount, total);
+        }
+    }
+    paid = 0;
+    for (const auto& entry : db.GetDelegationsForValidator(validator)) {
+        BOOST_CHECK(entry.pendingRewards >= per_block[entry.delegatorId]);
+        BOOST_CHECK(entry.pendingRewards < per_block[entry.delegatorId] + blocks);
+        paid += entry.pendingRewards;
+    }
+    BOOST_CHECK(paid <= credited);
+}
+
+BOOST_AUTO_TEST_CASE(reward_accrual_follows_status)
+{
+    DelegationDB db(Params().GetConsensus());
+    const CKeyID validator{RandomKeyID(m_rng)};
+
+    DelegationEntry active{MakeEntry(m_rng, validator, 3 * MIN_DELEGATION_AMOUNT, DelegationStatus::ACTIVE)};
+    DelegationEntry pending{MakeEntry(m_rng, validator, MIN_DELEGATION_AMOUNT, DelegationStatus::PENDING)};
+    LoadDelegations(db, {active, pending});
+
+    // Only active delegations earn
+    BOOST_CHECK(db.DistributeBlockReward(validator, 1000));
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(active.delegatorId), 1000);
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(pending.delegatorId), 0);
+
+    // Activation starts accrual from the current accumulator
+    BOOST_CHECK(db.SetDelegationStatus(pending.GetDelegationId(), DelegationStatus::ACTIVE));
+    BOOST_CHECK_EQUAL(db.GetTotalDelegationForValidator(validator), 4 * MIN_DELEGATION_AMOUNT);
+    BOOST_CHECK(db.DistributeBlockReward(validator, 1000));
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(active.delegatorId), 1750);
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(pending.delegatorId), 250);
+
+    // Leaving the active set keeps what was earned but stops accrual
+    BOOST_CHECK(db.SetDelegationStatus(active.GetDelegationId(), DelegationStatus::UNBONDING));
+    BOOST_CHECK(db.DistributeBlockReward(validator, 1000));
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(active.delegatorId), 1750);
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(pending.delegatorId), 1250);
+
+    // Claiming settles and resets
+    RewardClaimRequest claim;
+    claim.delegatorId = pending.delegatorId;
+    BOOST_CHECK_EQUAL(db.ProcessRewardClaim(claim), 1250);
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(pending.delegatorId), 0);
+    BOOST_CHECK(db.DistributeBlockReward(validator, 1000));
+    BOOST_CHECK_EQUAL(db.GetPendingRewardsForDelegator(pending.delegatorId), 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
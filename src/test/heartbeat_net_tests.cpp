@@ -0,0 +1,343 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <key.h>
+#include <netbase.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <trust/heartbeat_net.h>
+#include <validators/validatordb.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace trust;
+
+namespace {
+
+Consensus::Params TestParams()
+{
+    Consensus::Params params{Params().GetConsensus()};
+    params.nMinValidatorStake = 100;
+    params.nHeartbeatInterval = 10;
+    return params;
+}
+
+Heartbeat SignedHeartbeat(const CKey& key, int height)
+{
+    Heartbeat hb;
+    hb.validatorId = key.GetPubKey().GetID();
+    hb.blockHeight = height;
+    hb.timestamp = height;
+    BOOST_REQUIRE(hb.Sign(key));
+    return hb;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(heartbeat_net_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(heartbeat_signature)
+{
+    const CKey key{GenerateRandomKey()};
+    const CKey other{GenerateRandomKey()};
+
+    Heartbeat hb{SignedHeartbeat(key, 10)};
+    BOOST_CHECK(hb.Verify());
+    BOOST_CHECK(hb.Verify(key.GetPubKey()));
+    BOOST_CHECK(!hb.Verify(other.GetPubKey()));
+
+    // Signed by a different key than the one it claims
+    Heartbeat forged{SignedHeartbeat(other, 10)};
+    forged.validatorId = hb.validatorId;
+    BOOST_CHECK(!forged.Verify());
+
+    // Modified after signing
+    hb.blockHeight = 11;
+    BOOST_CHECK(!hb.Verify());
+}
+
+BOOST_AUTO_TEST_CASE(batched_verification)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager trustManager(params);
+    HeartbeatManager manager(trustManager, params, /*worker_threads_num=*/2);
+    manager.OnNewBlock(10);
+
+    std::vector<CKey> keys;
+    for (int i = 0; i < 40; ++i) {
+        keys.push_back(GenerateRandomKey());
+        BOOST_REQUIRE(trustManager.RegisterValidator(keys.back().GetPubKey().GetID(), 100, 0, 0));
+    }
+
+    for (const CKey& key : keys) {
+        BOOST_CHECK(manager.QueueHeartbeat(SignedHeartbeat(key, 10), /*from=*/0));
+    }
+
+    // Replays are dropped before verification
+    BOOST_CHECK(!manager.QueueHeartbeat(SignedHeartbeat(keys[0], 10), /*from=*/0));
+
+    // A bad signature only rejects its own heartbeat
+    Heartbeat forged{SignedHeartbeat(keys[1], 20)};
+    forged.validatorId = keys[2].GetPubKey().GetID();
+    BOOST_CHECK(manager.QueueHeartbeat(forged, /*from=*/0));
+    BOOST_CHECK_EQUAL(manager.GetStats().pendingHeartbeats, keys.size() + 1);
+
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), keys.size());
+    BOOST_CHECK_EQUAL(manager.GetStats().pendingHeartbeats, 0U);
+    for (const CKey& key : keys) {
+        BOOST_CHECK_EQUAL(trustManager.GetValidator(key.GetPubKey().GetID())->heartbeatsReceived, 1);
+    }
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_copy_does_not_suppress_heartbeat)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager trustManager(params);
+    HeartbeatManager manager(trustManager, params);
+    manager.OnNewBlock(10);
+
+    const CKey key{GenerateRandomKey()};
+    BOOST_REQUIRE(trustManager.RegisterValidator(key.GetPubKey().GetID(), 100, 0, 0));
+    const Heartbeat hb{SignedHeartbeat(key, 10)};
+
+    // The signature is not part of GetHash, a relayed copy can carry garbage
+    Heartbeat garbage{hb};
+    garbage.signature.assign(CPubKey::COMPACT_SIGNATURE_SIZE, 0x01);
+    BOOST_CHECK(garbage.GetHash() == hb.GetHash());
+    BOOST_CHECK(garbage.GetSignedHash() != hb.GetSignedHash());
+
+    // Queued path: both copies are verified, only the real one is accepted
+    BOOST_CHECK(manager.QueueHeartbeat(garbage, /*from=*/0));
+    BOOST_CHECK(manager.QueueHeartbeat(hb, /*from=*/1));
+    BOOST_CHECK(!manager.QueueHeartbeat(hb, /*from=*/1));
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), 1U);
+    BOOST_CHECK_EQUAL(trustManager.GetValidator(hb.validatorId)->heartbeatsReceived, 1);
+    BOOST_CHECK(!manager.QueueHeartbeat(hb, /*from=*/1));
+
+    // Synchronous path
+    const Heartbeat next{SignedHeartbeat(key, 20)};
+    Heartbeat nextGarbage{next};
+    nextGarbage.signature.assign(CPubKey::COMPACT_SIGNATURE_SIZE, 0x01);
+    manager.OnNewBlock(20);
+    BOOST_CHECK(!manager.ProcessHeartbeat(nextGarbage, /*from=*/0));
+    BOOST_CHECK(manager.ProcessHeartbeat(next, /*from=*/1));
+    BOOST_CHECK(!manager.ProcessHeartbeat(next, /*from=*/1));
+}
+
+BOOST_AUTO_TEST_CASE(legacy_der_heartbeat)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager trustManager(params);
+    HeartbeatManager manager(trustManager, params);
+    manager.OnNewBlock(10);
+
+    const CKey key{GenerateRandomKey()};
+    BOOST_REQUIRE(trustManager.RegisterValidator(key.GetPubKey().GetID(), 100, 0, 0));
+
+    // Signed the way nodes without compact heartbeat signatures do
+    Heartbeat hb;
+    hb.validatorId = key.GetPubKey().GetID();
+    hb.blockHeight = 10;
+    BOOST_REQUIRE(key.Sign(hb.GetHash(), hb.signature));
+    BOOST_CHECK(!hb.HasCompactSignature());
+    BOOST_CHECK(hb.Verify(key.GetPubKey()));
+    BOOST_CHECK(!hb.Verify());
+
+    // Not verifiable without the validator's registered key
+    BOOST_CHECK(!CheckHeartbeatSignature(hb, /*fromLegacyPeer=*/true));
+    validators::g_validator_db = std::make_unique<validators::ValidatorDB>(params);
+    BOOST_CHECK(!CheckHeartbeatSignature(hb, /*fromLegacyPeer=*/true));
+    BOOST_CHECK(manager.QueueHeartbeat(hb, /*from=*/1, /*fromLegacyPeer=*/true));
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), 0U);
+
+    validators::ValidatorEntry entry;
+    entry.validatorId = hb.validatorId;
+    entry.validatorPubKey = key.GetPubKey();
+    entry.stakeAmount = params.nMinValidatorStake;
+    BOOST_REQUIRE(validators::g_validator_db->RegisterValidator(entry));
+
+    // A DER heartbeat under another validator's ID is rejected and does not block the genuine one
+    Heartbeat impostor{hb};
+    BOOST_REQUIRE(GenerateRandomKey().Sign(impostor.GetHash(), impostor.signature));
+    BOOST_CHECK(!CheckHeartbeatSignature(impostor, /*fromLegacyPeer=*/true));
+    BOOST_CHECK(!manager.ProcessHeartbeat(impostor, /*from=*/1, /*fromLegacyPeer=*/true));
+
+    // Only accepted from peers that did not negotiate trust v2
+    BOOST_CHECK(!CheckHeartbeatSignature(hb, /*fromLegacyPeer=*/false));
+    BOOST_CHECK(CheckHeartbeatSignature(hb, /*fromLegacyPeer=*/true));
+    BOOST_CHECK(manager.QueueHeartbeat(hb, /*from=*/0));
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), 0U);
+    BOOST_CHECK(manager.QueueHeartbeat(hb, /*from=*/1, /*fromLegacyPeer=*/true));
+    BOOST_CHECK_EQUAL(manager.ProcessPendingHeartbeats(), 1U);
+    validators::g_validator_db.reset();
+
+    // Compact signatures are verified whatever the peer
+    Heartbeat forged{SignedHeartbeat(GenerateRandomKey(), 10)};
+    forged.validatorId = hb.validatorId;
+    BOOST_CHECK(!CheckHeartbeatSignature(forged, /*fromLegacyPeer=*/true));
+}
+
+BOOST_AUTO_TEST_CASE(synced_validator_checkin_deadline)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager trustManager(params);
+    HeartbeatManager manager(trustManager, params);
+    manager.OnNewBlock(500);
+
+    // A validator registered long ago is first seen through list sync
+    ValidatorInfo info;
+    info.validatorId = GenerateRandomKey().GetPubKey().GetID();
+    info.stakeAmount = 100;
+    info.registrationHeight = 0;
+    info.isActive = true;
+    ValidatorList list;
+    list.validators.push_back(info);
+    manager.ProcessValidatorList(list);
+    BOOST_REQUIRE(trustManager.GetValidator(info.validatorId));
+
+    // New blocks do not charge missed check-ins
+    manager.OnNewBlock(600);
+    BOOST_CHECK_EQUAL(trustManager.GetValidator(info.validatorId)->missedCheckIns, 0);
+
+    // Its first check-in is due relative to when it was seen, not registered
+    trustManager.RecordMissedCheckIns(520);
+    BOOST_CHECK_EQUAL(trustManager.GetValidator(info.validatorId)->missedCheckIns, 0);
+    trustManager.RecordMissedCheckIns(521);
+    BOOST_CHECK_EQUAL(trustManager.GetValidator(info.validatorId)->missedCheckIns, 1);
+}
+
+BOOST_AUTO_TEST_CASE(compact_encoding_roundtrip)
+{
+    const CKey key{GenerateRandomKey()};
+    Heartbeat hb{SignedHeartbeat(key, 123456)};
+    hb.nodeAddress = LookupNumeric("203.0.113.7", 18888);
+    BOOST_REQUIRE(hb.Sign(key));
+
+    DataStream legacy{};
+    legacy << hb;
+    DataStream compact{};
+    compact << Using<CompactHeartbeatFormatter>(hb);
+    BOOST_CHECK_LT(compact.size(), legacy.size());
+
+    Heartbeat decoded;
+    compact >> Using<CompactHeartbeatFormatter>(decoded);
+    BOOST_CHECK(decoded.GetHash() == hb.GetHash());
+    BOOST_CHECK(decoded.nodeAddress == hb.nodeAddress);
+    BOOST_CHECK(decoded.Verify());
+
+    ValidatorList list;
+    for (int i = 0; i < 3; ++i) {
+        ValidatorInfo info;
+        info.validatorId = GenerateRandomKey().GetPubKey().GetID();
+        info.stakeAmount = 100000 * COIN;
+        info.poolFeeRate = 500;
+        info.registrationHeight = 1000 + i;
+        info.lastHeartbeatHeight = 5000;
+        info.heartbeatsReceived = 42;
+        info.isActive = true;
+        info.lastKnownAddress = LookupNumeric("[2001:db8::1]:18888", 18888);
+        info.lastCheckInTime = 1700000000;
+        list.validators.push_back(info);
+    }
+
+    DataStream legacyList{};
+    legacyList << list;
+    DataStream compactList{};
+    compactList << Using<CompactValidatorListFormatter>(list);
+    BOOST_CHECK_LT(compactList.size(), legacyList.size());
+
+    ValidatorList decodedList;
+    compactList >> Using<CompactValidatorListFormatter>(decodedList);
+    BOOST_REQUIRE_EQUAL(decodedList.validators.size(), list.validators.size());
+    for (size_t i = 0; i < list.validators.size(); ++i) {
+        BOOST_CHECK(decodedList.validators[i].validatorId == list.validators[i].validatorId);
+        BOOST_CHECK_EQUAL(decodedList.validators[i].stakeAmount, list.validators[i].stakeAmount);
+        BOOST_CHECK_EQUAL(decodedList.validators[i].registrationHeight, list.validators[i].registrationHeight);
+        BOOST_CHECK(decodedList.validators[i].lastKnownAddress == list.validators[i].lastKnownAddress);
+    }
+
+    // Unknown encoding versions are rejected
+    DataStream future{};
+    future << uint8_t{TRUST_COMPACT_ENCODING_VERSION + 1};
+    Heartbeat rejected;
+    BOOST_CHECK_THROW(future >> Using<CompactHeartbeatFormatter>(rejected), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(validator_set_sync)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager responderTrust(params);
+    TrustScoreManager requesterTrust(params);
+    HeartbeatManager responder(responderTrust, params);
+    HeartbeatManager requester(requesterTrust, params);
+
+    auto random_id = [&] { return CKeyID{uint160{m_rng.randbytes(20)}}; };
+    for (int i = 0; i < 200; ++i) {
+        const CKeyID id{random_id()};
+        BOOST_REQUIRE(responderTrust.RegisterValidator(id, 100, 0, 0));
+        if (i >= 5) BOOST_REQUIRE(requesterTrust.RegisterValidator(id, 100, 0, 0));
+    }
+    // Known to the requester only
+    BOOST_REQUIRE(requesterTrust.RegisterValidator(random_id(), 100, 0, 0));
+
+    // First contact: the sketch resolves the difference, only missing entries move
+    ValidatorSyncRequest request{requester.CreateValidatorSyncRequest(uint256(), 0)};
+    BOOST_CHECK(!request.sketch.empty());
+    ValidatorSyncReply reply{responder.ProcessValidatorSyncRequest(request)};
+    BOOST_CHECK(reply.mode == ValidatorSyncReply::Mode::RECONCILED);
+    BOOST_CHECK_EQUAL(reply.validators.size(), 5U);
+    BOOST_CHECK(requester.ProcessValidatorSyncReply(reply));
+    BOOST_CHECK_EQUAL(requesterTrust.GetActiveValidators().size(), 201U);
+
+    // Steady state: nothing changed
+    request = requester.CreateValidatorSyncRequest(reply.changeSetId, reply.epoch);
+    BOOST_CHECK(request.sketch.empty());
+    ValidatorSyncReply idle{responder.ProcessValidatorSyncRequest(request)};
+    BOOST_CHECK(idle.mode == ValidatorSyncReply::Mode::IN_SYNC);
+    BOOST_CHECK(idle.validators.empty());
+
+    // Only the changes since the last epoch are sent
+    const CKeyID added{random_id()};
+    BOOST_REQUIRE(responderTrust.RegisterValidator(added, 100, 0, 0));
+    BOOST_REQUIRE(responderTrust.UpdatePoolFee(added, 200));
+    ValidatorSyncReply delta{responder.ProcessValidatorSyncRequest(request)};
+    BOOST_CHECK(delta.mode == ValidatorSyncReply::Mode::DELTA);
+    BOOST_REQUIRE_EQUAL(delta.validators.size(), 1U);
+    BOOST_CHECK(delta.validators[0].validatorId == added);
+    BOOST_CHECK(requester.ProcessValidatorSyncReply(delta));
+    BOOST_CHECK(requesterTrust.GetValidator(added));
+
+    // An unknown change set falls back to comparing set hashes
+    TrustScoreManager copyTrust(params);
+    HeartbeatManager copy(copyTrust, params);
+    for (const ValidatorInfo& info : responderTrust.GetActiveValidators()) {
+        BOOST_REQUIRE(copyTrust.RegisterValidator(info.validatorId, 100, 0, 0));
+    }
+    request = copy.CreateValidatorSyncRequest(m_rng.rand256(), 7);
+    BOOST_CHECK(responder.ProcessValidatorSyncRequest(request).mode == ValidatorSyncReply::Mode::IN_SYNC);
+
+    // Differences beyond the sketch capacity get the full list
+    TrustScoreManager strangerTrust(params);
+    HeartbeatManager stranger(strangerTrust, params);
+    for (size_t i = 0; i < VALIDATOR_SYNC_SKETCH_CAPACITY + 1; ++i) {
+        BOOST_REQUIRE(strangerTrust.RegisterValidator(random_id(), 100, 0, 0));
+    }
+    ValidatorSyncReply full{responder.ProcessValidatorSyncRequest(stranger.CreateValidatorSyncRequest(uint256(), 0))};
+    BOOST_CHECK(full.mode == ValidatorSyncReply::Mode::FULL);
+    BOOST_CHECK_EQUAL(full.validators.size(), 201U);
+
+    // Round trip through the wire encoding
+    DataStream stream{};
+    stream << delta;
+    ValidatorSyncReply decoded;
+    stream >> decoded;
+    BOOST_CHECK(decoded.mode == delta.mode);
+    BOOST_CHECK(decoded.changeSetId == delta.changeSetId);
+    BOOST_CHECK_EQUAL(decoded.epoch, delta.epoch);
+    BOOST_CHECK_EQUAL(decoded.validators.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
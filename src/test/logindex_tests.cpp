@@ -0,0 +1,161 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockstorage.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+using kernel::BlockTreeDB;
+
+static std::set<uint256> Flatten(const std::vector<std::vector<uint256>>& blocksOfHashes)
+{
+    std::set<uint256> result;
+    for (const auto& hashes : blocksOfHashes) {
+        result.insert(hashes.begin(), hashes.end());
+    }
+    return result;
+}
+
+BOOST_FIXTURE_TEST_SUITE(logindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(log_index_query_plan)
+{
+    BlockTreeDB db{DBParams{.path = m_args.GetDataDirNet() / "logindex", .cache_bytes = 1 << 20, .memory_only = true}};
+    const int tipHeight = 1000;
+
+    const dev::h160 addrA{"0x00000000000000000000000000000000000000aa"};
+    const dev::h160 addrB{"0x00000000000000000000000000000000000000bb"};
+    const dev::h160 addrC{"0x00000000000000000000000000000000000000cc"};
+    const dev::h256 topic0{m_rng.rand256().GetHex()};
+    const dev::h256 topic1{m_rng.rand256().GetHex()};
+    const dev::h256 topic2{m_rng.rand256().GetHex()};
+    const uint256 tx0{m_rng.rand256()};
+    const uint256 tx1{m_rng.rand256()};
+    const uint256 tx2{m_rng.rand256()};
+    const uint256 tx3{m_rng.rand256()};
+
+    // Height index entry written before the secondary indexes existed
+    BOOST_CHECK(db.WriteHeightIndex(CHeightTxIndexKey(5, addrA), {tx0}));
+
+    CBlockLogIndex block10(10);
+    block10.Add(tx1, addrA, {topic0, topic1});
+    block10.Add(tx1, addrA, {topic0});
+    CBlockLogIndex block20(20);
+    block20.Add(tx2, addrB, {topic0});
+    CBlockLogIndex block300(300);
+    block300.Add(tx3, addrA, {topic2});
+    BOOST_CHECK_EQUAL(block10.addresses.at(addrA).size(), 1U);
+    for (const auto* block : {&block10, &block20, &block300}) {
+        BOOST_CHECK(db.WriteLogIndex(*block));
+    }
+
+    auto read = [&](const CLogQuery& query, int expectedHeight) {
+        std::unique_ptr<CDBSnapshot> snapshot(db.NewSnapshot());
+        std::vector<std::vector<uint256>> blocksOfHashes;
+        BOOST_CHECK_EQUAL(db.ReadLogIndex(*snapshot, query, tipHeight, blocksOfHashes), expectedHeight);
+        return Flatten(blocksOfHashes);
+    };
+    auto plan = [&](const CLogQuery& query) {
+        std::unique_ptr<CDBSnapshot> snapshot(db.NewSnapshot());
+        return db.PlanLogQuery(*snapshot, query, tipHeight);
+    };
+
+    // Ranges starting before the secondary indexes fall back to the height index
+    CLogQuery query;
+    query.fromBlock = 1;
+    query.addresses = {addrA};
+    BOOST_CHECK(plan(query).index == CLogQueryPlan::Index::HEIGHT);
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx0, tx1, tx3}));
+
+    query.fromBlock = 10;
+    BOOST_CHECK(plan(query).index == CLogQueryPlan::Index::ADDRESS);
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx1, tx3}));
+
+    // Unfiltered queries always scan the height index
+    query.addresses.clear();
+    BOOST_CHECK(plan(query).index == CLogQueryPlan::Index::HEIGHT);
+
+    query.topics = {topic0};
+    CLogQueryPlan topicPlan = plan(query);
+    BOOST_CHECK(topicPlan.index == CLogQueryPlan::Index::TOPIC);
+    BOOST_CHECK(topicPlan.topicPositions == std::vector<uint8_t>{0});
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx1, tx2}));
+
+    query.topics = {std::nullopt, topic1};
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx1}));
+
+    // Any-topic queries scan every given position
+    query.topics = {topic2, topic1};
+    query.matchAllTopics = false;
+    topicPlan = plan(query);
+    BOOST_CHECK(topicPlan.topicPositions == std::vector<uint8_t>({0, 1}));
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx1, tx3}));
+    query.matchAllTopics = true;
+
+    // Address and topic filters combine
+    query.topics = {topic0};
+    query.addresses = {addrB, addrC};
+    BOOST_CHECK(read(query, 300) == std::set<uint256>({tx2}));
+
+    // A range whose bloom rules the filter out still advances the cursor
+    query.addresses.clear();
+    query.topics = {topic2};
+    query.toBlock = 200;
+    BOOST_CHECK(read(query, 20).empty());
+    query.toBlock = -1;
+
+    query.addresses = {addrC};
+    query.topics.clear();
+    BOOST_CHECK(read(query, 300).empty());
+
+    query.fromBlock = 400;
+    query.addresses = {addrA};
+    BOOST_CHECK(read(query, 0).empty());
+    query.fromBlock = 10;
+    query.toBlock = 5;
+    BOOST_CHECK(read(query, -1).empty());
+    query.toBlock = -1;
+
+    // Disconnecting a block removes its entries, but not from earlier snapshots.
+    // The range it was the last logged block of no longer reports its height.
+    std::unique_ptr<CDBSnapshot> snapshot(db.NewSnapshot());
+    BOOST_CHECK(db.EraseHeightIndex(300));
+    BOOST_CHECK(db.EraseLogIndex(block300));
+    BOOST_CHECK(read(query, 20) == std::set<uint256>({tx1}));
+    std::vector<std::vector<uint256>> blocksOfHashes;
+    BOOST_CHECK_EQUAL(db.ReadLogIndex(*snapshot, query, tipHeight, blocksOfHashes), 300);
+    BOOST_CHECK(Flatten(blocksOfHashes) == std::set<uint256>({tx1, tx3}));
+
+    // Confirmations are counted from the tip the snapshot was taken at
+    query.minconf = tipHeight - 20;
+    blocksOfHashes.clear();
+    BOOST_CHECK_EQUAL(db.ReadLogIndex(*snapshot, query, tipHeight, blocksOfHashes), 20);
+    BOOST_CHECK(Flatten(blocksOfHashes) == std::set<uint256>({tx1}));
+    query.minconf = 0;
+
+    // Replacement blocks in the same range report only the heights they reached
+    CBlockLogIndex block290(290);
+    block290.Add(tx2, addrA, {});
+    CBlockLogIndex block295(295);
+    block295.Add(tx3, addrA, {});
+    BOOST_CHECK(db.WriteLogIndex(block290));
+    BOOST_CHECK(db.WriteLogIndex(block295));
+    query.fromBlock = 256;
+    BOOST_CHECK(read(query, 295) == std::set<uint256>({tx2, tx3}));
+    BOOST_CHECK(db.EraseHeightIndex(295));
+    BOOST_CHECK(db.EraseLogIndex(block295));
+    BOOST_CHECK(read(query, 290) == std::set<uint256>({tx2}));
+    query.fromBlock = 10;
+
+    BOOST_CHECK(db.WipeLogIndex());
+    BOOST_CHECK(plan(query).index == CLogQueryPlan::Index::HEIGHT);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <key.h>
+#include <pos.h>
+#include <test/util/setup_common.h>
+#include <util/signstr.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(pos_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(kernel_batch_matches_single)
+{
+    std::vector<COutPoint> prevouts;
+    std::map<COutPoint, CStakeCache> cache;
+    for (int i = 0; i < 200; ++i) {
+        COutPoint prevout(Txid::FromUint256(m_rng.rand256()), m_rng.randrange(4));
+        prevouts.push_back(prevout);
+        // Leave some prevouts out of the cache and make some too young for the block
+        if (i % 10 == 0) continue;
+        uint32_t blockFromTime = i % 10 == 1 ? 2000 : 1000;
+        cache.emplace(prevout, CStakeCache(blockFromTime, 1 + m_rng.randrange(100000 * COIN)));
+    }
+
+    const int nReduceBlocktimeHeight = Params().GetConsensus().nReduceBlocktimeHeight;
+    for (int height : {std::max(nReduceBlocktimeHeight - 2, 0), nReduceBlocktimeHeight}) {
+        CBlockIndex indexPrev;
+        indexPrev.nHeight = height;
+        indexPrev.nStakeModifier = m_rng.rand256();
+        for (unsigned int nBits : {0x1d00ffffU, 0x1f00ffffU, 0x207fffffU}) {
+            std::vector<std::pair<size_t, uint256>> found;
+            CheckKernelCacheBatch(&indexPrev, nBits, 1500, prevouts, cache, found);
+
+            std::vector<std::pair<size_t, uint256>> expected;
+            for (size_t i = 0; i < prevouts.size(); ++i) {
+                uint256 hashProofOfStake;
+                if (CheckKernelCache(&indexPrev, nBits, 1500, prevouts[i], cache, hashProofOfStake)) {
+                    expected.emplace_back(i, hashProofOfStake);
+                }
+            }
+            BOOST_CHECK(found == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(header_signers_recovery)
+{
+    const CKey staker = GenerateRandomKey();
+    const CKey owner = GenerateRandomKey();
+    const CKeyID stakerID = staker.GetPubKey().GetID();
+
+    CBlockHeader header;
+    header.nTime = 1000;
+    header.prevoutStake = COutPoint(Txid::FromUint256(m_rng.rand256()), 1);
+
+    // The staker signs the header
+    std::vector<unsigned char> sig;
+    BOOST_REQUIRE(staker.SignCompact(header.GetHashWithoutSign(), sig));
+    header.SetBlockSignature(sig);
+    HeaderSigners signers = RecoverHeaderSigners(header);
+    BOOST_CHECK(signers.fRecovered);
+    BOOST_CHECK(signers.staker == stakerID);
+
+    // The coin owner signs the staker address in the proof of delegation
+    std::vector<unsigned char> vchPoD;
+    BOOST_REQUIRE(SignStr::SignMessage(owner, stakerID.GetReverseHex(), vchPoD));
+    header.SetProofOfDelegation(vchPoD);
+    header.SetBlockSignature(sig);
+    signers = RecoverHeaderSigners(header);
+    BOOST_CHECK(signers.fRecovered);
+    BOOST_CHECK(signers.staker == stakerID);
+    BOOST_CHECK(signers.delegator == owner.GetPubKey().GetID());
+
+    // Changing the header after it was signed does not recover the staker
+    header.nTime += 16;
+    signers = RecoverHeaderSigners(header);
+    BOOST_CHECK(!signers.fRecovered || signers.staker != stakerID);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,10 @@
 #include <test/util/setup_common.h>
 #include <test/qtumtests/test_utils.h>
 #include <chainparams.h>
+#include <consensus/merkle.h>
+#include <libdevcore/TrieNodeCache.h>
+#include <node/miner.h>
+#include <pow.h>
 
 namespace ButecodeExecTest{
 
@@ -387,6 +391,174 @@ BOOST_AUTO_TEST_CASE(bytecodeexec_contract_create_contracts){
     BOOST_CHECK(result.second.valueTransfers.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(bytecodeexec_state_written_on_commit){
+    genesisLoading();
+    ChainstateManager& chainman = *m_node.chainman;
+    CBlock block(generateBlock());
+    QtumTransaction txEth = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, txEth), 40000000, chainman.ActiveChain().Tip(), chainman.ActiveChain());
+    BOOST_CHECK(exec.performByteCode());
+    dev::h256 root = globalState->rootHash();
+
+    // A view of the database without the in-memory overlay
+    auto onDisk = [&](dev::h256 const& hash) {
+        dev::OverlayDB db(globalState->db());
+        db.rollback();
+        return db.exists(hash);
+    };
+
+    // Executed state is readable but not written until commit
+    BOOST_CHECK(globalState->db().exists(root));
+    BOOST_CHECK(!onDisk(root));
+    globalState->db().commit();
+    globalState->dbUtxo().commit();
+    BOOST_CHECK(onDisk(root));
+
+    // Rolled back state is never written
+    QtumTransaction txEth2 = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address(), 1);
+    ByteCodeExec exec2(block, std::vector<QtumTransaction>(1, txEth2), 40000000, chainman.ActiveChain().Tip(), chainman.ActiveChain());
+    BOOST_CHECK(exec2.performByteCode());
+    dev::h256 root2 = globalState->rootHash();
+    BOOST_CHECK(root2 != root);
+    globalState->db().rollback();
+    globalState->dbUtxo().rollback();
+    globalState->setRoot(root);
+    globalState->db().commit();
+    BOOST_CHECK(!onDisk(root2));
+    BOOST_CHECK(onDisk(root));
+
+    // Discarding drops the pending nodes but keeps the staged ones
+    QtumTransaction txEth3 = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address(), 2);
+    ByteCodeExec exec3(block, std::vector<QtumTransaction>(1, txEth3), 40000000, chainman.ActiveChain().Tip(), chainman.ActiveChain());
+    BOOST_CHECK(exec3.performByteCode());
+    dev::h256 root3 = globalState->rootHash();
+    const dev::bytes pending{1, 2, 3};
+    globalState->db().insert(dev::sha3(pending), &pending);
+    globalState->db().discard();
+    BOOST_CHECK(!globalState->db().exists(dev::sha3(pending)));
+    BOOST_CHECK(globalState->db().exists(root3));
+    globalState->db().commit();
+    globalState->dbUtxo().commit();
+    BOOST_CHECK(onDisk(root3));
+    BOOST_CHECK(!onDisk(dev::sha3(pending)));
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_trie_node_cache){
+    dev::TrieNodeCache& cache = dev::trieNodeCache();
+    cache.clear();
+    cache.setMaxSize(1 << 20);
+    genesisLoading();
+    ChainstateManager& chainman = *m_node.chainman;
+    CBlock block(generateBlock());
+    QtumTransaction txEth = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, txEth), 40000000, chainman.ActiveChain().Tip(), chainman.ActiveChain());
+    BOOST_CHECK(exec.performByteCode());
+    dev::h256 root = globalState->rootHash();
+    globalState->db().commit();
+
+    // Committed nodes are served from the cache
+    dev::TrieNodeCache::Stats stats = cache.stats();
+    BOOST_CHECK(stats.entries > 0);
+    BOOST_CHECK(stats.usage <= stats.maxSize);
+    dev::OverlayDB db(globalState->db());
+    BOOST_CHECK(!db.lookup(root).empty());
+    BOOST_CHECK_EQUAL(cache.stats().hits, stats.hits + 1);
+
+    // Shrinking evicts the least recently used nodes first
+    std::string node;
+    cache.setMaxSize(cache.stats().usage - 1);
+    BOOST_CHECK(cache.lookup(root, node));
+    BOOST_CHECK_EQUAL(cache.stats().entries, stats.entries - 1);
+
+    // Evicted nodes are read from the database again
+    cache.setMaxSize(0);
+    BOOST_CHECK_EQUAL(cache.stats().entries, 0U);
+    BOOST_CHECK(db.exists(root));
+    BOOST_CHECK(!cache.lookup(root, node));
+}
+
+BOOST_FIXTURE_TEST_CASE(bytecodeexec_assembly_exec_cache, TestChain100Setup){
+    ChainstateManager& chainman = *m_node.chainman;
+    Chainstate& chainstate = chainman.ActiveChainstate();
+    bool oldLogEvents = fLogEvents;
+    fLogEvents = true;
+
+    // A contract deployment in the mempool
+    CScript coinbaseScript = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    CScript create = CScript() << CScriptNum(VersionVM::GetEVMDefault().toRaw()) << CScriptNum(500000) << CScriptNum(int64_t(DEFAULT_MIN_GAS_PRICE_DGP)) << CODE[0] << OP_CREATE;
+    CTransactionRef input = m_coinbase_txns[0];
+    CMutableTransaction tx = CreateValidMempoolTransaction({input}, {COutPoint(input->GetHash(), 0)}, 1, {coinbaseKey},
+                                                           {CTxOut(0, create), CTxOut(input->vout[0].nValue - COIN, coinbaseScript)});
+
+    // Assembling a block records the execution of the deployment
+    node::BlockAssembler::Options options;
+    options.coinbase_output_script = coinbaseScript;
+    CBlock block = node::BlockAssembler{chainstate, m_node.mempool.get(), options}.CreateNewBlock()->block;
+    BOOST_REQUIRE_EQUAL(block.vtx.size(), 2U);
+    BOOST_REQUIRE(block.vtx[1]->GetHash() == tx.GetHash());
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainman.GetConsensus())) ++block.nNonce;
+
+    {
+        LOCK(cs_main);
+        CBlockIndex* tip = chainman.ActiveChain().Tip();
+        dev::h256 stateRoot = uintToh256(tip->hashStateRoot);
+        dev::h256 utxoRoot = uintToh256(tip->hashUTXORoot);
+        QtumDGP qtumDGP(globalState.get(), chainstate, fGettingValuesDGP);
+        uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(tip->nHeight + 1);
+        unsigned int contractflags = GetContractScriptFlags(tip->nHeight + 1, chainman.GetConsensus());
+        QtumTxConverter convert(*block.vtx[1], chainstate, m_node.mempool.get(), NULL, &block.vtx, contractflags);
+        ExtractQtumTX extracted;
+        BOOST_REQUIRE(convert.extractionQtumTransactions(extracted));
+        ByteCodeExec exec(block, extracted.first, blockGasLimit, tip, chainman.ActiveChain());
+        dev::h256 envHash = exec.environmentHash();
+        dev::h256 execHash = ByteCodeExec::executionHash(extracted.first);
+
+        // Only the same execution in the same block environment is found
+        BOOST_CHECK(g_assembly_exec_cache.Find(stateRoot, utxoRoot, tx.GetHash(), 1, envHash, execHash));
+        BOOST_CHECK(!g_assembly_exec_cache.Find(stateRoot, utxoRoot, tx.GetHash(), 1, dev::sha3(envHash), execHash));
+        BOOST_CHECK(!g_assembly_exec_cache.Find(stateRoot, utxoRoot, tx.GetHash(), 1, envHash, dev::sha3(execHash)));
+        BOOST_CHECK(!g_assembly_exec_cache.Find(stateRoot, utxoRoot, tx.GetHash(), 2, envHash, execHash));
+    }
+
+    // Connect the block with the recorded results
+    BOOST_REQUIRE(chainman.ProcessNewBlock(std::make_shared<const CBlock>(block), true, true, nullptr));
+    CBlockIndex* pindex = WITH_LOCK(cs_main, return chainman.ActiveChain().Tip());
+    BOOST_REQUIRE(pindex->GetBlockHash() == block.GetHash());
+    dev::h256 stateRoot = globalState->rootHash();
+    dev::h256 utxoRoot = globalState->rootHashUTXO();
+    std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(tx.GetHash()));
+    BOOST_REQUIRE_EQUAL(receipts.size(), 1U);
+    BOOST_CHECK(receipts[0].excepted == dev::eth::TransactionException::None);
+    BOOST_CHECK(globalState->addressInUse(receipts[0].contractAddress));
+
+    // Connect it again with the contract executed
+    BlockValidationState state;
+    BOOST_REQUIRE(chainstate.InvalidateBlock(state, pindex));
+    BOOST_CHECK(pstorageresult->getResult(uintToh256(tx.GetHash())).empty());
+    {
+        LOCK(cs_main);
+        g_assembly_exec_cache.Clear();
+        chainstate.ResetBlockFailureFlags(pindex);
+    }
+    BOOST_REQUIRE(chainstate.ActivateBestChain(state));
+    BOOST_REQUIRE(WITH_LOCK(cs_main, return chainman.ActiveChain().Tip()) == pindex);
+    BOOST_CHECK(globalState->rootHash() == stateRoot);
+    BOOST_CHECK(globalState->rootHashUTXO() == utxoRoot);
+    std::vector<TransactionReceiptInfo> executed = pstorageresult->getResult(uintToh256(tx.GetHash()));
+    BOOST_REQUIRE_EQUAL(executed.size(), 1U);
+    BOOST_CHECK(executed[0].contractAddress == receipts[0].contractAddress);
+    BOOST_CHECK_EQUAL(executed[0].gasUsed, receipts[0].gasUsed);
+    BOOST_CHECK_EQUAL(executed[0].cumulativeGasUsed, receipts[0].cumulativeGasUsed);
+    BOOST_CHECK(executed[0].excepted == receipts[0].excepted);
+    BOOST_CHECK(executed[0].stateRoot == receipts[0].stateRoot);
+    BOOST_CHECK(executed[0].utxoRoot == receipts[0].utxoRoot);
+    BOOST_CHECK(executed[0].bloom == receipts[0].bloom);
+    BOOST_CHECK_EQUAL(executed[0].logs.size(), receipts[0].logs.size());
+
+    fLogEvents = oldLogEvents;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,68 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+#include <trust/replaycache.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace trust;
+using Result = HeartbeatReplayCache::Result;
+
+BOOST_FIXTURE_TEST_SUITE(replaycache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(insert_and_expire)
+{
+    HeartbeatReplayCache cache(/*periodBlocks=*/10, /*entriesPerGeneration=*/1024);
+    cache.SetHeight(100);
+
+    const uint256 hash{m_rng.rand256()};
+    BOOST_CHECK(!cache.Contains(hash, 100));
+    BOOST_CHECK(cache.Insert(hash, 100) == Result::NEW);
+    BOOST_CHECK(cache.Contains(hash, 100));
+    BOOST_CHECK(cache.Insert(hash, 100) == Result::SEEN);
+    BOOST_CHECK_EQUAL(cache.Count(), 1U);
+
+    // The window covers two past periods, the current one and the next
+    BOOST_CHECK(cache.Insert(m_rng.rand256(), 80) == Result::NEW);
+    BOOST_CHECK(cache.Insert(m_rng.rand256(), 119) == Result::NEW);
+    BOOST_CHECK(cache.Insert(m_rng.rand256(), 79) == Result::STALE);
+    BOOST_CHECK(cache.Insert(m_rng.rand256(), 120) == Result::STALE);
+    BOOST_CHECK(cache.Insert(m_rng.rand256(), -1) == Result::STALE);
+
+    // Going back does not expire anything
+    cache.SetHeight(50);
+    BOOST_CHECK(cache.Contains(hash, 100));
+
+    // Still inside the window two periods later, gone after three
+    cache.SetHeight(120);
+    BOOST_CHECK(cache.Contains(hash, 100));
+    cache.SetHeight(130);
+    BOOST_CHECK(!cache.Contains(hash, 100));
+    BOOST_CHECK(cache.Insert(hash, 100) == Result::STALE);
+    BOOST_CHECK_EQUAL(cache.Count(), 1U);
+
+    // A jump past the whole window clears everything
+    cache.SetHeight(1000);
+    BOOST_CHECK_EQUAL(cache.Count(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_under_flood)
+{
+    HeartbeatReplayCache cache(/*periodBlocks=*/10, /*entriesPerGeneration=*/1024);
+    const size_t memory{cache.MemoryUsage()};
+
+    for (int i = 0; i < 100000; ++i) {
+        cache.Insert(m_rng.rand256(), 5);
+    }
+    BOOST_CHECK_EQUAL(cache.MemoryUsage(), memory);
+    BOOST_CHECK_LE(cache.Count(), 1024U);
+
+    // The most recent insert is always retained
+    const uint256 hash{m_rng.rand256()};
+    BOOST_CHECK(cache.Insert(hash, 5) == Result::NEW);
+    BOOST_CHECK(cache.Insert(hash, 5) == Result::SEEN);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,198 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/receiptformat.h>
+#include <qtum/storageresults.h>
+
+#include <test/util/setup_common.h>
+#include <util/convert.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <leveldb/db.h>
+
+#include <memory>
+#include <vector>
+
+static std::vector<TransactionReceiptInfo> MakeResult(const uint256& txid, size_t dataSize)
+{
+    TransactionReceiptInfo tri{};
+    tri.transactionHash = txid;
+    tri.logs.emplace_back(dev::Address(), dev::h256s{dev::h256()}, dev::bytes(dataSize));
+    return {tri};
+}
+
+BOOST_FIXTURE_TEST_SUITE(storageresults_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(storageresults_cache_bounded)
+{
+    const size_t dataSize = 10000;
+    StorageResults results(PathToString(m_args.GetDataDirNet()), 5 * dataSize);
+
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 20; ++i) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        txs.push_back(MakeTransactionRef(mtx));
+        std::vector<TransactionReceiptInfo> result = MakeResult(txs.back()->GetHash(), dataSize);
+        results.addResult(uintToh256(txs.back()->GetHash()), result);
+    }
+
+    // Uncommitted results are readable but not cached
+    BOOST_CHECK_EQUAL(results.getResult(uintToh256(txs[0]->GetHash())).size(), 1U);
+    BOOST_CHECK_EQUAL(results.getCacheStats().entries, 0U);
+
+    // Committing keeps only the results that fit in the cache
+    results.commitResults();
+    StorageResults::CacheStats stats = results.getCacheStats();
+    BOOST_CHECK(stats.entries > 0 && stats.entries < txs.size());
+    BOOST_CHECK(stats.usage <= stats.maxSize);
+
+    // Every result is read back from disk and then from the cache
+    for (const CTransactionRef& tx : txs) {
+        for (int i = 0; i < 2; ++i) {
+            std::vector<TransactionReceiptInfo> result = results.getResult(uintToh256(tx->GetHash()));
+            BOOST_REQUIRE_EQUAL(result.size(), 1U);
+            BOOST_CHECK(result[0].transactionHash == tx->GetHash());
+            BOOST_CHECK_EQUAL(result[0].logs[0].data.size(), dataSize);
+        }
+    }
+    stats = results.getCacheStats();
+    BOOST_CHECK(stats.hits >= txs.size() && stats.misses > 0);
+    BOOST_CHECK(stats.usage <= stats.maxSize);
+
+    // Deleted results are gone from the cache and the disk
+    results.deleteResults(txs);
+    BOOST_CHECK_EQUAL(results.getCacheStats().entries, 0U);
+    BOOST_CHECK_EQUAL(results.getCacheStats().usage, 0U);
+    for (const CTransactionRef& tx : txs) {
+        BOOST_CHECK(results.getResult(uintToh256(tx->GetHash())).empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_receipt_format)
+{
+    const dev::h256 topic0{m_rng.rand256().GetHex()};
+    const dev::h256 topic1{m_rng.rand256().GetHex()};
+
+    TransactionReceiptInfo tri{};
+    tri.blockHash = m_rng.rand256();
+    tri.blockNumber = 100;
+    tri.transactionHash = m_rng.rand256();
+    tri.transactionIndex = 2;
+    tri.from = dev::Address("0x00000000000000000000000000000000000000aa");
+    tri.cumulativeGasUsed = 50000;
+    tri.gasUsed = 21000;
+    tri.excepted = dev::eth::TransactionException::OutOfGas;
+    tri.exceptedMessage = "out of gas";
+    tri.outputIndex = 1;
+    tri.logs.emplace_back(dev::Address("0x00000000000000000000000000000000000000bb"), dev::h256s{topic0, topic1}, dev::bytes{1, 2, 3});
+    tri.logs.emplace_back(dev::Address("0x00000000000000000000000000000000000000cc"), dev::h256s{}, dev::bytes{});
+    tri.createdContracts.emplace_back(dev::Address("0x00000000000000000000000000000000000000dd"), dev::bytes{0x60, 0x00});
+    tri.destructedContracts.push_back(dev::Address("0x00000000000000000000000000000000000000ee"));
+
+    TransactionReceiptInfo empty{};
+    std::vector<uint8_t> data = SerializeReceipts({tri, empty});
+    ReceiptsView receipts(data);
+    BOOST_REQUIRE(receipts.isValid());
+    BOOST_REQUIRE_EQUAL(receipts.size(), 2U);
+
+    // Logs are read in place
+    ReceiptView receipt = receipts[0];
+    BOOST_CHECK(receipt.transactionHash() == tri.transactionHash);
+    BOOST_CHECK_EQUAL(receipt.blockNumber(), 100U);
+    BOOST_REQUIRE_EQUAL(receipt.logCount(), 2U);
+    BOOST_CHECK(receipt.log(0).address() == tri.logs[0].address);
+    BOOST_CHECK_EQUAL(receipt.log(0).topicCount(), 2U);
+    BOOST_CHECK(receipt.log(0).topicEquals(1, topic1));
+    BOOST_CHECK(!receipt.log(0).topicEquals(0, topic1));
+    BOOST_CHECK(!receipt.log(1).topicEquals(0, topic0));
+    BOOST_CHECK_EQUAL(receipt.log(0).logData().size(), 3U);
+    BOOST_CHECK_EQUAL(receipts[1].logCount(), 0U);
+
+    std::vector<TransactionReceiptInfo> result = receipts.materialize();
+    BOOST_REQUIRE_EQUAL(result.size(), 2U);
+    BOOST_CHECK(result[0].blockHash == tri.blockHash);
+    BOOST_CHECK(result[0].from == tri.from);
+    BOOST_CHECK_EQUAL(result[0].gasUsed, tri.gasUsed);
+    BOOST_CHECK(result[0].excepted == tri.excepted);
+    BOOST_CHECK_EQUAL(result[0].exceptedMessage, tri.exceptedMessage);
+    BOOST_REQUIRE_EQUAL(result[0].logs.size(), tri.logs.size());
+    for (size_t i = 0; i < tri.logs.size(); i++) {
+        BOOST_CHECK(result[0].logs[i].address == tri.logs[i].address);
+        BOOST_CHECK(result[0].logs[i].topics == tri.logs[i].topics);
+        BOOST_CHECK(result[0].logs[i].data == tri.logs[i].data);
+    }
+    BOOST_CHECK(result[0].createdContracts == tri.createdContracts);
+    BOOST_CHECK(result[0].destructedContracts == tri.destructedContracts);
+    BOOST_CHECK(result[1].logs.empty());
+
+    // Damaged values are rejected
+    for (size_t size : {size_t{0}, size_t{1}, data.size() / 2, data.size() - 1}) {
+        BOOST_CHECK(!ReceiptsView(std::span<const uint8_t>(data).first(size)).isValid());
+    }
+    data.push_back(0);
+    BOOST_CHECK(!ReceiptsView(data).isValid());
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_legacy_migration)
+{
+    const std::string path = PathToString(m_args.GetDataDirNet() / "legacy");
+    const uint256 txid = m_rng.rand256();
+    const dev::h256 hashTx = uintToh256(txid);
+    const dev::h256 topic{m_rng.rand256().GetHex()};
+    const dev::Address address("0x00000000000000000000000000000000000000aa");
+
+    // A result in the RLP format with the fields of the first release
+    {
+        fs::create_directories(fs::PathFromString(path));
+        leveldb::Options options;
+        options.create_if_missing = true;
+        leveldb::DB* db;
+        BOOST_REQUIRE(leveldb::DB::Open(options, path + "/resultsDB", &db).ok());
+        logEntriesSerialize logs{{address, {{topic}, {7}}}};
+        dev::RLPStream stream(10);
+        stream << std::vector<dev::h256>{dev::h256()} << std::vector<uint32_t>{5} << std::vector<dev::h256>{hashTx} << std::vector<uint32_t>{1};
+        stream << std::vector<dev::h160>{address} << std::vector<dev::h160>{address} << std::vector<dev::u256>{100} << std::vector<dev::u256>{100};
+        stream << std::vector<dev::h160>{dev::h160()} << std::vector<logEntriesSerialize>{logs};
+        dev::bytes value = stream.out();
+        BOOST_REQUIRE(db->Put(leveldb::WriteOptions(), hashTx.hex(), std::string(value.begin(), value.end())).ok());
+        delete db;
+    }
+
+    auto check = [&](const std::vector<TransactionReceiptInfo>& result) {
+        BOOST_REQUIRE_EQUAL(result.size(), 1U);
+        BOOST_CHECK_EQUAL(result[0].blockNumber, 5U);
+        BOOST_REQUIRE_EQUAL(result[0].logs.size(), 1U);
+        BOOST_CHECK(result[0].logs[0].topics == dev::h256s{topic});
+        BOOST_CHECK(result[0].logs[0].data == dev::bytes{7});
+        BOOST_CHECK(result[0].excepted == dev::eth::TransactionException::NoInformation);
+    };
+
+    {
+        StorageResults results(path);
+
+        // Legacy results are readable before they are migrated
+        check(results.getResult(hashTx));
+        std::unique_ptr<StorageResultsView> view = results.getView();
+        check(view->getResult(hashTx, [&](const ReceiptView& receipt) { return receipt.log(0).topicEquals(0, topic); }));
+        BOOST_CHECK(view->getResult(hashTx, [](const ReceiptView&) { return false; }).empty());
+        view.reset();
+
+        // They are migrated without any new results being committed
+        BOOST_CHECK(!results.migrateLegacyResults());
+        BOOST_CHECK(!results.migrateLegacyResults());
+        check(results.getView()->getResult(hashTx));
+    }
+
+    leveldb::DB* db;
+    BOOST_REQUIRE(leveldb::DB::Open(leveldb::Options(), path + "/resultsDB", &db).ok());
+    std::string value;
+    BOOST_CHECK(db->Get(leveldb::ReadOptions(), RESULTS_VERSION_KEY, &value).ok());
+    BOOST_CHECK(db->Get(leveldb::ReadOptions(), hashTx.hex(), &value).IsNotFound());
+    BOOST_CHECK(db->Get(leveldb::ReadOptions(), std::string(reinterpret_cast<const char*>(hashTx.data()), 32), &value).ok());
+    delete db;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <test/util/setup_common.h>
+#include <trust/trustscore.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace trust;
+
+namespace {
+
+Consensus::Params TestParams()
+{
+    Consensus::Params params{Params().GetConsensus()};
+    params.nMinValidatorStake = 100;
+    params.nHeartbeatInterval = 10;
+    params.nUptimeWindow = 1000;
+    return params;
+}
+
+CKeyID RandomKeyID(FastRandomContext& rng)
+{
+    return CKeyID{uint160{rng.randbytes(20)}};
+}
+
+bool SendHeartbeat(TrustScoreManager& manager, const CKeyID& id, int height)
+{
+    Heartbeat hb;
+    hb.validatorId = id;
+    hb.blockHeight = height;
+    return manager.ProcessHeartbeat(hb, height);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(trustscore_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(expected_heartbeats_evaluated_on_read)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager manager(params);
+    const CKeyID id{RandomKeyID(m_rng)};
+    BOOST_REQUIRE(manager.RegisterValidator(id, 100, 0, 0));
+
+    BOOST_CHECK(SendHeartbeat(manager, id, 10));
+    BOOST_CHECK(!SendHeartbeat(manager, id, 15));
+    BOOST_CHECK(SendHeartbeat(manager, id, 20));
+
+    manager.UpdateHeartbeatExpectations(30);
+    auto info = manager.GetValidator(id);
+    BOOST_REQUIRE(info);
+    BOOST_CHECK_EQUAL(info->heartbeatsExpected, 3);
+    BOOST_CHECK_EQUAL(info->heartbeatsReceived, 2);
+    BOOST_CHECK_EQUAL(info->GetUptimePercentage(), 666);
+
+    // Expectations are capped by the uptime window
+    manager.UpdateHeartbeatExpectations(5000);
+    BOOST_CHECK_EQUAL(manager.GetValidator(id)->heartbeatsExpected, 100);
+    BOOST_CHECK_EQUAL(manager.GetActiveValidators().at(0).heartbeatsExpected, 100);
+
+    // Deactivation freezes the expectation
+    manager.UpdateHeartbeatExpectations(50);
+    BOOST_CHECK(manager.DeactivateValidator(id));
+    manager.UpdateHeartbeatExpectations(500);
+    BOOST_CHECK_EQUAL(manager.GetValidator(id)->heartbeatsExpected, 5);
+}
+
+BOOST_AUTO_TEST_CASE(missed_checkins_by_deadline)
+{
+    const Consensus::Params params{TestParams()};
+    TrustScoreManager manager(params);
+    const CKeyID alive{RandomKeyID(m_rng)};
+    const CKeyID silent{RandomKeyID(m_rng)};
+    BOOST_REQUIRE(manager.RegisterValidator(alive, 100, 0, 0));
+    BOOST_REQUIRE(manager.RegisterValidator(silent, 100, 0, 0));
+    BOOST_CHECK_EQUAL(manager.GetPendingCheckInCount(), 2U);
+
+    BOOST_CHECK(SendHeartbeat(manager, alive, 10));
+    BOOST_CHECK(SendHeartbeat(manager, alive, 20));
+
+    // Deadline is two intervals after the last heartbeat
+    manager.RecordMissedCheckIns(20);
+    BOOST_CHECK_EQUAL(manager.GetValidator(silent)->missedCheckIns, 0);
+
+    manager.RecordMissedCheckIns(21);
+    BOOST_CHECK_EQUAL(manager.GetValidator(silent)->missedCheckIns, 1);
+    BOOST_CHECK_EQUAL(manager.GetValidator(alive)->missedCheckIns, 0);
+
+    // Repeated calls within the same interval do not count again
+    manager.RecordMissedCheckIns(25);
+    BOOST_CHECK_EQUAL(manager.GetValidator(silent)->missedCheckIns, 1);
+
+    // A gap spanning several intervals counts each of them
+    manager.RecordMissedCheckIns(45);
+    BOOST_CHECK_EQUAL(manager.GetValidator(silent)->missedCheckIns, 3);
+    BOOST_CHECK_EQUAL(manager.GetValidator(alive)->missedCheckIns, 1);
+    BOOST_CHECK_EQUAL(manager.GetValidator(alive)->consecutiveCheckIns, 0);
+
+    // Inactive validators leave the queue
+    BOOST_CHECK(manager.DeactivateValidator(silent));
+    BOOST_CHECK_EQUAL(manager.GetPendingCheckInCount(), 1U);
+    manager.RecordMissedCheckIns(100);
+    BOOST_CHECK_EQUAL(manager.GetValidator(silent)->missedCheckIns, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -30,6 +30,7 @@
 #include <noui.h>
 #include <policy/fees.h>
 #include <pow.h>
+#include <qtum/callstate.h>
 #include <random.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -248,6 +249,7 @@ ChainTestingSetup::ChainTestingSetup(const ChainType chainType, TestOpts opts)
     globalState->db().commit();
     globalState->dbUtxo().commit();
     pstorageresult.reset(new StorageResults(pathTemp.string()));
+    pcallstatepool.reset(new CallStatePool());
 //////////////////////////////////////////////////////////////
 
     bilingual_str error{};
@@ -303,6 +305,7 @@ ChainTestingSetup::~ChainTestingSetup()
     m_node.scheduler.reset();
 
 /////////////////////////////////////////////// // qtum
+    pcallstatepool.reset();
     delete globalState.release();
     globalSealEngine.reset();
 ///////////////////////////////////////////////
@@ -9,10 +9,13 @@
 #include <hash.h>
 #include <net.h>
 #include <signet.h>
+#include <undo.h>
 #include <uint256.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
+#include <map>
+#include <memory>
 #include <string>
 
 #include <test/util/setup_common.h>
@@ -396,4 +399,118 @@ BOOST_AUTO_TEST_CASE(block_malleation)
     }
 }
 
+BOOST_AUTO_TEST_CASE(spent_coin_journal)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const int blocks = consensusParams.CoinbaseMaturity(0) + 5;
+
+    std::vector<uint256> hashes(blocks + 1);
+    std::vector<CBlockIndex> indexes(blocks + 1);
+    std::vector<COutPoint> spent(blocks + 1);
+    SpentCoinJournal journal;
+    for (int height = 1; height <= blocks; ++height) {
+        hashes[height] = m_rng.rand256();
+        indexes[height].phashBlock = &hashes[height];
+        indexes[height].nHeight = height;
+        indexes[height].pprev = height > 1 ? &indexes[height - 1] : nullptr;
+        spent[height] = COutPoint(Txid::FromUint256(m_rng.rand256()), 0);
+
+        // A coinbase and a transaction spending one coin worth the height
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(spent[height]);
+        block.vtx.push_back(MakeTransactionRef(mtx));
+        CBlockUndo blockundo;
+        blockundo.vtxundo.emplace_back();
+        blockundo.vtxundo.back().vprevout.emplace_back(CTxOut(height, CScript()), height - 1, false, false);
+
+        journal.Connect(&indexes[height], block, blockundo, consensusParams);
+    }
+
+    Coin coin;
+    int scanHeight;
+    const CBlockIndex* tip = &indexes[blocks];
+
+    // Spends in the window are found without reading blocks
+    BOOST_CHECK(journal.Find(tip, spent[blocks - 1], blocks - 10, coin, scanHeight));
+    BOOST_CHECK_EQUAL(coin.out.nValue, blocks - 1);
+
+    // Spends at or below the fork are not returned
+    BOOST_CHECK(!journal.Find(tip, spent[blocks - 10], blocks - 10, coin, scanHeight));
+
+    // Old blocks leave the window and have to be read from disk
+    BOOST_CHECK(!journal.Find(tip, spent[1], 0, coin, scanHeight));
+    BOOST_CHECK(scanHeight > 0 && scanHeight < blocks - consensusParams.CoinbaseMaturity(blocks));
+
+    // Disconnected spends are removed and a stale tip is not trusted
+    journal.Disconnect(tip);
+    BOOST_CHECK(!journal.Find(&indexes[blocks - 1], spent[blocks], 0, coin, scanHeight));
+    BOOST_CHECK(!journal.Find(tip, spent[blocks - 1], 0, coin, scanHeight));
+    BOOST_CHECK_EQUAL(scanHeight, blocks);
+    BOOST_CHECK(journal.Find(&indexes[blocks - 1], spent[blocks - 1], 0, coin, scanHeight));
+
+    journal.Clear();
+    BOOST_CHECK(!journal.Find(&indexes[blocks - 1], spent[blocks - 1], 0, coin, scanHeight));
+    BOOST_CHECK_EQUAL(scanHeight, blocks - 1);
+}
+
+BOOST_AUTO_TEST_CASE(immature_stake_tracker)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const int blocks = consensusParams.CoinbaseMaturity(0) + 20;
+
+    // A chain and a fork from 10 blocks below its tip
+    std::vector<uint256> hashes(blocks + 11);
+    std::vector<CBlockIndex> indexes(blocks + 11);
+    auto init = [&](int i, int height, CBlockIndex* pprev) {
+        hashes[i] = m_rng.rand256();
+        indexes[i].phashBlock = &hashes[i];
+        indexes[i].nHeight = height;
+        indexes[i].pprev = pprev;
+        indexes[i].nTime = height;
+        indexes[i].prevoutStake = COutPoint(Txid::FromUint256(m_rng.rand256()), 1);
+    };
+    for (int height = 0; height < blocks; ++height) {
+        init(height, height, height > 0 ? &indexes[height - 1] : nullptr);
+    }
+    for (int i = blocks; i < blocks + 11; ++i) {
+        init(i, i - 11, i > blocks ? &indexes[i - 1] : &indexes[blocks - 12]);
+    }
+
+    // What walking the ancestors of the tip gives
+    auto expected = [&](const CBlockIndex* tip) {
+        std::map<COutPoint, uint32_t> stakes;
+        int window = consensusParams.CoinbaseMaturity(tip->nHeight + 1) - 1;
+        for (const CBlockIndex* pindex = tip; pindex && window-- > 0; pindex = pindex->pprev) {
+            stakes[pindex->prevoutStake] = pindex->nTime;
+        }
+        return stakes;
+    };
+
+    ImmatureStakeTracker tracker;
+    BOOST_CHECK(tracker.GetSnapshot()->empty());
+    for (int height = 0; height < blocks; ++height) {
+        tracker.Update(&indexes[height], consensusParams);
+        if (height < 3 || height > blocks - 3) {
+            BOOST_CHECK(*tracker.GetSnapshot() == expected(&indexes[height]));
+        }
+    }
+
+    // The snapshot is shared until the tip moves
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> snapshot = tracker.GetSnapshot();
+    BOOST_CHECK(tracker.GetSnapshot() == snapshot);
+
+    // Disconnected blocks bring older stakes back into the window
+    for (int height = blocks - 2; height >= blocks - 15; --height) {
+        tracker.Update(&indexes[height], consensusParams);
+    }
+    BOOST_CHECK(*tracker.GetSnapshot() == expected(&indexes[blocks - 15]));
+    BOOST_CHECK(*snapshot == expected(&indexes[blocks - 1]));
+
+    // Jumping to the tip of a fork starts again from it
+    tracker.Update(&indexes[blocks + 10], consensusParams);
+    BOOST_CHECK(*tracker.GetSnapshot() == expected(&indexes[blocks + 10]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <test/util/setup_common.h>
+#include <validators/validatorstore.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace validators;
+
+BOOST_FIXTURE_TEST_SUITE(validatorstore_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(connect_disconnect_flush_load)
+{
+    const Consensus::Params& params{Params().GetConsensus()};
+    ValidatorDB validatorDB(params);
+    DelegationDB delegationDB(params);
+    ValidatorStore store(DBParams{
+        .path = m_args.GetDataDirNet() / "validators",
+        .cache_bytes = 1 << 20,
+        .memory_only = true});
+    BOOST_REQUIRE(store.Load(validatorDB, delegationDB));
+
+    // Blocks around the height the unbonding validator becomes inactive
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 3; ++i) hashes.push_back(m_rng.rand256());
+    std::vector<CBlockIndex> blocks(3);
+    for (int i = 0; i < 3; ++i) {
+        blocks[i].nHeight = UNBONDING_PERIOD - 1 + i;
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i > 0 ? &blocks[i - 1] : nullptr;
+    }
+
+    ValidatorEntry entry;
+    entry.validatorId = CKeyID{uint160{m_rng.randbytes(20)}};
+    entry.stakeAmount = params.nMinValidatorStake;
+    entry.status = ValidatorStatus::ACTIVE;
+
+    ValidatorEntry unbonding{entry};
+    unbonding.validatorId = CKeyID{uint160{m_rng.randbytes(20)}};
+    unbonding.status = ValidatorStatus::UNBONDING;
+    unbonding.lastActiveHeight = 0;
+
+    BOOST_REQUIRE(validatorDB.RegisterValidator(unbonding));
+    store.ConnectBlock(validatorDB, delegationDB, blocks[0]);
+    BOOST_REQUIRE(validatorDB.RegisterValidator(entry));
+    store.ConnectBlock(validatorDB, delegationDB, blocks[1]);
+    BOOST_CHECK(validatorDB.GetValidator(unbonding.validatorId)->status == ValidatorStatus::INACTIVE);
+    BOOST_REQUIRE(validatorDB.JailValidator(entry.validatorId, 10));
+    store.ConnectBlock(validatorDB, delegationDB, blocks[2]);
+    BOOST_CHECK(validatorDB.GetValidator(entry.validatorId)->status == ValidatorStatus::JAILED);
+
+    // Persist, then roll back the tip from the undo record on disk. Changes
+    // made between blocks are local state and survive the reorg.
+    BOOST_REQUIRE(store.Flush(validatorDB, delegationDB));
+    BOOST_CHECK(store.GetBestBlock() == hashes[2]);
+    BOOST_REQUIRE(store.DisconnectBlock(validatorDB, delegationDB, blocks[2]));
+    BOOST_CHECK(validatorDB.GetValidator(entry.validatorId)->status == ValidatorStatus::JAILED);
+    BOOST_CHECK(validatorDB.GetValidator(unbonding.validatorId)->status == ValidatorStatus::INACTIVE);
+    BOOST_CHECK(store.GetBestBlock() == hashes[1]);
+
+    // Undo data must match the block being disconnected
+    BOOST_CHECK(!store.DisconnectBlock(validatorDB, delegationDB, blocks[2]));
+
+    // Reloading yields the rolled back state once flushed
+    BOOST_REQUIRE(store.Flush(validatorDB, delegationDB));
+    ValidatorDB reloadedValidators(params);
+    DelegationDB reloadedDelegations(params);
+    BOOST_REQUIRE(store.Load(reloadedValidators, reloadedDelegations));
+    BOOST_REQUIRE(reloadedValidators.GetValidator(entry.validatorId));
+    BOOST_CHECK(reloadedValidators.GetValidator(entry.validatorId)->status == ValidatorStatus::JAILED);
+
+    // Disconnecting the block that completed the unbonding reverts only that
+    BOOST_REQUIRE(store.DisconnectBlock(reloadedValidators, reloadedDelegations, blocks[1]));
+    BOOST_CHECK(reloadedValidators.GetValidator(unbonding.validatorId)->status == ValidatorStatus::UNBONDING);
+    BOOST_CHECK(reloadedValidators.GetValidator(entry.validatorId)->status == ValidatorStatus::JAILED);
+    BOOST_CHECK_EQUAL(reloadedValidators.GetValidatorCount(), 2U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
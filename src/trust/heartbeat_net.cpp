@@ -3,18 +3,24 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <trust/heartbeat_net.h>
+#include <crypto/siphash.h>
 #include <hash.h>
 #include <logging.h>
+#include <minisketch.h>
 #include <net.h>
+#include <random.h>
 #include <util/time.h>
+#include <validators/validatordb.h>
+
+#include <unordered_map>
 
 namespace trust {
 
 // Global instance
 std::unique_ptr<HeartbeatManager> g_heartbeat_manager;
 
-void InitHeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params) {
-    g_heartbeat_manager = std::make_unique<HeartbeatManager>(trustManager, params);
+void InitHeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params, int worker_threads_num) {
+    g_heartbeat_manager = std::make_unique<HeartbeatManager>(trustManager, params, worker_threads_num);
 }
 
 void ShutdownHeartbeatManager() {
@@ -42,10 +48,27 @@ bool ValidatorRegistration::Verify() const {
     return validatorPubKey.Verify(hash, signature);
 }
 
+bool CheckHeartbeatSignature(const Heartbeat& heartbeat, bool fromLegacyPeer) {
+    if (heartbeat.HasCompactSignature()) {
+        return heartbeat.Verify();
+    }
+    // A DER signature does not name its key, check it against the registered one
+    if (!fromLegacyPeer || !validators::g_validator_db) {
+        return false;
+    }
+    CPubKey pubkey;
+    if (!validators::g_validator_db->GetValidatorPubKey(heartbeat.validatorId, pubkey)) {
+        return false;
+    }
+    return heartbeat.Verify(pubkey);
+}
+
 // HeartbeatManager implementation
 
-HeartbeatManager::HeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params)
-    : m_trust_manager(trustManager), m_consensus_params(params) {}
+HeartbeatManager::HeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params, int worker_threads_num)
+    : m_trust_manager(trustManager), m_consensus_params(params),
+      m_seen_heartbeats(params.nHeartbeatInterval, HEARTBEAT_REPLAY_ENTRIES),
+      m_check_queue(HEARTBEAT_CHECK_BATCH_SIZE, worker_threads_num) {}
 
 void HeartbeatManager::SetValidatorKey(const CKey& key) {
     LOCK(cs_heartbeat);
@@ -109,7 +132,7 @@ bool HeartbeatManager::BroadcastHeartbeat(int blockHeight, const uint256& blockH
     }
 
     // Record that we've seen our own heartbeat
-    m_seen_heartbeats.insert(hb.GetHash());
+    m_seen_heartbeats.Insert(hb.GetHash(), hb.blockHeight);
 
     // Update last broadcast height
     m_last_heartbeat_height = blockHeight;
@@ -122,23 +145,100 @@ bool HeartbeatManager::BroadcastHeartbeat(int blockHeight, const uint256& blockH
     return true;
 }
 
-bool HeartbeatManager::ProcessHeartbeat(const Heartbeat& heartbeat, NodeId from) {
+bool HeartbeatManager::MarkSeen(const Heartbeat& heartbeat) {
+    // Replays and heartbeats for heights outside the replay window are dropped
+    return m_seen_heartbeats.Insert(heartbeat.GetHash(), heartbeat.blockHeight) ==
+           HeartbeatReplayCache::Result::NEW;
+}
+
+bool HeartbeatManager::ProcessHeartbeat(const Heartbeat& heartbeat, NodeId from, bool fromLegacyPeer) {
+    if (m_seen_heartbeats.Contains(heartbeat.GetHash(), heartbeat.blockHeight)) {
+        return false;
+    }
+
+    if (!CheckHeartbeatSignature(heartbeat, fromLegacyPeer)) {
+        LogPrintf("HeartbeatManager: Invalid heartbeat signature from validator %s\n",
+                  heartbeat.validatorId.ToString());
+        return false;
+    }
+
+    if (!MarkSeen(heartbeat)) {
+        return false;
+    }
+
     LOCK(cs_heartbeat);
+    return ApplyHeartbeat(heartbeat);
+}
 
-    // Check if we've already seen this heartbeat
-    uint256 hbHash = heartbeat.GetHash();
-    if (m_seen_heartbeats.count(hbHash) > 0) {
-        return false; // Already processed
+bool HeartbeatManager::QueueHeartbeat(const Heartbeat& heartbeat, NodeId from, bool fromLegacyPeer) {
+    // Most of a flood is duplicates, which are dropped without taking cs_heartbeat
+    if (m_seen_heartbeats.Contains(heartbeat.GetHash(), heartbeat.blockHeight)) {
+        return false;
     }
 
-    // Add to seen set
-    m_seen_heartbeats.insert(hbHash);
+    LOCK(cs_heartbeat);
 
-    // Clean up if too many
-    if (m_seen_heartbeats.size() > MAX_SEEN_HEARTBEATS) {
-        CleanupSeenHeartbeats();
+    // Leave the heartbeat unseen so it can be accepted once the backlog clears
+    if (m_pending_heartbeats.size() >= MAX_PENDING_HEARTBEATS) {
+        return false;
+    }
+
+    // Copies with a different signature are queued too, only a valid one is marked seen
+    if (!m_pending_hashes.insert(heartbeat.GetSignedHash()).second) {
+        return false;
     }
 
+    m_pending_heartbeats.push_back({heartbeat, fromLegacyPeer});
+    return true;
+}
+
+size_t HeartbeatManager::ProcessPendingHeartbeats() {
+    std::vector<PendingHeartbeat> batch;
+    {
+        LOCK(cs_heartbeat);
+        batch.swap(m_pending_heartbeats);
+        m_pending_hashes.clear();
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+
+    // Verify signatures without holding cs_heartbeat so new heartbeats keep queueing
+    std::vector<char> valid(batch.size(), 0);
+    {
+        std::vector<HeartbeatCheck> checks;
+        checks.reserve(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            checks.emplace_back(batch[i], valid[i]);
+        }
+        CCheckQueueControl<HeartbeatCheck> control(&m_check_queue);
+        control.Add(std::move(checks));
+        control.Complete();
+    }
+
+    LOCK(cs_heartbeat);
+    size_t accepted = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const Heartbeat& heartbeat = batch[i].heartbeat;
+        if (!valid[i]) {
+            LogPrintf("HeartbeatManager: Invalid heartbeat signature from validator %s\n",
+                      heartbeat.validatorId.ToString());
+            continue;
+        }
+        // Drops a second valid copy of the same heartbeat and stale heights
+        if (!MarkSeen(heartbeat)) {
+            continue;
+        }
+        if (ApplyHeartbeat(heartbeat)) {
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
+bool HeartbeatManager::ApplyHeartbeat(const Heartbeat& heartbeat) {
+    AssertLockHeld(cs_heartbeat);
+
     // Process the heartbeat in the trust manager
     if (!m_trust_manager.ProcessHeartbeat(heartbeat, heartbeat.blockHeight)) {
         LogPrintf("HeartbeatManager: Failed to process heartbeat from validator\n");
@@ -229,18 +329,21 @@ bool HeartbeatManager::CreateRegistration(int64_t stakeAmount, int64_t poolFeeRa
 }
 
 ValidatorList HeartbeatManager::GetValidatorList() const {
+    LOCK(cs_heartbeat);
     ValidatorList list;
     list.validators = m_trust_manager.GetActiveValidators();
     return list;
 }
 
 void HeartbeatManager::ProcessValidatorList(const ValidatorList& list) {
+    LOCK(cs_heartbeat);
+
     // Process each validator in the list
     // This is used for initial sync when connecting to the network
     for (const auto& info : list.validators) {
         if (info.isActive && info.MeetsMinimumStake(m_consensus_params)) {
             // Re-register the validator if we don't know about them
-            const ValidatorInfo* existing = m_trust_manager.GetValidator(info.validatorId);
+            std::optional<ValidatorInfo> existing = m_trust_manager.GetValidator(info.validatorId);
             if (!existing) {
                 m_trust_manager.RegisterValidator(info.validatorId, info.stakeAmount,
                                                   info.poolFeeRate, info.registrationHeight);
@@ -249,10 +352,114 @@ void HeartbeatManager::ProcessValidatorList(const ValidatorList& list) {
     }
 }
 
+// Validator set sync
+
+/** Salted 32-bit short ID of a validator for sketches; never 0 */
+static uint32_t ValidatorShortId(uint64_t salt, const CKeyID& validatorId) {
+    uint32_t shortId = CSipHasher(salt, ~salt).Write(validatorId).Finalize() & 0xffffffff;
+    return shortId == 0 ? 1 : shortId;
+}
+
+ValidatorSyncRequest HeartbeatManager::CreateValidatorSyncRequest(const uint256& peerChangeSetId, uint64_t peerEpoch) const {
+    LOCK(cs_heartbeat);
+
+    ValidatorSyncRequest request;
+    request.changeSetId = peerChangeSetId;
+    request.sinceEpoch = peerEpoch;
+    request.activeSetHash = m_trust_manager.GetActiveSetHash();
+
+    // A peer we have an epoch for answers with a delta, no sketch needed
+    if (!peerChangeSetId.IsNull()) {
+        return request;
+    }
+
+    std::vector<CKeyID> ids = m_trust_manager.GetActiveValidatorIds();
+    if (ids.empty()) {
+        return request;
+    }
+
+    request.salt = FastRandomContext().rand64();
+    Minisketch sketch(32, 0, VALIDATOR_SYNC_SKETCH_CAPACITY);
+    for (const CKeyID& id : ids) {
+        sketch.Add(ValidatorShortId(request.salt, id));
+    }
+    request.sketch = sketch.Serialize();
+    return request;
+}
+
+ValidatorSyncReply HeartbeatManager::ProcessValidatorSyncRequest(const ValidatorSyncRequest& request) const {
+    LOCK(cs_heartbeat);
+
+    ValidatorSyncReply reply;
+    reply.changeSetId = m_trust_manager.GetChangeSetId();
+    reply.epoch = m_trust_manager.GetChangeEpoch();
+
+    // Steady state: only what changed since the requester's last sync
+    if (request.changeSetId == reply.changeSetId && request.sinceEpoch <= reply.epoch) {
+        reply.validators = m_trust_manager.GetValidatorsChangedSince(request.sinceEpoch);
+        reply.mode = reply.validators.empty() ? ValidatorSyncReply::Mode::IN_SYNC : ValidatorSyncReply::Mode::DELTA;
+        return reply;
+    }
+
+    if (request.activeSetHash == m_trust_manager.GetActiveSetHash()) {
+        reply.mode = ValidatorSyncReply::Mode::IN_SYNC;
+        return reply;
+    }
+
+    // Reconcile against the requester's sketch; each element is 32 bits
+    size_t capacity = request.sketch.size() / 4;
+    if (request.sketch.size() % 4 == 0 && capacity > 0 && capacity <= MAX_VALIDATOR_SYNC_SKETCH_CAPACITY) {
+        Minisketch theirs(32, 0, capacity);
+        theirs.Deserialize(request.sketch);
+
+        Minisketch ours(32, 0, capacity);
+        std::unordered_map<uint32_t, CKeyID> byShortId;
+        for (const CKeyID& id : m_trust_manager.GetActiveValidatorIds()) {
+            uint32_t shortId = ValidatorShortId(request.salt, id);
+            byShortId.emplace(shortId, id);
+            ours.Add(shortId);
+        }
+
+        std::optional<std::vector<uint64_t>> difference = ours.Merge(theirs).Decode(capacity);
+        if (difference) {
+            // Elements we don't know are validators only the requester has
+            for (uint64_t shortId : *difference) {
+                auto it = byShortId.find(shortId);
+                if (it == byShortId.end()) continue;
+                std::optional<ValidatorInfo> info = m_trust_manager.GetValidator(it->second);
+                if (info) reply.validators.push_back(*info);
+            }
+            reply.mode = ValidatorSyncReply::Mode::RECONCILED;
+            return reply;
+        }
+    }
+
+    reply.mode = ValidatorSyncReply::Mode::FULL;
+    reply.validators = m_trust_manager.GetActiveValidators();
+    return reply;
+}
+
+bool HeartbeatManager::ProcessValidatorSyncReply(const ValidatorSyncReply& reply) {
+    if (reply.version != VALIDATOR_SYNC_VERSION) {
+        return false;
+    }
+
+    ValidatorList list;
+    list.validators = reply.validators;
+    ProcessValidatorList(list);
+    return true;
+}
+
 void HeartbeatManager::OnNewBlock(int height) {
-    // Update heartbeat expectations in trust manager
-    m_trust_manager.UpdateHeartbeatExpectations(height);
-    m_trust_manager.SetHeight(height);
+    // Expire replay protection for heights that left the window
+    m_seen_heartbeats.SetHeight(height);
+
+    // Update heartbeat expectations in trust manager. Missed check-ins are not
+    // charged yet: nothing broadcasts heartbeats, so every validator would decay.
+    {
+        LOCK(cs_heartbeat);
+        m_trust_manager.UpdateHeartbeatExpectations(height);
+    }
 
     // Check if we should broadcast a heartbeat
     if (ShouldBroadcastHeartbeat(height)) {
@@ -262,23 +469,13 @@ void HeartbeatManager::OnNewBlock(int height) {
     }
 }
 
-void HeartbeatManager::CleanupSeenHeartbeats() {
-    LOCK(cs_heartbeat);
-    // Simple cleanup: just clear half when we hit the limit
-    // In production, would want time-based expiry
-    if (m_seen_heartbeats.size() > MAX_SEEN_HEARTBEATS / 2) {
-        auto it = m_seen_heartbeats.begin();
-        std::advance(it, m_seen_heartbeats.size() / 2);
-        m_seen_heartbeats.erase(m_seen_heartbeats.begin(), it);
-    }
-}
-
 HeartbeatManager::Stats HeartbeatManager::GetStats() const {
     LOCK(cs_heartbeat);
     Stats stats;
     stats.isValidator = m_is_validator;
     stats.lastHeartbeatHeight = m_last_heartbeat_height;
-    stats.seenHeartbeats = m_seen_heartbeats.size();
+    stats.seenHeartbeats = m_seen_heartbeats.Count();
+    stats.pendingHeartbeats = m_pending_heartbeats.size();
     stats.activeValidators = m_trust_manager.GetActiveValidators().size();
     return stats;
 }
@@ -5,7 +5,9 @@
 #ifndef WATTX_TRUST_HEARTBEAT_NET_H
 #define WATTX_TRUST_HEARTBEAT_NET_H
 
+#include <trust/replaycache.h>
 #include <trust/trustscore.h>
+#include <checkqueue.h>
 #include <net.h>
 #include <protocol.h>
 #include <sync.h>
@@ -13,8 +15,11 @@
 #include <key.h>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <set>
+#include <vector>
 
 class CChainState;
 class CConnman;
@@ -56,8 +61,137 @@ public:
     }
 };
 
+/**
+ * Compact wire encoding for ValidatorList, preceded by the encoding version
+ */
+struct CompactValidatorListFormatter {
+    template<typename Stream>
+    void Ser(Stream& s, const ValidatorList& list) {
+        s << TRUST_COMPACT_ENCODING_VERSION;
+        s << Using<VectorFormatter<CompactValidatorInfoFormatter>>(list.validators);
+    }
+
+    template<typename Stream>
+    void Unser(Stream& s, ValidatorList& list) {
+        uint8_t version;
+        s >> version;
+        if (version != TRUST_COMPACT_ENCODING_VERSION) {
+            throw std::ios_base::failure("Unsupported compact validator list encoding version");
+        }
+        s >> Using<VectorFormatter<CompactValidatorInfoFormatter>>(list.validators);
+    }
+};
+
+// Version of the validator set sync messages
+static constexpr uint8_t VALIDATOR_SYNC_VERSION = 1;
+
+// Set differences a first-contact sketch can resolve before a full list is sent
+static constexpr size_t VALIDATOR_SYNC_SKETCH_CAPACITY = 64;
+
+// Largest sketch capacity accepted from a peer
+static constexpr size_t MAX_VALIDATOR_SYNC_SKETCH_CAPACITY = 1024;
+
+/**
+ * Request for the validator set changes a peer is missing (getvalsync)
+ *
+ * A requester that synced with the responder before names the responder's
+ * change set and the last epoch it applied, and receives only the validators
+ * changed since. Otherwise it sends the hash of its active set and a sketch of
+ * salted short IDs, and receives the validators it lacks.
+ */
+class ValidatorSyncRequest {
+public:
+    uint8_t version{VALIDATOR_SYNC_VERSION};
+    uint256 changeSetId;                // Responder change set the epoch refers to, null if none
+    uint64_t sinceEpoch{0};             // Last responder epoch applied
+    uint256 activeSetHash;              // Requester's active set hash
+    uint64_t salt{0};                   // Salt of the sketch short IDs
+    std::vector<unsigned char> sketch;  // Minisketch of the requester's active short IDs, may be empty
+
+    SERIALIZE_METHODS(ValidatorSyncRequest, obj) {
+        READWRITE(obj.version, obj.changeSetId, VARINT(obj.sinceEpoch), obj.activeSetHash,
+                  obj.salt, obj.sketch);
+    }
+};
+
+/**
+ * Reply to a validator set sync request (valsync)
+ */
+class ValidatorSyncReply {
+public:
+    enum class Mode : uint8_t {
+        IN_SYNC = 0,     // Nothing missing
+        DELTA = 1,       // Validators changed since the requested epoch
+        RECONCILED = 2,  // Validators missing from the requester's sketch
+        FULL = 3         // All active validators
+    };
+
+    uint8_t version{VALIDATOR_SYNC_VERSION};
+    Mode mode{Mode::FULL};
+    uint256 changeSetId;                  // Responder change set
+    uint64_t epoch{0};                    // Responder epoch this reply brings the requester to
+    std::vector<ValidatorInfo> validators;
+
+    SERIALIZE_METHODS(ValidatorSyncReply, obj) {
+        READWRITE(obj.version, Using<CustomUintFormatter<1>>(obj.mode), obj.changeSetId, VARINT(obj.epoch),
+                  Using<VectorFormatter<CompactValidatorInfoFormatter>>(obj.validators));
+    }
+};
+
+/**
+ * Check a heartbeat signature. A peer that has not negotiated trust v2
+ * (sendtrustv2) may still relay DER signed heartbeats, which are verified
+ * against the validator's public key in the validator database and
+ * rejected when the validator is unknown. Compact signatures are always
+ * verified against the validator ID.
+ */
+bool CheckHeartbeatSignature(const Heartbeat& heartbeat, bool fromLegacyPeer);
+
+/**
+ * A received heartbeat waiting for verification
+ */
+struct PendingHeartbeat {
+    Heartbeat heartbeat;
+    bool fromLegacyPeer;
+};
+
+/**
+ * Signature check for one queued heartbeat, run on the heartbeat check queue.
+ * The verdict is written to a slot owned by the caller, so one bad heartbeat
+ * does not fail the rest of its batch.
+ */
+class HeartbeatCheck {
+private:
+    const PendingHeartbeat* m_pending;
+    char* m_valid;
+
+public:
+    HeartbeatCheck(const PendingHeartbeat& pending, char& valid) : m_pending(&pending), m_valid(&valid) {}
+
+    std::optional<int> operator()() {
+        *m_valid = CheckHeartbeatSignature(m_pending->heartbeat, m_pending->fromLegacyPeer);
+        return std::nullopt;
+    }
+};
+
+// Heartbeats handed to a check queue worker at a time
+static constexpr unsigned int HEARTBEAT_CHECK_BATCH_SIZE = 16;
+
+// Replay cache capacity per heartbeat interval
+static constexpr size_t HEARTBEAT_REPLAY_ENTRIES = 16384;
+
+// Heartbeats waiting for verification before new ones are dropped
+static constexpr size_t MAX_PENDING_HEARTBEATS = 50000;
+
+// How often queued heartbeats are verified and applied
+static constexpr auto HEARTBEAT_PROCESS_INTERVAL{std::chrono::milliseconds{250}};
+
 /**
  * Heartbeat network manager - handles broadcasting and receiving heartbeats
+ *
+ * Received heartbeats are queued by QueueHeartbeat and verified in batches by
+ * ProcessPendingHeartbeats, which spreads the signature checks over a
+ * CCheckQueue worker pool and applies the accepted ones under one lock.
  */
 class HeartbeatManager {
 private:
@@ -73,18 +207,38 @@ private:
     // Consensus params
     const Consensus::Params& m_consensus_params;
 
-    // Recently seen heartbeats (to prevent replay)
-    std::set<uint256> m_seen_heartbeats GUARDED_BY(cs_heartbeat);
-    static constexpr size_t MAX_SEEN_HEARTBEATS = 10000;
+    // Recently accepted heartbeats (to prevent replay), safe to query without cs_heartbeat.
+    // Only heartbeats whose signature checked out are recorded, so a copy with a
+    // bad signature cannot suppress the real one.
+    HeartbeatReplayCache m_seen_heartbeats;
 
     // Last heartbeat height we broadcast
     int m_last_heartbeat_height GUARDED_BY(cs_heartbeat){0};
 
+    // Heartbeats waiting for signature verification
+    std::vector<PendingHeartbeat> m_pending_heartbeats GUARDED_BY(cs_heartbeat);
+
+    // Signed hashes of the pending heartbeats, so duplicates are verified once
+    std::set<uint256> m_pending_hashes GUARDED_BY(cs_heartbeat);
+
+    // Worker pool for heartbeat signature checks
+    CCheckQueue<HeartbeatCheck> m_check_queue;
+
     // Connection manager for broadcasting
     CConnman* m_connman{nullptr};
 
+    /**
+     * Record a verified heartbeat as seen; returns false for a replay or a stale height
+     */
+    bool MarkSeen(const Heartbeat& heartbeat);
+
+    /**
+     * Apply a verified heartbeat to the trust manager and peer discovery
+     */
+    bool ApplyHeartbeat(const Heartbeat& heartbeat) EXCLUSIVE_LOCKS_REQUIRED(cs_heartbeat);
+
 public:
-    HeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params);
+    HeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params, int worker_threads_num = 0);
 
     /**
      * Set this node as a validator with the given key
@@ -120,7 +274,19 @@ public:
      * Process a received heartbeat message
      * Returns true if the heartbeat was valid and new
      */
-    bool ProcessHeartbeat(const Heartbeat& heartbeat, NodeId from);
+    bool ProcessHeartbeat(const Heartbeat& heartbeat, NodeId from, bool fromLegacyPeer = false);
+
+    /**
+     * Queue a received heartbeat for batched verification
+     * Returns true if the heartbeat was new and queued
+     */
+    bool QueueHeartbeat(const Heartbeat& heartbeat, NodeId from, bool fromLegacyPeer = false);
+
+    /**
+     * Verify all queued heartbeats and apply the valid ones
+     * Returns the number of heartbeats accepted
+     */
+    size_t ProcessPendingHeartbeats();
 
     /**
      * Process a validator registration message
@@ -144,14 +310,26 @@ public:
     void ProcessValidatorList(const ValidatorList& list);
 
     /**
-     * Update heartbeat expectations at new block height
+     * Build a validator set sync request for a peer whose change set and
+     * epoch we last applied (null and 0 if never)
      */
-    void OnNewBlock(int height);
+    ValidatorSyncRequest CreateValidatorSyncRequest(const uint256& peerChangeSetId, uint64_t peerEpoch) const;
 
     /**
-     * Clean up old seen heartbeats to prevent memory growth
+     * Answer a validator set sync request
      */
-    void CleanupSeenHeartbeats();
+    ValidatorSyncReply ProcessValidatorSyncRequest(const ValidatorSyncRequest& request) const;
+
+    /**
+     * Apply a validator set sync reply
+     * Returns false if the reply uses an unknown version
+     */
+    bool ProcessValidatorSyncReply(const ValidatorSyncReply& reply);
+
+    /**
+     * Update heartbeat expectations at new block height
+     */
+    void OnNewBlock(int height);
 
     /**
      * Get statistics for logging/RPC
@@ -160,6 +338,7 @@ public:
         bool isValidator;
         int lastHeartbeatHeight;
         size_t seenHeartbeats;
+        size_t pendingHeartbeats;
         int activeValidators;
     };
     Stats GetStats() const;
@@ -179,7 +358,7 @@ extern std::unique_ptr<HeartbeatManager> g_heartbeat_manager;
 /**
  * Initialize the heartbeat manager
  */
-void InitHeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params);
+void InitHeartbeatManager(TrustScoreManager& trustManager, const Consensus::Params& params, int worker_threads_num = 0);
 
 /**
  * Shutdown the heartbeat manager
@@ -0,0 +1,143 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <trust/replaycache.h>
+#include <crypto/siphash.h>
+#include <random.h>
+#include <util/fastrange.h>
+
+#include <algorithm>
+
+namespace trust {
+
+static int GenerationIndex(int64_t period) {
+    int64_t index = period % HeartbeatReplayCache::GENERATIONS;
+    return static_cast<int>(index < 0 ? index + HeartbeatReplayCache::GENERATIONS : index);
+}
+
+HeartbeatReplayCache::HeartbeatReplayCache(int periodBlocks, size_t entriesPerGeneration)
+    : m_period_blocks(std::max(periodBlocks, 1)),
+      m_buckets(std::max<size_t>(entriesPerGeneration / BUCKET_SLOTS, 1)),
+      m_k0(FastRandomContext().rand64()),
+      m_k1(FastRandomContext().rand64()) {
+    for (auto& gen : m_generations) {
+        gen.slots = std::make_unique<std::atomic<uint64_t>[]>(m_buckets * BUCKET_SLOTS);
+    }
+    // Start with the window around height 0
+    for (int64_t period = -(GENERATIONS - 2); period <= 1; ++period) {
+        Reset(m_generations[GenerationIndex(period)], period);
+    }
+}
+
+std::optional<size_t> HeartbeatReplayCache::GetGeneration(int height) const {
+    if (height < 0) {
+        return std::nullopt;
+    }
+    int64_t period = height / m_period_blocks;
+    int64_t current = m_period.load(std::memory_order_acquire);
+    if (period < current - (GENERATIONS - 2) || period > current + 1) {
+        return std::nullopt;
+    }
+    size_t index = GenerationIndex(period);
+    // Being rotated to a different period
+    if (m_generations[index].period.load(std::memory_order_acquire) != period) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+size_t HeartbeatReplayCache::GetBucket(uint64_t fingerprint) const {
+    // The high bits pick the bucket, the full value is stored
+    return FastRange64(fingerprint, m_buckets) * BUCKET_SLOTS;
+}
+
+uint64_t HeartbeatReplayCache::Fingerprint(const uint256& hash) const {
+    // Salted so peers cannot aim heartbeats at one bucket; 0 marks an empty slot
+    uint64_t fingerprint = SipHashUint256(m_k0, m_k1, hash);
+    return fingerprint == 0 ? 1 : fingerprint;
+}
+
+void HeartbeatReplayCache::Reset(Generation& gen, int64_t period) {
+    for (size_t i = 0; i < m_buckets * BUCKET_SLOTS; ++i) {
+        gen.slots[i].store(0, std::memory_order_relaxed);
+    }
+    gen.count.store(0, std::memory_order_relaxed);
+    gen.period.store(period, std::memory_order_release);
+}
+
+HeartbeatReplayCache::Result HeartbeatReplayCache::Insert(const uint256& hash, int height) {
+    std::optional<size_t> index = GetGeneration(height);
+    if (!index) {
+        return Result::STALE;
+    }
+
+    Generation& gen = m_generations[*index];
+    uint64_t fingerprint = Fingerprint(hash);
+    std::atomic<uint64_t>* bucket = &gen.slots[GetBucket(fingerprint)];
+    for (size_t i = 0; i < BUCKET_SLOTS; ++i) {
+        uint64_t expected = 0;
+        if (bucket[i].compare_exchange_strong(expected, fingerprint, std::memory_order_acq_rel)) {
+            gen.count.fetch_add(1, std::memory_order_relaxed);
+            return Result::NEW;
+        }
+        if (expected == fingerprint) {
+            return Result::SEEN;
+        }
+    }
+
+    // Bucket full: overwrite a slot chosen by the fingerprint
+    bucket[fingerprint % BUCKET_SLOTS].store(fingerprint, std::memory_order_release);
+    return Result::NEW;
+}
+
+bool HeartbeatReplayCache::Contains(const uint256& hash, int height) const {
+    std::optional<size_t> index = GetGeneration(height);
+    if (!index) {
+        return false;
+    }
+
+    uint64_t fingerprint = Fingerprint(hash);
+    const std::atomic<uint64_t>* bucket = &m_generations[*index].slots[GetBucket(fingerprint)];
+    for (size_t i = 0; i < BUCKET_SLOTS; ++i) {
+        uint64_t value = bucket[i].load(std::memory_order_acquire);
+        if (value == fingerprint) {
+            return true;
+        }
+        if (value == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void HeartbeatReplayCache::SetHeight(int height) {
+    LOCK(m_rotate_mutex);
+
+    int64_t period = std::max(height, 0) / m_period_blocks;
+    int64_t current = m_period.load(std::memory_order_relaxed);
+    if (period <= current) {
+        // Reorgs keep the entries of the longer chain until they expire
+        return;
+    }
+
+    // Reuse the generations of periods that leave the window
+    for (int64_t p = std::max(current + 2, period - (GENERATIONS - 2)); p <= period + 1; ++p) {
+        Reset(m_generations[GenerationIndex(p)], p);
+    }
+    m_period.store(period, std::memory_order_release);
+}
+
+size_t HeartbeatReplayCache::Count() const {
+    size_t count = 0;
+    for (const auto& gen : m_generations) {
+        count += gen.count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+size_t HeartbeatReplayCache::MemoryUsage() const {
+    return GENERATIONS * m_buckets * BUCKET_SLOTS * sizeof(std::atomic<uint64_t>);
+}
+
+} // namespace trust
@@ -0,0 +1,107 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WATTX_TRUST_REPLAYCACHE_H
+#define WATTX_TRUST_REPLAYCACHE_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace trust {
+
+/**
+ * Fixed-memory, height-aware set of recently seen heartbeat hashes
+ *
+ * Heartbeats are grouped into generations by the period of periodBlocks
+ * their blockHeight falls in. Each generation is a table of salted 64-bit
+ * fingerprints in buckets of BUCKET_SLOTS atomics, so lookups and inserts
+ * never take a lock. Advancing the height clears the generation that is
+ * about to be reused, which expires every entry older than the window at
+ * once. Heartbeats for heights outside the window are reported as stale
+ * without touching the tables.
+ *
+ * A full bucket overwrites one of its slots, so under a flood an old entry
+ * can be forgotten early, but memory never grows.
+ */
+class HeartbeatReplayCache {
+public:
+    enum class Result {
+        NEW,    // Not seen before, now recorded
+        SEEN,   // Already recorded
+        STALE   // Height outside the window
+    };
+
+    // Number of generations: the window covers GENERATIONS - 2 past periods,
+    // the current one and the next
+    static constexpr int GENERATIONS = 4;
+
+    // Slots per bucket (one cache line)
+    static constexpr size_t BUCKET_SLOTS = 8;
+
+private:
+    struct Generation {
+        std::atomic<int64_t> period{0};
+        std::atomic<size_t> count{0};
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    };
+
+    const int m_period_blocks;
+    const size_t m_buckets;
+    const uint64_t m_k0;
+    const uint64_t m_k1;
+
+    std::array<Generation, GENERATIONS> m_generations;
+    std::atomic<int64_t> m_period{0};
+
+    // Serializes generation rotation; lookups do not take it
+    Mutex m_rotate_mutex;
+
+    /**
+     * Index of the generation holding heartbeats of the given height, if not stale
+     */
+    std::optional<size_t> GetGeneration(int height) const;
+
+    size_t GetBucket(uint64_t fingerprint) const;
+    uint64_t Fingerprint(const uint256& hash) const;
+    void Reset(Generation& gen, int64_t period);
+
+public:
+    HeartbeatReplayCache(int periodBlocks, size_t entriesPerGeneration);
+
+    /**
+     * Record a heartbeat hash unless it was seen before or is stale
+     */
+    Result Insert(const uint256& hash, int height);
+
+    /**
+     * Check for a heartbeat hash without recording it
+     */
+    bool Contains(const uint256& hash, int height) const;
+
+    /**
+     * Advance the window to the given block height
+     */
+    void SetHeight(int height) EXCLUSIVE_LOCKS_REQUIRED(!m_rotate_mutex);
+
+    /**
+     * Number of entries currently recorded
+     */
+    size_t Count() const;
+
+    /**
+     * Bytes used by the fingerprint tables
+     */
+    size_t MemoryUsage() const;
+};
+
+} // namespace trust
+
+#endif // WATTX_TRUST_REPLAYCACHE_H
@@ -6,7 +6,9 @@
 #include <hash.h>
 #include <logging.h>
 #include <netbase.h>
+#include <random.h>
 #include <util/time.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -42,6 +44,19 @@ std::string TrustTierToString(TrustTier tier) {
 
 // ValidatorInfo implementation
 
+int ValidatorInfo::GetExpectedHeartbeats(int height, const Consensus::Params& params) const {
+    // Inactive validators keep the expectation they had when deactivated
+    if (!isActive) {
+        return heartbeatsExpected;
+    }
+
+    int windowBlocks = std::min(height - registrationHeight, params.nUptimeWindow);
+    if (windowBlocks <= 0) {
+        return 0;
+    }
+    return windowBlocks / params.nHeartbeatInterval;
+}
+
 int ValidatorInfo::GetUptimePercentage() const {
     if (heartbeatsExpected == 0) {
         return 1000; // 100% if no heartbeats expected yet
@@ -123,24 +138,103 @@ std::string Heartbeat::GetNodeAddressString() const {
 }
 
 bool Heartbeat::Sign(const CKey& key) {
+    // Compact signatures let receivers recover the key from the heartbeat alone
     uint256 hash = GetHash();
-    return key.Sign(hash, signature);
+    return key.SignCompact(hash, signature);
+}
+
+uint256 Heartbeat::GetSignedHash() const {
+    HashWriter ss{};
+    ss << GetHash();
+    ss << signature;
+    return ss.GetHash();
 }
 
 bool Heartbeat::Verify(const CPubKey& pubkey) const {
-    uint256 hash = GetHash();
-    return pubkey.Verify(hash, signature);
+    if (!HasCompactSignature()) {
+        return pubkey.Verify(GetHash(), signature);
+    }
+    CPubKey recovered;
+    if (!recovered.RecoverCompact(GetHash(), signature)) {
+        return false;
+    }
+    return recovered == pubkey;
+}
+
+bool Heartbeat::Verify() const {
+    if (!HasCompactSignature()) {
+        return false;
+    }
+    CPubKey recovered;
+    if (!recovered.RecoverCompact(GetHash(), signature)) {
+        return false;
+    }
+    return recovered.GetID() == validatorId;
 }
 
 // TrustScoreManager implementation
 
 TrustScoreManager::TrustScoreManager(const Consensus::Params& params)
-    : consensusParams(params), currentHeight(0) {}
+    : consensusParams(params), currentHeight(0), changeSetId(GetRandHash()) {}
+
+void TrustScoreManager::MarkChanged(const CKeyID& validatorId) {
+    auto it = lastChangeEpoch.find(validatorId);
+    if (it != lastChangeEpoch.end()) {
+        changeLog.erase({it->second, validatorId});
+    }
+    ++changeEpoch;
+    changeLog.emplace(changeEpoch, validatorId);
+    lastChangeEpoch[validatorId] = changeEpoch;
+}
+
+void TrustScoreManager::ToggleActiveSetHash(const CKeyID& validatorId) {
+    uint256 idHash = Hash(validatorId);
+    for (size_t i = 0; i < activeSetHash.size(); ++i) {
+        activeSetHash.begin()[i] ^= idHash.begin()[i];
+    }
+}
+
+ValidatorInfo TrustScoreManager::Evaluate(const ValidatorInfo& info) const {
+    ValidatorInfo result = info;
+    result.heartbeatsExpected = info.GetExpectedHeartbeats(currentHeight, consensusParams);
+    return result;
+}
+
+void TrustScoreManager::ScheduleCheckIn(const CKeyID& validatorId, int deadline) {
+    UnscheduleCheckIn(validatorId);
+    checkInDeadlines.emplace(deadline, validatorId);
+    nextCheckInDeadline[validatorId] = deadline;
+}
+
+void TrustScoreManager::UnscheduleCheckIn(const CKeyID& validatorId) {
+    auto it = nextCheckInDeadline.find(validatorId);
+    if (it == nextCheckInDeadline.end()) {
+        return;
+    }
+    checkInDeadlines.erase({it->second, validatorId});
+    nextCheckInDeadline.erase(it);
+}
+
+void TrustScoreManager::Deactivate(ValidatorInfo& info) {
+    if (!info.isActive) {
+        return;
+    }
+    info.heartbeatsExpected = info.GetExpectedHeartbeats(currentHeight, consensusParams);
+    info.isActive = false;
+    UnscheduleCheckIn(info.validatorId);
+    ToggleActiveSetHash(info.validatorId);
+    MarkChanged(info.validatorId);
+}
 
 bool TrustScoreManager::RegisterValidator(const CKeyID& validatorId,
                                           int64_t stakeAmount,
                                           int64_t poolFeeRate,
                                           int height) {
+    if (height < 0 || stakeAmount < 0) {
+        LogPrintf("TrustScoreManager: Invalid validator registration at height %d\n", height);
+        return false;
+    }
+
     // Check minimum stake
     if (stakeAmount < consensusParams.nMinValidatorStake) {
         LogPrintf("TrustScoreManager: Validator registration failed - insufficient stake %lld < %lld\n",
@@ -171,6 +265,11 @@ bool TrustScoreManager::RegisterValidator(const CKeyID& validatorId,
     info.isActive = true;
 
     validators[validatorId] = info;
+    // A validator learned of late, e.g. through list sync, could not check in
+    // with us before we knew of it
+    ScheduleCheckIn(validatorId, std::max(height, currentHeight) + consensusParams.nHeartbeatInterval * 2);
+    ToggleActiveSetHash(validatorId);
+    MarkChanged(validatorId);
 
     LogPrintf("TrustScoreManager: Registered validator with stake %lld, fee rate %lld bps\n",
               stakeAmount, poolFeeRate);
@@ -179,15 +278,16 @@ bool TrustScoreManager::RegisterValidator(const CKeyID& validatorId,
 
 bool TrustScoreManager::UpdateStake(const CKeyID& validatorId, int64_t newStakeAmount) {
     auto it = validators.find(validatorId);
-    if (it == validators.end()) {
+    if (it == validators.end() || newStakeAmount < 0) {
         return false;
     }
 
     it->second.stakeAmount = newStakeAmount;
+    MarkChanged(validatorId);
 
     // Deactivate if below minimum
-    if (newStakeAmount < consensusParams.nMinValidatorStake) {
-        it->second.isActive = false;
+    if (newStakeAmount < consensusParams.nMinValidatorStake && it->second.isActive) {
+        Deactivate(it->second);
         LogPrintf("TrustScoreManager: Validator deactivated - stake below minimum\n");
     }
 
@@ -205,6 +305,7 @@ bool TrustScoreManager::UpdatePoolFee(const CKeyID& validatorId, int64_t newFeeR
     }
 
     it->second.poolFeeRate = newFeeRate;
+    MarkChanged(validatorId);
     return true;
 }
 
@@ -232,41 +333,27 @@ bool TrustScoreManager::ProcessHeartbeat(const Heartbeat& heartbeat, int height)
     // Record heartbeat
     it->second.heartbeatsReceived++;
     it->second.lastHeartbeatHeight = height;
+    ScheduleCheckIn(heartbeat.validatorId, height + expectedInterval * 2);
 
     LogPrintf("TrustScoreManager: Processed heartbeat from validator at height %d\n", height);
     return true;
 }
 
 void TrustScoreManager::UpdateHeartbeatExpectations(int height) {
+    // Expected heartbeats are evaluated on read against this height
     currentHeight = height;
-
-    for (auto& [id, info] : validators) {
-        if (!info.isActive) continue;
-
-        // Calculate expected heartbeats since registration
-        int blocksSinceRegistration = height - info.registrationHeight;
-        if (blocksSinceRegistration > 0) {
-            info.heartbeatsExpected = blocksSinceRegistration / consensusParams.nHeartbeatInterval;
-        }
-
-        // Apply uptime window limit
-        int windowBlocks = std::min(blocksSinceRegistration, consensusParams.nUptimeWindow);
-        if (windowBlocks > 0) {
-            info.heartbeatsExpected = windowBlocks / consensusParams.nHeartbeatInterval;
-        }
-    }
 }
 
-const ValidatorInfo* TrustScoreManager::GetValidator(const CKeyID& validatorId) const {
+std::optional<ValidatorInfo> TrustScoreManager::GetValidator(const CKeyID& validatorId) const {
     auto it = validators.find(validatorId);
     if (it == validators.end()) {
-        return nullptr;
+        return std::nullopt;
     }
-    return &it->second;
+    return Evaluate(it->second);
 }
 
 TrustTier TrustScoreManager::GetValidatorTier(const CKeyID& validatorId) const {
-    const ValidatorInfo* info = GetValidator(validatorId);
+    std::optional<ValidatorInfo> info = GetValidator(validatorId);
     if (!info) {
         return TrustTier::NONE;
     }
@@ -274,7 +361,7 @@ TrustTier TrustScoreManager::GetValidatorTier(const CKeyID& validatorId) const {
 }
 
 int TrustScoreManager::GetValidatorRewardMultiplier(const CKeyID& validatorId) const {
-    const ValidatorInfo* info = GetValidator(validatorId);
+    std::optional<ValidatorInfo> info = GetValidator(validatorId);
     if (!info) {
         return 0;
     }
@@ -282,7 +369,7 @@ int TrustScoreManager::GetValidatorRewardMultiplier(const CKeyID& validatorId) c
 }
 
 bool TrustScoreManager::IsValidatorEligible(const CKeyID& validatorId) const {
-    const ValidatorInfo* info = GetValidator(validatorId);
+    std::optional<ValidatorInfo> info = GetValidator(validatorId);
     if (!info) {
         return false;
     }
@@ -293,7 +380,7 @@ std::vector<ValidatorInfo> TrustScoreManager::GetActiveValidators() const {
     std::vector<ValidatorInfo> result;
     for (const auto& [id, info] : validators) {
         if (info.isActive) {
-            result.push_back(info);
+            result.push_back(Evaluate(info));
         }
     }
     return result;
@@ -301,9 +388,11 @@ std::vector<ValidatorInfo> TrustScoreManager::GetActiveValidators() const {
 
 std::vector<ValidatorInfo> TrustScoreManager::GetValidatorsByTier(TrustTier tier) const {
     std::vector<ValidatorInfo> result;
-    for (const auto& [id, info] : validators) {
-        if (info.isActive && info.GetTrustTier(consensusParams) == tier) {
-            result.push_back(info);
+    for (const auto& [id, stored] : validators) {
+        if (!stored.isActive) continue;
+        ValidatorInfo info = Evaluate(stored);
+        if (info.GetTrustTier(consensusParams) == tier) {
+            result.push_back(std::move(info));
         }
     }
     return result;
@@ -314,7 +403,7 @@ bool TrustScoreManager::DeactivateValidator(const CKeyID& validatorId) {
     if (it == validators.end()) {
         return false;
     }
-    it->second.isActive = false;
+    Deactivate(it->second);
     return true;
 }
 
@@ -364,7 +453,7 @@ std::vector<CService> TrustScoreManager::GetTrustedValidatorAddresses(TrustTier
     std::vector<CService> addresses;
     for (const auto& [id, info] : validators) {
         if (info.isActive && info.lastKnownAddress.IsValid()) {
-            TrustTier tier = info.GetTrustTier(consensusParams);
+            TrustTier tier = Evaluate(info).GetTrustTier(consensusParams);
             if (static_cast<int>(tier) >= static_cast<int>(minTier)) {
                 addresses.push_back(info.lastKnownAddress);
             }
@@ -394,19 +483,38 @@ CKeyID TrustScoreManager::GetValidatorIdByAddress(const CService& address) const
 void TrustScoreManager::RecordMissedCheckIns(int currentHeight) {
     int expectedInterval = consensusParams.nHeartbeatInterval;
 
-    for (auto& [id, info] : validators) {
-        if (!info.isActive) continue;
-
-        // Check if validator should have checked in by now
-        int blocksSinceLastCheckIn = currentHeight - info.lastHeartbeatHeight;
-        if (blocksSinceLastCheckIn > expectedInterval * 2) {
-            // Missed at least one check-in
-            info.missedCheckIns++;
-            info.consecutiveCheckIns = 0;
-            LogPrintf("TrustScoreManager: Validator %s missed check-in (total missed: %d)\n",
-                      id.ToString(), info.missedCheckIns);
+    // Only validators whose deadline passed are visited
+    while (!checkInDeadlines.empty() && checkInDeadlines.begin()->first < currentHeight) {
+        auto [deadline, id] = *checkInDeadlines.begin();
+        ValidatorInfo& info = validators.at(id);
+
+        // One missed check-in per interval elapsed past the deadline
+        int missed = (currentHeight - deadline - 1) / expectedInterval + 1;
+        info.missedCheckIns += missed;
+        info.consecutiveCheckIns = 0;
+        LogDebug(BCLog::NET, "TrustScoreManager: Validator %s missed check-in (total missed: %d)\n",
+                 id.ToString(), info.missedCheckIns);
+
+        ScheduleCheckIn(id, deadline + missed * expectedInterval);
+    }
+}
+
+std::vector<ValidatorInfo> TrustScoreManager::GetValidatorsChangedSince(uint64_t epoch) const {
+    std::vector<ValidatorInfo> result;
+    for (auto it = changeLog.lower_bound({epoch + 1, CKeyID()}); it != changeLog.end(); ++it) {
+        result.push_back(Evaluate(validators.at(it->second)));
+    }
+    return result;
+}
+
+std::vector<CKeyID> TrustScoreManager::GetActiveValidatorIds() const {
+    std::vector<CKeyID> result;
+    for (const auto& [id, info] : validators) {
+        if (info.isActive) {
+            result.push_back(id);
         }
     }
+    return result;
 }
 
 //////////////////////////////////////////////////
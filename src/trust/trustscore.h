@@ -15,9 +15,12 @@
 #include <sync.h>
 
 #include <cstdint>
+#include <ios>
 #include <map>
+#include <optional>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace trust {
@@ -48,7 +51,7 @@ public:
     int64_t poolFeeRate;          // Pool fee rate in basis points (100 = 1%)
     int registrationHeight;       // Block height when validator registered
     int lastHeartbeatHeight;      // Last heartbeat block height
-    int heartbeatsExpected;       // Total heartbeats expected since registration
+    int heartbeatsExpected;       // Heartbeats expected in the uptime window (filled in on read)
     int heartbeatsReceived;       // Total heartbeats actually received
     bool isActive;                // Whether validator is currently active
 
@@ -108,6 +111,11 @@ public:
      */
     std::string GetIPAddress() const;
 
+    /**
+     * Heartbeats expected in the uptime window ending at the given height
+     */
+    int GetExpectedHeartbeats(int height, const Consensus::Params& params) const;
+
     /**
      * Calculate uptime percentage (multiplied by 10 for precision)
      * Returns value like 950 for 95.0%
@@ -192,18 +200,120 @@ public:
     bool Sign(const CKey& key);
 
     /**
-     * Verify the heartbeat signature
+     * Get the hash of this heartbeat including its signature
+     */
+    uint256 GetSignedHash() const;
+
+    /**
+     * Whether the signature is a compact (recoverable) one. Nodes that
+     * predate compact heartbeat signatures sign with DER signatures, which
+     * cannot be checked against validatorId alone.
+     */
+    bool HasCompactSignature() const { return signature.size() == CPubKey::COMPACT_SIGNATURE_SIZE; }
+
+    /**
+     * Verify the heartbeat signature, compact or DER
      */
     bool Verify(const CPubKey& pubkey) const;
 
+    /**
+     * Verify that the signature recovers to validatorId
+     */
+    bool Verify() const;
+
     /**
      * Get the node address as a string for addnode command
      */
     std::string GetNodeAddressString() const;
 };
 
+/**
+ * Version byte leading every compact heartbeat and validator list message
+ */
+static constexpr uint8_t TRUST_COMPACT_ENCODING_VERSION = 1;
+
+/**
+ * Compact wire encoding for ValidatorInfo: the address in native BIP155 form
+ * and varints for amounts, heights and counters
+ */
+struct CompactValidatorInfoFormatter {
+    template<typename Stream>
+    void Ser(Stream& s, const ValidatorInfo& info) {
+        s << info.validatorId;
+        s << VARINT_MODE(info.stakeAmount, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.poolFeeRate, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.registrationHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.lastHeartbeatHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.heartbeatsExpected, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.heartbeatsReceived, VarIntMode::NONNEGATIVE_SIGNED);
+        s << info.isActive;
+        s << CNetAddr::V2(info.lastKnownAddress);
+        s << info.lastCheckInTime;
+        s << VARINT_MODE(info.consecutiveCheckIns, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT_MODE(info.missedCheckIns, VarIntMode::NONNEGATIVE_SIGNED);
+    }
+
+    template<typename Stream>
+    void Unser(Stream& s, ValidatorInfo& info) {
+        s >> info.validatorId;
+        s >> VARINT_MODE(info.stakeAmount, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.poolFeeRate, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.registrationHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.lastHeartbeatHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.heartbeatsExpected, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.heartbeatsReceived, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> info.isActive;
+        s >> CNetAddr::V2(info.lastKnownAddress);
+        s >> info.lastCheckInTime;
+        s >> VARINT_MODE(info.consecutiveCheckIns, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT_MODE(info.missedCheckIns, VarIntMode::NONNEGATIVE_SIGNED);
+    }
+};
+
+/**
+ * Compact wire encoding for Heartbeat, preceded by the encoding version
+ */
+struct CompactHeartbeatFormatter {
+    template<typename Stream>
+    void Ser(Stream& s, const Heartbeat& hb) {
+        s << TRUST_COMPACT_ENCODING_VERSION;
+        s << hb.validatorId;
+        s << VARINT_MODE(hb.blockHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s << hb.blockHash;
+        s << hb.timestamp;
+        s << CNetAddr::V2(hb.nodeAddress);
+        s << hb.nodePort;
+        s << hb.signature;
+    }
+
+    template<typename Stream>
+    void Unser(Stream& s, Heartbeat& hb) {
+        uint8_t version;
+        s >> version;
+        if (version != TRUST_COMPACT_ENCODING_VERSION) {
+            throw std::ios_base::failure("Unsupported compact heartbeat encoding version");
+        }
+        s >> hb.validatorId;
+        s >> VARINT_MODE(hb.blockHeight, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> hb.blockHash;
+        s >> hb.timestamp;
+        s >> CNetAddr::V2(hb.nodeAddress);
+        s >> hb.nodePort;
+        s >> hb.signature;
+    }
+};
+
 /**
  * Trust score manager - handles validator registration, heartbeat tracking, and tier calculation
+ *
+ * Expected heartbeats depend only on the registration height and the current
+ * height, so they are computed when a validator is read rather than stored
+ * per block. Missed check-ins are detected from a deadline-ordered queue, so
+ * per-block work is proportional to the validators whose deadline passed.
+ *
+ * Registrations, stake and fee updates and deactivations advance a change
+ * epoch, so peers can be sent only the validators changed since an epoch
+ * they already have.
  */
 class TrustScoreManager {
 private:
@@ -211,11 +321,54 @@ private:
     const Consensus::Params& consensusParams;
     int currentHeight;
 
+    // Identifies this instance's change epochs; epochs restart with a new id
+    const uint256 changeSetId;
+    uint64_t changeEpoch{0};
+
+    // Validators ordered by the epoch of their last change
+    std::set<std::pair<uint64_t, CKeyID>> changeLog;
+    std::map<CKeyID, uint64_t> lastChangeEpoch;
+
+    // XOR of the hashes of all active validator IDs
+    uint256 activeSetHash;
+
+    // Active validators ordered by the height after which their next check-in counts as missed
+    std::set<std::pair<int, CKeyID>> checkInDeadlines;
+    std::map<CKeyID, int> nextCheckInDeadline;
+
+    /**
+     * Copy of a validator with heartbeatsExpected evaluated at the current height
+     */
+    ValidatorInfo Evaluate(const ValidatorInfo& info) const;
+
+    /**
+     * (Re)schedule or drop a validator's missed check-in deadline
+     */
+    void ScheduleCheckIn(const CKeyID& validatorId, int deadline);
+    void UnscheduleCheckIn(const CKeyID& validatorId);
+
+    /**
+     * Deactivate a validator, freezing its expected heartbeats at the current height
+     */
+    void Deactivate(ValidatorInfo& info);
+
+    /**
+     * Record a change to a validator's registration data or active state
+     */
+    void MarkChanged(const CKeyID& validatorId);
+
+    /**
+     * Add or remove a validator ID from the active set hash
+     */
+    void ToggleActiveSetHash(const CKeyID& validatorId);
+
 public:
     explicit TrustScoreManager(const Consensus::Params& params);
 
     /**
-     * Register a new validator
+     * Register a new validator. Its first check-in is due two heartbeat
+     * intervals after the registration height, or after the current height
+     * if the validator only becomes known later.
      */
     bool RegisterValidator(const CKeyID& validatorId, int64_t stakeAmount,
                           int64_t poolFeeRate, int height);
@@ -236,14 +389,14 @@ public:
     bool ProcessHeartbeat(const Heartbeat& heartbeat, int height);
 
     /**
-     * Update expected heartbeats for all validators at new block height
+     * Advance the height expected heartbeats are evaluated at
      */
     void UpdateHeartbeatExpectations(int height);
 
     /**
-     * Get validator info by ID
+     * Get validator info by ID, evaluated at the current height
      */
-    const ValidatorInfo* GetValidator(const CKeyID& validatorId) const;
+    std::optional<ValidatorInfo> GetValidator(const CKeyID& validatorId) const;
 
     /**
      * Get trust tier for a validator
@@ -310,9 +463,40 @@ public:
     CKeyID GetValidatorIdByAddress(const CService& address) const;
 
     /**
-     * Record a missed check-in for validators that didn't report
+     * Record a missed check-in for each heartbeat interval a validator let
+     * pass after its deadline
      */
     void RecordMissedCheckIns(int currentHeight);
+
+    /**
+     * Number of validators waiting on a check-in deadline
+     */
+    size_t GetPendingCheckInCount() const { return checkInDeadlines.size(); }
+
+    //////////////////////////////////////////////////
+    // Validator set sync
+    //////////////////////////////////////////////////
+
+    /**
+     * Identifier of the epoch sequence, and the current epoch
+     */
+    const uint256& GetChangeSetId() const { return changeSetId; }
+    uint64_t GetChangeEpoch() const { return changeEpoch; }
+
+    /**
+     * Order-independent hash of the active validator IDs
+     */
+    const uint256& GetActiveSetHash() const { return activeSetHash; }
+
+    /**
+     * Validators (active or not) changed after the given epoch
+     */
+    std::vector<ValidatorInfo> GetValidatorsChangedSince(uint64_t epoch) const;
+
+    /**
+     * IDs of all active validators
+     */
+    std::vector<CKeyID> GetActiveValidatorIds() const;
 };
 
 /**
@@ -71,8 +71,10 @@
 #include <univalue.h>
 #include <util/signstr.h>
 #include <qtum/qtumutils.h>
+#include <qtum/callstate.h>
 #include <common/args.h>
 #include <addresstype.h>
+#include <validators/validatorstore.h>
 
 #include <algorithm>
 #include <cassert>
@@ -2097,13 +2099,19 @@ bool IsConfirmedInNPrevBlocks(const CDiskTxPos& txindex, const CBlockIndex* pind
     return false;
 }
 
+std::optional<int> HeaderSignatureCheck::operator()()
+{
+    *m_signers = RecoverHeaderSigners(*m_header);
+    return std::nullopt;
+}
+
 bool CheckHeaderPoW(const CBlockHeader& block, const Consensus::Params& consensusParams)
 {
     // Check for proof of work block header
     return CheckProofOfWork(block.GetHash(), block.nBits, consensusParams);
 }
 
-bool CheckHeaderPoS(const CBlockHeader& block, const Consensus::Params& consensusParams, Chainstate& chainstate)
+bool CheckHeaderPoS(const CBlockHeader& block, const Consensus::Params& consensusParams, Chainstate& chainstate, const HeaderSigners* signers = nullptr)
 {
     LOCK(cs_main);
     // Check for proof of stake block header
@@ -2115,7 +2123,7 @@ bool CheckHeaderPoS(const CBlockHeader& block, const Consensus::Params& consensu
     // Check the kernel hash
     CBlockIndex* pindexPrev = &((*mi).second);
 
-    if(pindexPrev->nHeight >= consensusParams.nEnableHeaderSignatureHeight && !CheckRecoveredPubKeyFromBlockSignature(pindexPrev, block, chainstate.CoinsTip(), chainstate)) {
+    if(pindexPrev->nHeight >= consensusParams.nEnableHeaderSignatureHeight && !CheckRecoveredPubKeyFromBlockSignature(pindexPrev, block, chainstate.CoinsTip(), chainstate, signers)) {
         LogError("Failed signature check");
         return false;
     }
@@ -2135,15 +2143,12 @@ bool CheckHeaderProof(const CBlockHeader& block, const Consensus::Params& consen
 
 bool CheckIndexProof(const CBlockIndex& block, const Consensus::Params& consensusParams)
 {
-    // Get the hash of the proof
-    // After validating the PoS block the computed hash proof is saved in the block index, which is used to check the index
-    uint256 hashProof = block.IsProofOfWork() ? block.GetBlockHash() : block.hashProof;
-    // Check for proof after the hash proof is computed
+    // Check for proof, the stored PoS proof hash is not needed so the cold data of the index is not read
     if(block.IsProofOfStake()){
         //blocks are loaded out of order, so checking PoS kernels here is not practical
         return true; //CheckKernel(block.pprev, block.nBits, block.nTime, block.prevoutStake);
     }else{
-        return CheckProofOfWork(hashProof, block.nBits, consensusParams);
+        return CheckProofOfWork(block.GetBlockHash(), block.nBits, consensusParams);
     }
 }
 
@@ -2581,6 +2586,8 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
         return DISCONNECT_FAILED;
     }
 
+    m_spent_coin_journal.Disconnect(pindex);
+
     /////////////////////////////////////////////////////////// // qtum
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
@@ -2688,8 +2695,20 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     globalState->setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot)); // qtum
 
     if(pfClean == NULL && fLogEvents){
+        CBlockLogIndex logIndex(pindex->nHeight);
+        for (const auto& tx : block.vtx) {
+            for (const auto& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+                if (receipt.blockHash != block.GetHash()) {
+                    continue;
+                }
+                for (const auto& log : receipt.logs) {
+                    logIndex.Add(tx->GetHash(), log.address, log.topics);
+                }
+            }
+        }
         pstorageresult->deleteResults(block.vtx);
         m_blockman.m_block_tree_db->EraseHeightIndex(pindex->nHeight);
+        m_blockman.m_block_tree_db->EraseLogIndex(logIndex);
     }
 
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
@@ -2699,6 +2718,7 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
         m_blockman.m_block_tree_db->EraseStakeIndex(pindex->nHeight);
         if(pindex->IsProofOfStake() && pindex->HasProofOfDelegation())
             m_blockman.m_block_tree_db->EraseDelegateIndex(pindex->nHeight);
+        g_mpos_script_window.Disconnect(pindex);
     }
 
     //////////////////////////////////////////////////// // qtum
@@ -2714,6 +2734,13 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     }
     ////////////////////////////////////////////////////
 
+    // WATTx: roll back validator and delegation state once the rest of the
+    // block is undone, so a failed coin undo leaves the validator state as is
+    if (pfClean == NULL && this == &m_chainman.ActiveChainstate() && !validators::DisconnectValidatorBlock(*pindex)) {
+        LogError("DisconnectBlock(): failure rolling back validator state\n");
+        return DISCONNECT_FAILED;
+    }
+
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2800,6 +2827,125 @@ unsigned int GetContractScriptFlags(int nHeight, const Consensus::Params& consen
 }
 
 /////////////////////////////////////////////////////////////////////// qtum
+void SpentCoinJournal::Connect(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockundo, const Consensus::Params& consensusParams)
+{
+    LOCK(m_mutex);
+
+    // Start again when the block does not extend the journal
+    if(!m_blocks.empty() && (!pindex->pprev || m_blocks.back().hash != pindex->pprev->GetBlockHash())) {
+        m_blocks.clear();
+        m_coins.clear();
+    }
+
+    BlockSpends spends{pindex->nHeight, pindex->GetBlockHash(), {}};
+    for(size_t j = 1; j < block.vtx.size() && j - 1 < blockundo.vtxundo.size(); ++j) {
+        const CTransaction& tx = *block.vtx[j];
+        const CTxUndo& txundo = blockundo.vtxundo[j - 1];
+        for(size_t k = 0; k < tx.vin.size() && k < txundo.vprevout.size(); ++k) {
+            spends.spent.push_back(tx.vin[k].prevout);
+            m_coins[tx.vin[k].prevout] = std::make_pair(pindex->nHeight, txundo.vprevout[k]);
+        }
+    }
+    m_blocks.push_back(std::move(spends));
+
+    // Forks are only checked back to the coinbase maturity
+    size_t maxBlocks = consensusParams.CoinbaseMaturity(pindex->nHeight + 1) + 1;
+    while(m_blocks.size() > maxBlocks) {
+        PopFront();
+    }
+}
+
+void SpentCoinJournal::Disconnect(const CBlockIndex* pindex)
+{
+    LOCK(m_mutex);
+    if(m_blocks.empty()) return;
+
+    if(m_blocks.back().hash != pindex->GetBlockHash()) {
+        m_blocks.clear();
+        m_coins.clear();
+        return;
+    }
+
+    for(const COutPoint& prevout : m_blocks.back().spent) {
+        m_coins.erase(prevout);
+    }
+    m_blocks.pop_back();
+}
+
+bool SpentCoinJournal::Find(const CBlockIndex* pindexTip, const COutPoint& prevout, int nForkHeight, Coin& coin, int& nScanHeight) const
+{
+    LOCK(m_mutex);
+    nScanHeight = pindexTip->nHeight;
+    if(m_blocks.empty() || m_blocks.back().hash != pindexTip->GetBlockHash())
+        return false;
+
+    auto it = m_coins.find(prevout);
+    if(it != m_coins.end() && it->second.first > nForkHeight) {
+        coin = it->second.second;
+        return true;
+    }
+
+    nScanHeight = m_blocks.front().height - 1;
+    return false;
+}
+
+void SpentCoinJournal::Clear()
+{
+    LOCK(m_mutex);
+    m_blocks.clear();
+    m_coins.clear();
+}
+
+void ImmatureStakeTracker::Update(const CBlockIndex* pindexTip, const Consensus::Params& consensusParams)
+{
+    LOCK(m_mutex);
+    const CBlockIndex* pindexLast = m_blocks.empty() ? nullptr : m_blocks.back();
+    if (pindexLast == pindexTip) return;
+
+    if (pindexTip && pindexLast && pindexTip->pprev == pindexLast) {
+        m_blocks.push_back(pindexTip);
+    } else if (pindexTip && pindexLast && pindexLast->pprev == pindexTip) {
+        m_blocks.pop_back();
+        if (m_blocks.empty()) m_blocks.push_back(pindexTip);
+    } else {
+        // Jumped to another tip, start again from it
+        m_blocks.clear();
+        if (pindexTip) m_blocks.push_back(pindexTip);
+    }
+
+    // The window is the maturity of the next block, blocks that left it
+    // after a disconnect are taken back from the ancestors of the oldest one.
+    // The tip is always kept so the next update can tell how the tip moved.
+    m_window = pindexTip ? std::max(consensusParams.CoinbaseMaturity(pindexTip->nHeight + 1) - 1, 0) : 0;
+    size_t nKeep = std::max<size_t>(m_window, 1);
+    while (m_blocks.size() > nKeep) m_blocks.pop_front();
+    while (!m_blocks.empty() && m_blocks.size() < nKeep && m_blocks.front()->pprev) m_blocks.push_front(m_blocks.front()->pprev);
+    m_snapshot.reset();
+}
+
+std::shared_ptr<const std::map<COutPoint, uint32_t>> ImmatureStakeTracker::GetSnapshot() const
+{
+    LOCK(m_mutex);
+    if (!m_snapshot) {
+        auto stakes = std::make_shared<std::map<COutPoint, uint32_t>>();
+        // From the tip down, so the oldest block wins for the null prevout of PoW blocks
+        size_t nCount = std::min(m_window, m_blocks.size());
+        for (auto it = m_blocks.rbegin(); it != m_blocks.rbegin() + nCount; ++it) {
+            (*stakes)[(*it)->prevoutStake] = (*it)->nTime;
+        }
+        m_snapshot = std::move(stakes);
+    }
+    return m_snapshot;
+}
+
+void SpentCoinJournal::PopFront()
+{
+    for(const COutPoint& prevout : m_blocks.front().spent) {
+        m_coins.erase(prevout);
+    }
+    m_blocks.pop_front();
+}
+
 bool GetSpentCoinFromBlock(const CBlockIndex* pindex, COutPoint prevout, Coin* coin, Chainstate& chainstate) {
     std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
     CBlock& block = *pblock;
@@ -2867,8 +3013,14 @@ bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutSt
 
     // Scan through blocks until we reach the forkbase to check if the prevoutStake has been spent in one of those blocks
     // If it not in any of those blocks, and not in the utxo set, it can't be spendable in the orphan chain.
+    // The recent blocks are looked up in the spent coin journal, only the blocks it does not have yet are read.
     {
         CBlockIndex* pindex = chainstate.m_chain.Tip();
+        int nScanHeight = pindex->nHeight;
+        if(chainstate.m_spent_coin_journal.Find(pindex, prevoutStake, pforkBase->nHeight, *coin, nScanHeight)) {
+            return true;
+        }
+        pindex = nScanHeight > pforkBase->nHeight ? pindex->GetAncestor(nScanHeight) : nullptr;
         while(pindex && pindex != pforkBase) {
             if(GetSpentCoinFromBlock(pindex, prevoutStake, coin, chainstate)) {
                 return true;
@@ -2952,8 +3104,24 @@ bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx){
     return true;
 }
 
+/** State contract execution on this thread runs against */
+static QtumState& ExecutionState()
+{
+    CallState* callState = CallStatePool::current();
+    return callState ? callState->state() : *globalState;
+}
+
+/** Seal engine contract execution on this thread runs with */
+static dev::eth::SealEngineFace& ExecutionSealEngine()
+{
+    CallState* callState = CallStatePool::current();
+    return callState ? callState->sealEngine() : *globalSealEngine;
+}
+
 std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, Chainstate& chainstate, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
-    CBlockIndex* pblockindex = &(chainstate.m_blockman.m_block_index[chainstate.m_chain.Tip()->GetBlockHash()]);
+    // A pinned call state has its own block, which stands in for the tip
+    CallState* callState = CallStatePool::current();
+    CBlockIndex* pblockindex = callState && callState->block() ? callState->block() : &(chainstate.m_blockman.m_block_index[chainstate.m_chain.Tip()->GetBlockHash()]);
     return CallContract(addrContract, opcode, chainstate, pblockindex, sender, gasLimit, nAmount);
 }
 
@@ -2975,7 +3143,7 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     else
     	block.vtx.erase(block.vtx.begin()+1,block.vtx.end());
 
-    QtumDGP qtumDGP(globalState.get(), chainstate, fGettingValuesDGP);
+    QtumDGP qtumDGP(&ExecutionState(), chainstate, fGettingValuesDGP);
     uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(pblockindex->nHeight + 1);
 
     if(gasLimit == 0){
@@ -2984,7 +3152,7 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     dev::Address senderAddress = sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : sender;
     tx.vout.push_back(CTxOut(nAmount, CScript() << OP_DUP << OP_HASH160 << senderAddress.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG));
     block.vtx.push_back(MakeTransactionRef(CTransaction(tx)));
-    dev::u256 nonce = globalState->getNonce(senderAddress);
+    dev::u256 nonce = ExecutionState().getNonce(senderAddress);
 
     QtumTransaction callTransaction;
     if(addrContract == dev::Address())
@@ -3246,14 +3414,16 @@ class ExecTransientStorage
 {
 public:
     void init() {
-        globalState->clearTransientStorage();
+        ExecutionState().clearTransientStorage();
     }
     ~ExecTransientStorage() {
-        globalState->clearTransientStorage();
+        ExecutionState().clearTransientStorage();
     }
 };
 
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
+    QtumState& state = ExecutionState();
+    dev::eth::SealEngineFace& sealEngine = ExecutionSealEngine();
     ExecTransientStorage storage;
     storage.init();
     for(QtumTransaction& tx : txs){
@@ -3262,7 +3432,7 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
             return false;
         }
         dev::eth::EnvInfo envInfo(BuildEVMEnvironment());
-        if(!tx.isCreation() && !globalState->addressInUse(tx.receiveAddress())){
+        if(!tx.isCreation() && !state.addressInUse(tx.receiveAddress())){
             dev::eth::ExecutionResult execRes;
             execRes.excepted = dev::eth::TransactionException::Unknown;
             result.push_back(ResultExecute{
@@ -3272,11 +3442,12 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
             });
             continue;
         }
-        result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, chain, type, OnOpFunc()));
+        result.push_back(state.execute(envInfo, sealEngine, tx, pindex->nHeight, type, OnOpFunc()));
     }
-    globalState->db().commit();
-    globalState->dbUtxo().commit();
-    globalSealEngine.get()->deleteAddresses.clear();
+    // The trie nodes stay in memory until the block is connected
+    state.db().stage();
+    state.dbUtxo().stage();
+    sealEngine.deleteAddresses.clear();
     return true;
 }
 
@@ -3339,18 +3510,68 @@ dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(){
     lastHashes.set(tip);
     qtumutils::HistoricalHashes::instance().set(tip);
 
-    if(block.IsProofOfStake()){
-        header.setAuthor(EthAddrFromScript(block.vtx[1]->vout[1].scriptPubKey));
-    }else {
-        header.setAuthor(EthAddrFromScript(block.vtx[0]->vout[0].scriptPubKey));
-    }
+    header.setAuthor(blockAuthor());
     dev::u256 gasUsed;
-    int &chainID = const_cast<int&>(globalSealEngine->chainParams().chainID);
+    int &chainID = const_cast<int&>(ExecutionSealEngine().chainParams().chainID);
     chainID = qtumutils::eth_getChainId(tip->nHeight);
     dev::eth::EnvInfo env(header, lastHashes, gasUsed, chainID);
     return env;
 }
 
+dev::Address ByteCodeExec::blockAuthor(){
+    if(block.IsProofOfStake()){
+        return EthAddrFromScript(block.vtx[1]->vout[1].scriptPubKey);
+    }
+    return EthAddrFromScript(block.vtx[0]->vout[0].scriptPubKey);
+}
+
+dev::h256 ByteCodeExec::environmentHash(){
+    dev::RLPStream s(6);
+    s << uintToh256(pindex->GetBlockHash()) << pindex->nHeight << block.nTime << block.nBits << blockGasLimit << blockAuthor();
+    return dev::sha3(s.out());
+}
+
+dev::h256 ByteCodeExec::executionHash(const std::vector<QtumTransaction>& txs){
+    dev::RLPStream s(txs.size());
+    for(const QtumTransaction& tx : txs){
+        s.appendList(6) << tx.sha3(dev::eth::WithoutSignature) << tx.sender() << tx.getRefundSender() << tx.getHashWith() << tx.getNVout() << tx.getVersion().toRaw();
+    }
+    return dev::sha3(s.out());
+}
+
+AssemblyExecCache g_assembly_exec_cache;
+
+void AssemblyExecCache::Clear()
+{
+    m_entries.clear();
+    m_stateNodes = dev::OverlayDB();
+    m_utxoNodes = dev::OverlayDB();
+}
+
+void AssemblyExecCache::Add(dev::h256 const& stateRoot, dev::h256 const& utxoRoot, const uint256& txHash, uint32_t position, dev::h256 const& envHash, Entry entry)
+{
+    m_entries.insert_or_assign(Key{stateRoot, utxoRoot, txHash, position, envHash}, std::move(entry));
+}
+
+const AssemblyExecCache::Entry* AssemblyExecCache::Find(dev::h256 const& stateRoot, dev::h256 const& utxoRoot, const uint256& txHash, uint32_t position, dev::h256 const& envHash, dev::h256 const& execHash) const
+{
+    auto it = m_entries.find(Key{stateRoot, utxoRoot, txHash, position, envHash});
+    if (it == m_entries.end() || it->second.execHash != execHash) return nullptr;
+    return &it->second;
+}
+
+void AssemblyExecCache::SetNodes(dev::OverlayDB stateNodes, dev::OverlayDB utxoNodes)
+{
+    m_stateNodes = std::move(stateNodes);
+    m_utxoNodes = std::move(utxoNodes);
+}
+
+void AssemblyExecCache::StageNodes(QtumState& state) const
+{
+    state.db().stage(m_stateNodes);
+    state.dbUtxo().stage(m_utxoNodes);
+}
+
 dev::Address ByteCodeExec::EthAddrFromScript(const CScript& script){
     CTxDestination addressBit;
     TxoutType txType=TxoutType::NONSTANDARD;
@@ -3773,11 +3994,12 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-    std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    CBlockLogIndex logIndex(pindex->nHeight);
     /////////////////////////////////////////////////////////
 
     uint64_t blockGasUsed = 0;
     CAmount gasRefunds=0;
+    bool stagedAssemblyNodes = false; // Trie nodes of our own template staged into globalState
 
     uint64_t nValueOut=0;
     uint64_t nValueIn=0;
@@ -4016,14 +4238,23 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 }
             }
 
-            if(!exec.performByteCode()){
+            // Reuse the results of assembling our own block if it was executed the same way
+            const AssemblyExecCache::Entry* cached = g_assembly_exec_cache.Find(globalState->rootHash(), globalState->rootHashUTXO(), tx.GetHash(), i, exec.environmentHash(), ByteCodeExec::executionHash(resultConvertQtumTX.first));
+            if(cached){
+                if(!stagedAssemblyNodes){
+                    g_assembly_exec_cache.StageNodes(*globalState);
+                    stagedAssemblyNodes = true;
+                }
+                globalState->setRoot(cached->stateRoot);
+                globalState->setRootUTXO(cached->utxoRoot);
+            }else if(!exec.performByteCode()){
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-unknown-error", "ConnectBlock(): Unknown error during contract execution");
                 break;
             }
 
-            std::vector<ResultExecute> resultExec(exec.getResult());
-            ByteCodeExecResult bcer;
-            if(!exec.processingResults(bcer)){
+            std::vector<ResultExecute> resultExec(cached ? cached->result : exec.getResult());
+            ByteCodeExecResult bcer(cached ? cached->bcer : ByteCodeExecResult());
+            if(!cached && !exec.processingResults(bcer)){
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-vm-exec-processing", "ConnectBlock(): Error processing VM execution results");
                 break;
             }
@@ -4034,10 +4265,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 uint64_t countCumulativeGasUsed = blockGasUsed;
                 for(size_t k = 0; k < resultConvertQtumTX.first.size(); k ++){
                     for(auto& log : resultExec[k].txRec.log()) {
-                        if(!heightIndexes.count(log.address)){
-                            heightIndexes[log.address].first = CHeightTxIndexKey(pindex->nHeight, log.address);
-                        }
-                        heightIndexes[log.address].second.push_back(tx.GetHash());
+                        logIndex.Add(tx.GetHash(), log.address, log.topics);
                     }
                     uint64_t gasUsed = uint64_t(resultExec[k].execRes.gasUsed);
                     countCumulativeGasUsed += gasUsed;
@@ -4222,6 +4450,8 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         }
         globalState->setRoot(prevHashStateRoot);
         globalState->setRootUTXO(prevHashUTXORoot);
+        globalState->db().rollback();
+        globalState->dbUtxo().rollback();
         return true;
     }
 //////////////////////////////////////////////////////////////////
@@ -4238,6 +4468,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     if (!m_blockman.WriteBlockUndo(blockundo, state, *pindex)) {
         return false;
     }
+    m_spent_coin_journal.Connect(pindex, block, blockundo, params.GetConsensus());
 
     const auto time_5{SteadyClock::now()};
     m_chainman.time_undo += time_5 - time_4;
@@ -4253,11 +4484,8 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     if (fLogEvents)
     {
-        for (const auto& e: heightIndexes)
-        {
-            if (!m_blockman.m_block_tree_db->WriteHeightIndex(e.second.first, e.second.second))
-                return FatalError(m_chainman.GetNotifications(), state, _("Failed to write height index"));
-        }
+        if (!m_blockman.m_block_tree_db->WriteLogIndex(logIndex))
+            return FatalError(m_chainman.GetNotifications(), state, _("Failed to write log index"));
     }
 
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
@@ -4275,13 +4503,14 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 m_blockman.m_block_tree_db->WriteStakeIndex(pindex->nHeight, uint160());
             }
 
+            uint160 address;
+            uint8_t fee = 0;
             if(block.HasProofOfDelegation())
             {
-                uint160 address;
-                uint8_t fee = 0;
                 GetBlockDelegation(block, pkh, address, fee, view, *this);
                 m_blockman.m_block_tree_db->WriteDelegateIndex(pindex->nHeight, address, fee);
             }
+            g_mpos_script_window.Connect(pindex, MakeMPoSScript(pkh, block.HasProofOfDelegation() ? &address : nullptr, fee), params.GetConsensus());
         }else{
             m_blockman.m_block_tree_db->WriteStakeIndex(pindex->nHeight, uint160());
         }
@@ -4342,6 +4571,10 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     if (fLogEvents)
         pstorageresult->commitResults();
 
+    // qtum: write the trie nodes of all contract executions in the block in one batch
+    globalState->db().commit();
+    globalState->dbUtxo().commit();
+
     return true;
 }
 
@@ -4508,6 +4741,10 @@ bool Chainstate::FlushStateToDisk(
             if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
                 return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
             }
+            // WATTx: validator and delegation state follows the coins flush
+            if (this == &m_chainman.ActiveChainstate() && !validators::FlushValidatorStore()) {
+                return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to validator database."));
+            }
             m_last_flush = nNow;
             full_flush_completed = true;
             TRACEPOINT(utxocache, flush,
@@ -4585,6 +4822,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
     }
 
     // New best block
+    m_chainman.m_immature_stakes.Update(pindexNew, m_chainman.GetConsensus());
     if (m_mempool) {
         m_mempool->AddTransactionsUpdated(1);
     }
@@ -4772,6 +5010,8 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
 
             globalState->setRoot(oldHashStateRoot); // qtum
             globalState->setRootUTXO(oldHashUTXORoot); // qtum
+            globalState->db().rollback(); // qtum
+            globalState->dbUtxo().rollback(); // qtum
             pstorageresult->clearCacheResult();
             LogError("%s: ConnectBlock %s failed, %s\n", __func__, pindexNew->GetBlockHash().ToString(), state.ToString());
             return false;
@@ -4786,6 +5026,10 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
         bool flushed = view.Flush();
         assert(flushed);
     }
+    // WATTx: per-block validator and delegation processing
+    if (this == &m_chainman.ActiveChainstate()) {
+        validators::ConnectValidatorBlock(*pindexNew);
+    }
     const auto time_4{SteadyClock::now()};
     m_chainman.time_flush += time_4 - time_3;
     LogDebug(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n",
@@ -4811,6 +5055,15 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     m_chain.SetTip(*pindexNew);
     UpdateTip(pindexNew);
 
+    // qtum: drop the signature and proof hash of the index leaving the recent part of the chain,
+    // an index that is not written yet keeps them until the next restart
+    if (pindexNew->nHeight > BLOCK_INDEX_COLD_DEPTH) {
+        CBlockIndex* pindexCold = pindexNew->GetAncestor(pindexNew->nHeight - BLOCK_INDEX_COLD_DEPTH);
+        if (pindexCold && !m_blockman.m_dirty_blockindex.count(pindexCold)) {
+            pindexCold->ReleaseColdData();
+        }
+    }
+
     const auto time_6{SteadyClock::now()};
     m_chainman.time_post_connect += time_6 - time_5;
     m_chainman.time_total += time_6 - time_1;
@@ -5660,14 +5913,14 @@ bool CheckBlockSignature(const CBlock& block)
     return CPubKey(vchPubKey).Verify(hash, vchBlockSig);
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, Chainstate& chainstate, bool fCheckPOW = true, bool fCheckPOS = true)
+static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, Chainstate& chainstate, bool fCheckPOW = true, bool fCheckPOS = true, const HeaderSigners* signers = nullptr)
 {
     // Check proof of work matches claimed amount
     if (fCheckPOW && block.IsProofOfWork() && !CheckHeaderPoW(block, consensusParams))
         return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
 
     // Check proof of stake matches claimed amount
-    if (fCheckPOS && !chainstate.m_chainman.IsInitialBlockDownload() && block.IsProofOfStake() && !CheckHeaderPoS(block, consensusParams, chainstate))
+    if (fCheckPOS && !chainstate.m_chainman.IsInitialBlockDownload() && block.IsProofOfStake() && !CheckHeaderPoS(block, consensusParams, chainstate, signers))
         // May occur if behind on block chain sync
        return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "bad-cb-header", "proof of stake failed");
 
@@ -6117,7 +6370,7 @@ bool Chainstate::UpdateHashProof(const CBlock& block, BlockValidationState& stat
     }
 
     // Record proof hash value
-    pindex->hashProof = hashProof;
+    pindex->SetHashProof(hashProof);
     return true;
 }
 
@@ -6151,7 +6404,7 @@ bool CheckPOS(const CBlockHeader& block, CBlockIndex* pindexPrev, Chainstate& ch
     return false;
 }
 
-bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, CBlockIndex** ppindex, bool min_pow_checked)
+bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, CBlockIndex** ppindex, bool min_pow_checked, const HeaderSigners* signers)
 {
     AssertLockHeld(cs_main);
 
@@ -6265,7 +6518,7 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
 
         // Check block header
         // if (!CheckBlockHeader(block, state, GetConsensus(), true, CheckPOS(block, pindexPrev)))
-        if (!CheckBlockHeader(block, state, GetConsensus(), chainstate)) {
+        if (!CheckBlockHeader(block, state, GetConsensus(), chainstate, true, true, signers)) {
             LogDebug(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
@@ -6313,45 +6566,68 @@ bool ChainstateManager::ProcessNewBlockHeaders(std::span<const CBlockHeader> hea
     }
     AssertLockNotHeld(cs_main);
     {
-        LOCK(cs_main);
+        // The signatures of proof of stake headers are recovered on the header check queue without cs_main,
+        // one batch ahead of the batch being accepted, so only the checks that need the chain state hold the lock
+        const bool fPreCheck = !IsInitialBlockDownload();
+        std::vector<HeaderSigners> signers(fPreCheck ? headers.size() : 0);
+        std::optional<CCheckQueueControl<HeaderSignatureCheck>> control;
+        auto queueSignatureChecks = [&](size_t begin) {
+            std::vector<HeaderSignatureCheck> checks;
+            for (size_t i = begin; i < std::min(begin + HEADER_PRECHECK_BATCH, headers.size()); ++i) {
+                if (headers[i].IsProofOfStake()) checks.emplace_back(headers[i], signers[i]);
+            }
+            control.emplace(&m_header_check_queue);
+            control->Add(std::move(checks));
+        };
+        if (fPreCheck) queueSignatureChecks(0);
+
         bool bFirst = true;
         bool fInstantBan = false;
-        for (size_t i = 0; i < headers.size(); ++i) {
-            const CBlockHeader& header = headers[i];
+        for (size_t begin = 0; begin < headers.size(); begin += HEADER_PRECHECK_BATCH) {
+            if (control) {
+                control->Complete();
+                control.reset();
+                if (begin + HEADER_PRECHECK_BATCH < headers.size()) queueSignatureChecks(begin + HEADER_PRECHECK_BATCH);
+            }
 
-            // If the stake has been seen and the header has not yet been seen
-            if (!m_blockman.LoadingBlocks() && !IsInitialBlockDownload() && header.IsProofOfStake() && setStakeSeen.count(std::make_pair(header.prevoutStake, header.nTime)) && !BlockIndex().count(header.GetHash())) {
-                // if it is the last header of the list
-                if(i+1 == headers.size()) {
-                    if(fInstantBan) {
-                        // if we've seen a dupe stake header already in this list, then instaban
-                        return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "dupe-stake", strprintf("%s: duplicate proof-of-stake instant ban (%s, %d) for header %s", __func__, header.prevoutStake.ToString(), header.nTime, header.GetHash().ToString()));
+            LOCK(cs_main);
+            for (size_t i = begin; i < std::min(begin + HEADER_PRECHECK_BATCH, headers.size()); ++i) {
+                const CBlockHeader& header = headers[i];
+
+                // If the stake has been seen and the header has not yet been seen
+                if (!m_blockman.LoadingBlocks() && !IsInitialBlockDownload() && header.IsProofOfStake() && setStakeSeen.count(std::make_pair(header.prevoutStake, header.nTime)) && !BlockIndex().count(header.GetHash())) {
+                    // if it is the last header of the list
+                    if(i+1 == headers.size()) {
+                        if(fInstantBan) {
+                            // if we've seen a dupe stake header already in this list, then instaban
+                            return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "dupe-stake", strprintf("%s: duplicate proof-of-stake instant ban (%s, %d) for header %s", __func__, header.prevoutStake.ToString(), header.nTime, header.GetHash().ToString()));
+                        } else {
+                            // otherwise just reject the block until it is part of a longer list
+                            return state.Invalid(BlockValidationResult::BLOCK_HEADER_REJECT, "dupe-stake", strprintf("%s: duplicate proof-of-stake (%s, %d) for header %s", __func__, header.prevoutStake.ToString(), header.nTime, header.GetHash().ToString()));
+                        }
                     } else {
-                        // otherwise just reject the block until it is part of a longer list
-                        return state.Invalid(BlockValidationResult::BLOCK_HEADER_REJECT, "dupe-stake", strprintf("%s: duplicate proof-of-stake (%s, %d) for header %s", __func__, header.prevoutStake.ToString(), header.nTime, header.GetHash().ToString()));
+                        // if it is not part of the longest chain, then any error on a subsequent header should result in an instant ban
+                        fInstantBan = true;
                     }
-                } else {
-                    // if it is not part of the longest chain, then any error on a subsequent header should result in an instant ban
-                    fInstantBan = true;
                 }
-            }
-            CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted{AcceptBlockHeader(header, state, &pindex, min_pow_checked)};
-            CheckBlockIndex();
-
-            if (!accepted) {
-                // if we have seen a duplicate stake in this header list previously, then ban immediately.
-                if(fInstantBan) {
-                    state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, state.GetRejectReason(), "instant ban, due to duplicate header in the chain");
+                CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
+                bool accepted{AcceptBlockHeader(header, state, &pindex, min_pow_checked, fPreCheck ? &signers[i] : nullptr)};
+                CheckBlockIndex();
+
+                if (!accepted) {
+                    // if we have seen a duplicate stake in this header list previously, then ban immediately.
+                    if(fInstantBan) {
+                        state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, state.GetRejectReason(), "instant ban, due to duplicate header in the chain");
+                    }
+                    return false;
                 }
-                return false;
-            }
-            if (ppindex) {
-                *ppindex = pindex;
-                if(bFirst && pindexFirst)
-                {
-                    *pindexFirst = pindex;
-                    bFirst = false;
+                if (ppindex) {
+                    *ppindex = pindex;
+                    if(bFirst && pindexFirst)
+                    {
+                        *pindexFirst = pindex;
+                        bFirst = false;
+                    }
                 }
             }
         }
@@ -6668,6 +6944,8 @@ bool TestBlockValidity(BlockValidationState& state,
     if (!chainstate.ConnectBlock(block, state, &indexDummy, viewNew, true)) {
         globalState->setRoot(oldHashStateRoot); // qtum
         globalState->setRootUTXO(oldHashUTXORoot); // qtum
+        globalState->db().rollback(); // qtum
+        globalState->dbUtxo().rollback(); // qtum
         pstorageresult->clearCacheResult();
         return false;
     }
@@ -6694,6 +6972,9 @@ bool Chainstate::LoadChainTip()
     const CBlockIndex* tip = m_chain.Tip();
 
     if (tip && tip->GetBlockHash() == coins_cache.GetBestBlock()) {
+        if (this->GetRole() != ChainstateRole::BACKGROUND) {
+            m_chainman.m_immature_stakes.Update(tip, m_chainman.GetConsensus());
+        }
         return true;
     }
 
@@ -6714,6 +6995,7 @@ bool Chainstate::LoadChainTip()
 
     // Ensure KernelNotifications m_tip_block is set even if no new block arrives.
     if (this->GetRole() != ChainstateRole::BACKGROUND) {
+        m_chainman.m_immature_stakes.Update(tip, m_chainman.GetConsensus());
         // Ignoring return value for now.
         (void)m_chainman.GetNotifications().blockTip(GetSynchronizationState(/*init=*/true, m_chainman.m_blockman.m_blockfiles_indexed), *pindex);
     }
@@ -6872,6 +7154,8 @@ VerifyDBResult CVerifyDB::VerifyDB(
                 LogPrintf("Verification error: found unconnectable block at %d, hash=%s (%s)\n", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
                 globalState->setRoot(oldHashStateRoot); // qtum
                 globalState->setRootUTXO(oldHashUTXORoot); // qtum
+                globalState->db().rollback(); // qtum
+                globalState->dbUtxo().rollback(); // qtum
                 pstorageresult->clearCacheResult();
                 return VerifyDBResult::CORRUPTED_BLOCK_DB;
             }
@@ -7089,7 +7373,7 @@ bool Chainstate::LoadGenesisBlock()
             return false;
         }
         CBlockIndex* pindex = m_blockman.AddToBlockIndex(block, m_chainman.m_best_header);
-        pindex->hashProof = m_chainman.GetParams().GetConsensus().hashGenesisBlock;
+        pindex->SetHashProof(m_chainman.GetParams().GetConsensus().hashGenesisBlock);
         m_chainman.ReceivedBlockTransactions(block, pindex, blockPos);
     } catch (const std::runtime_error& e) {
         LogError("%s: failed to write genesis block: %s\n", __func__, e.what());
@@ -8386,6 +8670,7 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
     : m_script_check_queue{/*batch_size=*/128, std::clamp(options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS)},
+      m_header_check_queue{/*batch_size=*/16, std::clamp(options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS), "Header signature recovery", "headerch"},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)},
@@ -8783,22 +9068,8 @@ bool GetAddressWeight(uint256 addressHash, int type, const std::map<COutPoint, u
     return true;
 }
 
-std::map<COutPoint, uint32_t> GetImmatureStakes(ChainstateManager& chainman)
+std::shared_ptr<const std::map<COutPoint, uint32_t>> GetImmatureStakes(ChainstateManager& chainman)
 {
-    std::map<COutPoint, uint32_t> immatureStakes;
-    int height = chainman.ActiveChain().Height();
-    int coinbaseMaturity = chainman.GetConsensus().CoinbaseMaturity(height + 1);
-    for(int i = 0; i < coinbaseMaturity -1; i++) {
-        CBlockIndex* block = chainman.ActiveChain()[height - i];
-        if(block)
-        {
-            immatureStakes[block->prevoutStake] = block->nTime;
-        }
-        else
-        {
-            break;
-        }
-    }
-    return immatureStakes;
+    return chainman.m_immature_stakes.GetSnapshot();
 }
 //////////////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,7 @@
 #include <versionbits.h>
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
@@ -42,7 +43,9 @@
 #include <span>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -70,7 +73,9 @@ using valtype = std::vector<unsigned char>;
 using ExtractQtumTX = std::pair<std::vector<QtumTransaction>, std::vector<EthTransactionParams>>;
 ///////////////////////////////////////////
 
+class CBlockUndo;
 class Chainstate;
+struct HeaderSigners;
 class CTxMemPool;
 class ChainstateManager;
 struct ChainTxData;
@@ -114,6 +119,9 @@ static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
 /** Maximum number of dedicated script-checking threads allowed */
 static constexpr int MAX_SCRIPTCHECK_THREADS{15};
 
+/** Number of received headers whose signatures are recovered ahead of accepting them */
+static constexpr size_t HEADER_PRECHECK_BATCH{256};
+
 static const uint64_t DEFAULT_GAS_LIMIT_OP_CREATE=2500000;
 static const uint64_t DEFAULT_GAS_LIMIT_OP_SEND=250000;
 static const CAmount DEFAULT_GAS_PRICE=0.00000040*COIN;
@@ -423,6 +431,22 @@ static_assert(std::is_nothrow_move_assignable_v<CScriptCheck>);
 static_assert(std::is_nothrow_move_constructible_v<CScriptCheck>);
 static_assert(std::is_nothrow_destructible_v<CScriptCheck>);
 
+/**
+ * Closure recovering the signers of one proof of stake header, the part of
+ * the header check that does not need the chain state or cs_main
+ */
+class HeaderSignatureCheck
+{
+private:
+    const CBlockHeader* m_header;
+    HeaderSigners* m_signers;
+
+public:
+    HeaderSignatureCheck(const CBlockHeader& header, HeaderSigners& signers) : m_header(&header), m_signers(&signers) {}
+
+    std::optional<int> operator()();
+};
+
 /**
  * Convenience class for initializing and passing the script execution cache
  * and signature cache.
@@ -460,7 +484,7 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
 
 bool GetAddressWeight(uint256 addressHash, int type, const std::map<COutPoint, uint32_t>& immatureStakes, int32_t nHeight, uint64_t& nWeight, node::BlockManager& blockman);
 
-std::map<COutPoint, uint32_t> GetImmatureStakes(ChainstateManager& chainman);
+std::shared_ptr<const std::map<COutPoint, uint32_t>> GetImmatureStakes(ChainstateManager& chainman);
 /////////////////////////////////////////////////////////////////
 
 bool CheckIndexProof(const CBlockIndex& block, const Consensus::Params& consensusParams);
@@ -622,10 +646,18 @@ public:
 
     std::vector<ResultExecute>& getResult(){ return result; }
 
+    /** Hash of everything in the block environment the execution depends on */
+    dev::h256 environmentHash();
+
+    /** Hash of the contract executions, including the senders */
+    static dev::h256 executionHash(const std::vector<QtumTransaction>& txs);
+
 private:
 
     dev::eth::EnvInfo BuildEVMEnvironment();
 
+    dev::Address blockAuthor();
+
     dev::Address EthAddrFromScript(const CScript& scriptIn);
 
     std::vector<QtumTransaction> txs;
@@ -643,6 +675,106 @@ private:
     CChain& chain;
 };
 
+/**
+ * Contract execution results of the latest block template, so connecting our
+ * own block does not execute its contracts a second time. An entry is keyed by
+ * everything the execution depends on and only matches a transaction executed
+ * on the same pre-state, at the same position, in the same block environment.
+ */
+class AssemblyExecCache {
+public:
+    struct Entry {
+        dev::h256 execHash;                // ByteCodeExec::executionHash of the executions
+        std::vector<ResultExecute> result;
+        ByteCodeExecResult bcer;
+        dev::h256 stateRoot;               // Roots after the execution
+        dev::h256 utxoRoot;
+    };
+
+    void Clear();
+
+    void Add(dev::h256 const& stateRoot, dev::h256 const& utxoRoot, const uint256& txHash, uint32_t position, dev::h256 const& envHash, Entry entry);
+
+    /**
+     * Find the results of a transaction executed on the given roots, or nullptr
+     */
+    const Entry* Find(dev::h256 const& stateRoot, dev::h256 const& utxoRoot, const uint256& txHash, uint32_t position, dev::h256 const& envHash, dev::h256 const& execHash) const;
+
+    /**
+     * Keep the trie nodes the template's executions produced
+     */
+    void SetNodes(dev::OverlayDB stateNodes, dev::OverlayDB utxoNodes);
+
+    /**
+     * Make those trie nodes available to the given state before moving it to a cached root
+     */
+    void StageNodes(QtumState& state) const;
+
+private:
+    using Key = std::tuple<dev::h256, dev::h256, uint256, uint32_t, dev::h256>;
+
+    std::map<Key, Entry> m_entries;
+
+    dev::OverlayDB m_stateNodes;
+    dev::OverlayDB m_utxoNodes;
+};
+
+extern AssemblyExecCache g_assembly_exec_cache GUARDED_BY(::cs_main);
+
+/**
+ * Outpoints spent by the most recent blocks of a chainstate together with the
+ * coins they held, for the coinbase maturity window that stakes on forks may
+ * look back to. Filled when blocks are connected and emptied when they are
+ * disconnected, so a stake on a fork is checked without reading blocks.
+ */
+class SpentCoinJournal {
+public:
+    void Connect(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockundo, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Disconnect(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Find the coin of prevout if a block above nForkHeight up to the tip spent it.
+     * nScanHeight is set to the highest block the journal has no data for,
+     * blocks from there down to the fork still have to be read from disk.
+     */
+    bool Find(const CBlockIndex* pindexTip, const COutPoint& prevout, int nForkHeight, Coin& coin, int& nScanHeight) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct BlockSpends {
+        int height;
+        uint256 hash;
+        std::vector<COutPoint> spent;
+    };
+
+    void PopFront() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    std::deque<BlockSpends> m_blocks GUARDED_BY(m_mutex);            // Oldest first
+    std::unordered_map<COutPoint, std::pair<int, Coin>, SaltedOutpointHasher> m_coins GUARDED_BY(m_mutex);
+};
+
+/**
+ * Blocks of the active chain whose stakes are still immature for the next
+ * block, in a window that moves by one block on connect and disconnect.
+ * Readers get a snapshot of the stake prevouts and block times built once
+ * per tip and shared without holding cs_main.
+ */
+class ImmatureStakeTracker {
+public:
+    void Update(const CBlockIndex* pindexTip, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> GetSnapshot() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    mutable Mutex m_mutex;
+    std::deque<const CBlockIndex*> m_blocks GUARDED_BY(m_mutex);            // Oldest first, the tip last
+    size_t m_window GUARDED_BY(m_mutex){0};                                 // Blocks whose stakes are immature
+    mutable std::shared_ptr<const std::map<COutPoint, uint32_t>> m_snapshot GUARDED_BY(m_mutex);
+};
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -865,6 +997,9 @@ public:
     //! The cache size of the in-memory coins view.
     size_t m_coinstip_cache_size_bytes{0};
 
+    //! Coins spent by the recent blocks of m_chain, see GetSpentCoinFromMainChain
+    SpentCoinJournal m_spent_coin_journal;
+
     //! Resize the CoinsViews caches dynamically and flush state to disk.
     //! @returns true unless an error occurred during the flush.
     bool ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
@@ -1149,7 +1284,8 @@ private:
         const CBlockHeader& block,
         BlockValidationState& state,
         CBlockIndex** ppindex,
-        bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+        bool min_pow_checked,
+        const HeaderSigners* signers = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     friend Chainstate;
 
     /** Most recent headers presync progress update, for rate-limiting. */
@@ -1169,6 +1305,9 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! A queue for the signatures of received proof of stake headers.
+    CCheckQueue<HeaderSignatureCheck> m_header_check_queue;
+
     //! Timers and counters used for benchmarking validation in both background
     //! and active chainstates.
     SteadyClock::duration GUARDED_BY(::cs_main) time_check{};
@@ -1226,6 +1365,9 @@ public:
     //! chainstate to avoid duplicating block metadata.
     node::BlockManager m_blockman;
 
+    //! Stakes of the active chain that are not mature yet, read without cs_main.
+    ImmatureStakeTracker m_immature_stakes;
+
     ValidationCache m_validation_cache;
 
     /**
@@ -4,10 +4,12 @@
 
 #include <validators/delegation.h>
 #include <validators/validatordb.h>
+#include <arith_uint256.h>
 #include <hash.h>
 #include <logging.h>
 
 #include <algorithm>
+#include <utility>
 
 namespace validators {
 
@@ -112,6 +114,170 @@ bool RewardClaimRequest::Verify(const CPubKey& pubkey) const {
 DelegationDB::DelegationDB(const Consensus::Params& params)
     : consensusParams(params), currentHeight(0) {}
 
+void DelegationDB::TouchDelegation(const uint256& delegationId) {
+    AssertLockHeld(cs_delegations);
+    dirtyDelegations.insert(delegationId);
+    // Only block processing is journaled, changes made between blocks are not undone by a reorg
+    if (!journaling || journal.delegations.count(delegationId) > 0) {
+        return;
+    }
+    auto it = delegations.find(delegationId);
+    if (it == delegations.end()) {
+        journal.delegations.emplace(delegationId, std::nullopt);
+    } else {
+        journal.delegations.emplace(delegationId, it->second);
+    }
+}
+
+void DelegationDB::TouchRewardPool(const CKeyID& validatorId) {
+    AssertLockHeld(cs_delegations);
+    dirtyRewardPools.insert(validatorId);
+    if (!journaling || journal.rewardPools.count(validatorId) > 0) {
+        return;
+    }
+    auto it = rewardPools.find(validatorId);
+    if (it == rewardPools.end()) {
+        journal.rewardPools.emplace(validatorId, std::nullopt);
+    } else {
+        journal.rewardPools.emplace(validatorId, it->second);
+    }
+}
+
+void DelegationDB::RebuildIndexes() {
+    AssertLockHeld(cs_delegations);
+    delegatorIndex.clear();
+    validatorIndex.clear();
+    outpointIndex.clear();
+    for (const auto& [id, entry] : delegations) {
+        delegatorIndex[entry.delegatorId].push_back(id);
+        validatorIndex[entry.validatorId].push_back(id);
+        if (!entry.delegationOutpoint.IsNull()) {
+            outpointIndex[entry.delegationOutpoint] = id;
+        }
+    }
+}
+
+void DelegationDB::Load(std::map<uint256, DelegationEntry> entries, std::map<CKeyID, ValidatorRewardPool> pools) {
+    LOCK(cs_delegations);
+    delegations = std::move(entries);
+    rewardPools = std::move(pools);
+    RebuildIndexes();
+    journal = {};
+    dirtyDelegations.clear();
+    dirtyRewardPools.clear();
+}
+
+void DelegationDB::Restore(const DelegationChanges& prior) {
+    LOCK(cs_delegations);
+    for (const auto& [id, entry] : prior.delegations) {
+        dirtyDelegations.insert(id);
+        auto it = delegations.find(id);
+        if (it != delegations.end()) {
+            std::erase(delegatorIndex[it->second.delegatorId], id);
+            std::erase(validatorIndex[it->second.validatorId], id);
+            if (!it->second.delegationOutpoint.IsNull()) {
+                outpointIndex.erase(it->second.delegationOutpoint);
+            }
+            delegations.erase(it);
+        }
+        if (entry) {
+            delegations[id] = *entry;
+            delegatorIndex[entry->delegatorId].push_back(id);
+            validatorIndex[entry->validatorId].push_back(id);
+            if (!entry->delegationOutpoint.IsNull()) {
+                outpointIndex[entry->delegationOutpoint] = id;
+            }
+        }
+    }
+    for (const auto& [id, pool] : prior.rewardPools) {
+        dirtyRewardPools.insert(id);
+        if (pool) {
+            rewardPools[id] = *pool;
+        } else {
+            rewardPools.erase(id);
+        }
+    }
+}
+
+DelegationChanges DelegationDB::TakeDirty() {
+    LOCK(cs_delegations);
+    DelegationChanges result;
+    for (const uint256& id : dirtyDelegations) {
+        auto it = delegations.find(id);
+        if (it == delegations.end()) {
+            result.delegations.emplace(id, std::nullopt);
+        } else {
+            result.delegations.emplace(id, it->second);
+        }
+    }
+    for (const CKeyID& id : dirtyRewardPools) {
+        auto it = rewardPools.find(id);
+        if (it == rewardPools.end()) {
+            result.rewardPools.emplace(id, std::nullopt);
+        } else {
+            result.rewardPools.emplace(id, it->second);
+        }
+    }
+    dirtyDelegations.clear();
+    dirtyRewardPools.clear();
+    return result;
+}
+
+CAmount DelegationDB::AccruedRewards(const DelegationEntry& entry) const {
+    AssertLockHeld(cs_delegations);
+    if (entry.status != DelegationStatus::ACTIVE) {
+        return 0;
+    }
+
+    auto it = rewardPools.find(entry.validatorId);
+    if (it == rewardPools.end()) {
+        return 0;
+    }
+
+    arith_uint256 delta = UintToArith256(it->second.rewardPerShare) - UintToArith256(entry.rewardCheckpoint);
+    if (delta == 0) {
+        return 0;
+    }
+    delta *= static_cast<uint64_t>(entry.amount);
+    delta >>= REWARD_PER_SHARE_BITS;
+    return static_cast<CAmount>(delta.GetLow64());
+}
+
+void DelegationDB::SettleRewards(DelegationEntry& entry) {
+    AssertLockHeld(cs_delegations);
+    if (entry.status != DelegationStatus::ACTIVE) {
+        return;
+    }
+    auto it = rewardPools.find(entry.validatorId);
+    if (it == rewardPools.end()) {
+        return;
+    }
+    entry.pendingRewards += AccruedRewards(entry);
+    entry.rewardCheckpoint = it->second.rewardPerShare;
+}
+
+void DelegationDB::UpdateStatus(DelegationEntry& entry, DelegationStatus status) {
+    AssertLockHeld(cs_delegations);
+    if (entry.status == status) {
+        return;
+    }
+
+    if (entry.status == DelegationStatus::ACTIVE) {
+        // Leaving the active set: lock in everything earned so far
+        TouchRewardPool(entry.validatorId);
+        SettleRewards(entry);
+        rewardPools[entry.validatorId].totalActive -= entry.amount;
+    } else if (status == DelegationStatus::ACTIVE) {
+        // Joining the active set: start earning from the current accumulator
+        TouchRewardPool(entry.validatorId);
+        ValidatorRewardPool& pool = rewardPools[entry.validatorId];
+        pool.totalActive += entry.amount;
+        entry.rewardCheckpoint = pool.rewardPerShare;
+    }
+
+    entry.status = status;
+}
+
 bool DelegationDB::ProcessDelegation(const DelegationRequest& request, const COutPoint& outpoint) {
     LOCK(cs_delegations);
 
@@ -164,6 +330,7 @@ bool DelegationDB::ProcessDelegation(const DelegationRequest& request, const COu
     }
 
     // Add to database
+    TouchDelegation(delegationId);
     delegations[delegationId] = entry;
 
     // Update indexes
@@ -222,7 +389,8 @@ bool DelegationDB::ProcessUndelegation(const UndelegationRequest& request) {
         }
 
         // Start unbonding
-        entry.status = DelegationStatus::UNBONDING;
+        TouchDelegation(delegationId);
+        UpdateStatus(entry, DelegationStatus::UNBONDING);
         entry.unbondingStartHeight = currentHeight;
 
         // Update validator's delegated amount
@@ -264,6 +432,8 @@ CAmount DelegationDB::ProcessRewardClaim(const RewardClaimRequest& request) {
         }
 
         // Claim pending rewards
+        TouchDelegation(delegationId);
+        SettleRewards(entry);
         if (entry.pendingRewards > 0) {
             totalClaimed += entry.pendingRewards;
             entry.pendingRewards = 0;
@@ -314,6 +484,7 @@ std::vector<DelegationEntry> DelegationDB::GetDelegationsForDelegator(const CKey
         auto delIt = delegations.find(delegationId);
         if (delIt != delegations.end()) {
             result.push_back(delIt->second);
+            result.back().pendingRewards += AccruedRewards(delIt->second);
         }
     }
 
@@ -333,6 +504,7 @@ std::vector<DelegationEntry> DelegationDB::GetDelegationsForValidator(const CKey
         auto delIt = delegations.find(delegationId);
         if (delIt != delegations.end()) {
             result.push_back(delIt->second);
+            result.back().pendingRewards += AccruedRewards(delIt->second);
         }
     }
 
@@ -341,21 +513,11 @@ std::vector<DelegationEntry> DelegationDB::GetDelegationsForValidator(const CKey
 
 CAmount DelegationDB::GetTotalDelegationForValidator(const CKeyID& validatorId) const {
     LOCK(cs_delegations);
-    CAmount total = 0;
-
-    auto it = validatorIndex.find(validatorId);
-    if (it == validatorIndex.end()) {
-        return total;
-    }
-
-    for (const auto& delegationId : it->second) {
-        auto delIt = delegations.find(delegationId);
-        if (delIt != delegations.end() && delIt->second.status == DelegationStatus::ACTIVE) {
-            total += delIt->second.amount;
-        }
+    auto it = rewardPools.find(validatorId);
+    if (it == rewardPools.end()) {
+        return 0;
     }
-
-    return total;
+    return it->second.totalActive;
 }
 
 CAmount DelegationDB::GetPendingRewardsForDelegator(const CKeyID& delegatorId) const {
@@ -370,7 +532,7 @@ CAmount DelegationDB::GetPendingRewardsForDelegator(const CKeyID& delegatorId) c
     for (const auto& delegationId : it->second) {
         auto delIt = delegations.find(delegationId);
         if (delIt != delegations.end()) {
-            total += delIt->second.pendingRewards;
+            total += delIt->second.pendingRewards + AccruedRewards(delIt->second);
         }
     }
 
@@ -383,6 +545,7 @@ bool DelegationDB::AddRewards(const uint256& delegationId, CAmount rewards) {
     if (it == delegations.end()) {
         return false;
     }
+    TouchDelegation(delegationId);
     it->second.pendingRewards += rewards;
     return true;
 }
@@ -394,31 +557,23 @@ bool DelegationDB::DistributeBlockReward(const CKeyID& validatorId, CAmount dele
         return true;
     }
 
-    // Get total active delegation for this validator
-    CAmount totalDelegation = GetTotalDelegationForValidator(validatorId);
-    if (totalDelegation == 0) {
-        return true;
-    }
-
-    // Distribute proportionally to each delegator
-    auto it = validatorIndex.find(validatorId);
-    if (it == validatorIndex.end()) {
+    // Nothing to credit without active delegations for this validator
+    auto it = rewardPools.find(validatorId);
+    if (it == rewardPools.end() || it->second.totalActive == 0) {
         return true;
     }
 
-    for (const auto& delegationId : it->second) {
-        auto delIt = delegations.find(delegationId);
-        if (delIt == delegations.end()) continue;
+    TouchRewardPool(validatorId);
+    ValidatorRewardPool& pool = it->second;
 
-        DelegationEntry& entry = delIt->second;
-        if (entry.status != DelegationStatus::ACTIVE) continue;
-
-        // Calculate proportional share
-        CAmount share = (delegatorsShare * entry.amount) / totalDelegation;
-        if (share > 0) {
-            entry.pendingRewards += share;
-        }
-    }
+    // Round the per-share increment up so that a delegation settled after a single
+    // block receives exactly (delegatorsShare * amount) / totalActive, as when the
+    // split was computed per delegator.
+    const arith_uint256 total{static_cast<uint64_t>(pool.totalActive)};
+    arith_uint256 increment = arith_uint256{static_cast<uint64_t>(delegatorsShare)} << REWARD_PER_SHARE_BITS;
+    increment += total - 1;
+    increment /= total;
+    pool.rewardPerShare = ArithToUint256(UintToArith256(pool.rewardPerShare) + increment);
 
     LogPrintf("DelegationDB: Distributed %lld to delegators of validator %s\n",
               delegatorsShare, validatorId.ToString());
@@ -432,7 +587,8 @@ bool DelegationDB::SetDelegationStatus(const uint256& delegationId, DelegationSt
     if (it == delegations.end()) {
         return false;
     }
-    it->second.status = status;
+    TouchDelegation(delegationId);
+    UpdateStatus(it->second, status);
     return true;
 }
 
@@ -448,6 +604,8 @@ bool DelegationDB::UpdateDelegationOutpoint(const uint256& delegationId, const C
         return false;
     }
 
+    TouchDelegation(delegationId);
+
     // Remove old outpoint from index
     if (!it->second.delegationOutpoint.IsNull()) {
         outpointIndex.erase(it->second.delegationOutpoint);
@@ -464,15 +622,17 @@ bool DelegationDB::UpdateDelegationOutpoint(const uint256& delegationId, const C
     return true;
 }
 
-void DelegationDB::ProcessBlock(int height) {
+DelegationChanges DelegationDB::ProcessBlock(int height) {
     LOCK(cs_delegations);
     currentHeight = height;
+    journaling = true;
 
     for (auto& [id, entry] : delegations) {
         // Activate pending delegations after maturity
         if (entry.status == DelegationStatus::PENDING) {
             if (height - entry.delegationHeight >= DELEGATION_MATURITY) {
-                entry.status = DelegationStatus::ACTIVE;
+                TouchDelegation(id);
+                UpdateStatus(entry, DelegationStatus::ACTIVE);
                 LogPrintf("DelegationDB: Delegation %s is now active\n",
                           id.ToString().substr(0, 16));
             }
@@ -481,12 +641,16 @@ void DelegationDB::ProcessBlock(int height) {
         // Complete unbonding
         if (entry.status == DelegationStatus::UNBONDING) {
             if (height - entry.unbondingStartHeight >= DELEGATION_UNBONDING_PERIOD) {
-                entry.status = DelegationStatus::WITHDRAWN;
+                TouchDelegation(id);
+                UpdateStatus(entry, DelegationStatus::WITHDRAWN);
                 LogPrintf("DelegationDB: Delegation %s unbonding complete\n",
                           id.ToString().substr(0, 16));
             }
         }
     }
+
+    journaling = false;
+    return std::exchange(journal, {});
 }
 
 size_t DelegationDB::GetActiveDelegationCount() const {
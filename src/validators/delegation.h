@@ -16,6 +16,8 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <vector>
 
 namespace validators {
@@ -48,7 +50,8 @@ public:
     DelegationStatus status;      // Current delegation status
     COutPoint delegationOutpoint; // UTXO holding the delegated stake
     int unbondingStartHeight;     // Height when unbonding started
-    CAmount pendingRewards;       // Accumulated unclaimed rewards
+    CAmount pendingRewards;       // Settled, unclaimed rewards
+    uint256 rewardCheckpoint;     // Validator reward-per-share at last settlement
 
     DelegationEntry() : amount(0), delegationHeight(0), lastRewardHeight(0),
                         status(DelegationStatus::PENDING), unbondingStartHeight(0),
@@ -59,7 +62,7 @@ public:
                   obj.delegationHeight, obj.lastRewardHeight,
                   Using<CustomUintFormatter<1>>(obj.status),
                   obj.delegationOutpoint, obj.unbondingStartHeight,
-                  obj.pendingRewards);
+                  obj.pendingRewards, obj.rewardCheckpoint);
     }
 
     /**
@@ -174,6 +177,42 @@ public:
     bool Verify(const CPubKey& pubkey) const;
 };
 
+/**
+ * Per-validator reward accumulator
+ *
+ * Every credited block adds ceil((delegatorsShare << REWARD_PER_SHARE_BITS) / totalActive)
+ * to rewardPerShare, so the reward accrued by an active delegation since its last
+ * settlement is (amount * (rewardPerShare - rewardCheckpoint)) >> REWARD_PER_SHARE_BITS.
+ * Crediting a block is O(1) regardless of the number of delegators.
+ *
+ * After one block a delegation holds exactly (delegatorsShare * amount) / totalActive.
+ * Over n blocks the rounding is only applied once, so it holds at least the sum of
+ * the per-block splits and less than n satoshis more. All delegations together never
+ * hold more than was credited.
+ */
+class ValidatorRewardPool {
+public:
+    CAmount totalActive;          // Sum of ACTIVE delegation amounts
+    uint256 rewardPerShare;       // Fixed-point cumulative reward per delegated satoshi
+
+    ValidatorRewardPool() : totalActive(0) {}
+
+    SERIALIZE_METHODS(ValidatorRewardPool, obj) {
+        READWRITE(obj.totalActive, obj.rewardPerShare);
+    }
+};
+
+/**
+ * A set of delegation and reward pool states, keyed like DelegationDB.
+ * std::nullopt marks an entry that does not exist.
+ */
+struct DelegationChanges {
+    std::map<uint256, std::optional<DelegationEntry>> delegations;
+    std::map<CKeyID, std::optional<ValidatorRewardPool>> rewardPools;
+
+    bool empty() const { return delegations.empty() && rewardPools.empty(); }
+};
+
 /**
  * Delegation database manager
  * Handles delegation, undelegation, and reward distribution
@@ -194,9 +233,50 @@ private:
     // Index: outpoint -> delegation ID
     std::map<COutPoint, uint256> outpointIndex;
 
+    // Reward accumulators indexed by validator
+    std::map<CKeyID, ValidatorRewardPool> rewardPools;
+
     const Consensus::Params& consensusParams;
     int currentHeight;
 
+    // Prior state of entries modified by the block being processed
+    DelegationChanges journal;
+    bool journaling{false};
+
+    // Entries modified since the last flush to disk
+    std::set<uint256> dirtyDelegations;
+    std::set<CKeyID> dirtyRewardPools;
+
+    /**
+     * Record a delegation as about to be modified
+     */
+    void TouchDelegation(const uint256& delegationId) EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
+    /**
+     * Record a validator's reward pool as about to be modified
+     */
+    void TouchRewardPool(const CKeyID& validatorId) EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
+    /**
+     * Rebuild delegator, validator and outpoint indexes from delegations
+     */
+    void RebuildIndexes() EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
+    /**
+     * Rewards accrued by an entry since its last settlement
+     */
+    CAmount AccruedRewards(const DelegationEntry& entry) const EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
+    /**
+     * Move accrued rewards into pendingRewards and advance the checkpoint
+     */
+    void SettleRewards(DelegationEntry& entry) EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
+    /**
+     * Change status, keeping the validator's reward pool in step
+     */
+    void UpdateStatus(DelegationEntry& entry, DelegationStatus status) EXCLUSIVE_LOCKS_REQUIRED(cs_delegations);
+
 public:
     explicit DelegationDB(const Consensus::Params& params);
 
@@ -278,8 +358,9 @@ public:
 
     /**
      * Process block (handle unbonding completions, etc.)
+     * Returns the prior state of the entries the block modified
      */
-    void ProcessBlock(int height);
+    DelegationChanges ProcessBlock(int height);
 
     /**
      * Get count of active delegations
@@ -291,6 +372,21 @@ public:
      */
     size_t GetDelegatorCountForValidator(const CKeyID& validatorId) const;
 
+    /**
+     * Replace the contents with entries loaded from disk
+     */
+    void Load(std::map<uint256, DelegationEntry> entries, std::map<CKeyID, ValidatorRewardPool> pools);
+
+    /**
+     * Restore entries to a prior state previously returned by ProcessBlock
+     */
+    void Restore(const DelegationChanges& prior);
+
+    /**
+     * Take the current state of every entry modified since the last flush
+     */
+    DelegationChanges TakeDirty();
+
     /**
      * Serialize delegations to stream (for persistence)
      */
@@ -298,6 +394,7 @@ public:
     void Serialize(Stream& s) const {
         LOCK(cs_delegations);
         s << delegations;
+        s << rewardPools;
     }
 
     /**
@@ -307,21 +404,13 @@ public:
     void Unserialize(Stream& s) {
         LOCK(cs_delegations);
         s >> delegations;
-        // Rebuild indexes
-        delegatorIndex.clear();
-        validatorIndex.clear();
-        outpointIndex.clear();
-        for (const auto& [id, entry] : delegations) {
-            delegatorIndex[entry.delegatorId].push_back(id);
-            validatorIndex[entry.validatorId].push_back(id);
-            if (!entry.delegationOutpoint.IsNull()) {
-                outpointIndex[entry.delegationOutpoint] = id;
-            }
-        }
+        s >> rewardPools;
+        RebuildIndexes();
     }
 };
 
 // Constants
+static constexpr unsigned int REWARD_PER_SHARE_BITS = 128;         // Fixed-point precision of rewardPerShare
 static constexpr CAmount MIN_DELEGATION_AMOUNT = 1000LL * 100000000LL; // 1,000 WATTx minimum
 static constexpr int DELEGATION_MATURITY = 500;                    // 500 blocks maturity
 static constexpr int DELEGATION_UNBONDING_PERIOD = 259200;         // ~3 days at 1s blocks
@@ -7,6 +7,7 @@
 #include <logging.h>
 
 #include <algorithm>
+#include <utility>
 
 namespace validators {
 
@@ -128,6 +129,69 @@ bool ValidatorUpdate::Verify(const CPubKey& pubkey) const {
 ValidatorDB::ValidatorDB(const Consensus::Params& params)
     : consensusParams(params), currentHeight(0) {}
 
+void ValidatorDB::Touch(const CKeyID& validatorId) {
+    AssertLockHeld(cs_validators);
+    dirty.insert(validatorId);
+    // Only block processing is journaled, changes made between blocks are not undone by a reorg
+    if (!journaling || journal.count(validatorId) > 0) {
+        return;
+    }
+    auto it = validators.find(validatorId);
+    if (it == validators.end()) {
+        journal.emplace(validatorId, std::nullopt);
+    } else {
+        journal.emplace(validatorId, it->second);
+    }
+}
+
+void ValidatorDB::Load(std::map<CKeyID, ValidatorEntry> entries) {
+    LOCK(cs_validators);
+    validators = std::move(entries);
+    outpointIndex.clear();
+    for (const auto& [id, entry] : validators) {
+        if (!entry.stakeOutpoint.IsNull()) {
+            outpointIndex[entry.stakeOutpoint] = id;
+        }
+    }
+    journal.clear();
+    dirty.clear();
+}
+
+void ValidatorDB::Restore(const std::map<CKeyID, std::optional<ValidatorEntry>>& prior) {
+    LOCK(cs_validators);
+    for (const auto& [id, entry] : prior) {
+        dirty.insert(id);
+        auto it = validators.find(id);
+        if (it != validators.end()) {
+            if (!it->second.stakeOutpoint.IsNull()) {
+                outpointIndex.erase(it->second.stakeOutpoint);
+            }
+            validators.erase(it);
+        }
+        if (entry) {
+            validators[id] = *entry;
+            if (!entry->stakeOutpoint.IsNull()) {
+                outpointIndex[entry->stakeOutpoint] = id;
+            }
+        }
+    }
+}
+
+std::map<CKeyID, std::optional<ValidatorEntry>> ValidatorDB::TakeDirty() {
+    LOCK(cs_validators);
+    std::map<CKeyID, std::optional<ValidatorEntry>> result;
+    for (const CKeyID& id : dirty) {
+        auto it = validators.find(id);
+        if (it == validators.end()) {
+            result.emplace(id, std::nullopt);
+        } else {
+            result.emplace(id, it->second);
+        }
+    }
+    dirty.clear();
+    return result;
+}
+
 bool ValidatorDB::RegisterValidator(const ValidatorEntry& entry) {
     LOCK(cs_validators);
 
@@ -159,6 +223,7 @@ bool ValidatorDB::RegisterValidator(const ValidatorEntry& entry) {
     }
 
     // Add to database
+    Touch(entry.validatorId);
     validators[entry.validatorId] = entry;
 
     // Add to outpoint index
@@ -190,6 +255,8 @@ bool ValidatorDB::ProcessUpdate(const ValidatorUpdate& update) {
         return false;
     }
 
+    Touch(update.validatorId);
+
     switch (update.updateType) {
         case ValidatorUpdateType::UPDATE_FEE:
             if (update.newValue < MIN_POOL_FEE || update.newValue > MAX_POOL_FEE) {
@@ -263,6 +330,8 @@ bool ValidatorDB::UpdateStakeOutpoint(const CKeyID& validatorId, const COutPoint
         return false;
     }
 
+    Touch(validatorId);
+
     // Remove old outpoint from index
     if (!it->second.stakeOutpoint.IsNull()) {
         outpointIndex.erase(it->second.stakeOutpoint);
@@ -288,6 +357,16 @@ const ValidatorEntry* ValidatorDB::GetValidator(const CKeyID& validatorId) const
     return &it->second;
 }
 
+bool ValidatorDB::GetValidatorPubKey(const CKeyID& validatorId, CPubKey& pubkey) const {
+    LOCK(cs_validators);
+    auto it = validators.find(validatorId);
+    if (it == validators.end()) {
+        return false;
+    }
+    pubkey = it->second.validatorPubKey;
+    return true;
+}
+
 const ValidatorEntry* ValidatorDB::GetValidatorByOutpoint(const COutPoint& outpoint) const {
     LOCK(cs_validators);
     auto it = outpointIndex.find(outpoint);
@@ -353,6 +432,7 @@ bool ValidatorDB::SetValidatorStatus(const CKeyID& validatorId, ValidatorStatus
     if (it == validators.end()) {
         return false;
     }
+    Touch(validatorId);
     it->second.status = status;
     if (status == ValidatorStatus::ACTIVE) {
         it->second.lastActiveHeight = currentHeight;
@@ -366,6 +446,7 @@ bool ValidatorDB::JailValidator(const CKeyID& validatorId, int jailBlocks) {
     if (it == validators.end()) {
         return false;
     }
+    Touch(validatorId);
     it->second.status = ValidatorStatus::JAILED;
     it->second.jailReleaseHeight = currentHeight + jailBlocks;
     LogPrintf("ValidatorDB: Jailed validator %s until height %d\n",
@@ -387,6 +468,7 @@ bool ValidatorDB::UnjailValidator(const CKeyID& validatorId) {
                   validatorId.ToString(), it->second.jailReleaseHeight, currentHeight);
         return false;
     }
+    Touch(validatorId);
     it->second.status = ValidatorStatus::ACTIVE;
     it->second.jailReleaseHeight = 0;
     LogPrintf("ValidatorDB: Unjailed validator %s\n", validatorId.ToString());
@@ -415,6 +497,7 @@ bool ValidatorDB::AddDelegation(const CKeyID& validatorId, CAmount amount) {
     if (it == validators.end()) {
         return false;
     }
+    Touch(validatorId);
     it->second.totalDelegated += amount;
     it->second.delegatorCount++;
     LogPrintf("ValidatorDB: Added delegation of %lld to validator %s (total: %lld, delegators: %d)\n",
@@ -431,6 +514,7 @@ bool ValidatorDB::RemoveDelegation(const CKeyID& validatorId, CAmount amount) {
     if (amount > it->second.totalDelegated) {
         return false;
     }
+    Touch(validatorId);
     it->second.totalDelegated -= amount;
     if (it->second.delegatorCount > 0) {
         it->second.delegatorCount--;
@@ -440,15 +524,17 @@ bool ValidatorDB::RemoveDelegation(const CKeyID& validatorId, CAmount amount) {
     return true;
 }
 
-void ValidatorDB::ProcessBlock(int height) {
+std::map<CKeyID, std::optional<ValidatorEntry>> ValidatorDB::ProcessBlock(int height) {
     LOCK(cs_validators);
     currentHeight = height;
+    journaling = true;
 
     // Process unbonding validators
     for (auto& [id, entry] : validators) {
         // Check if unbonding period is complete
         if (entry.status == ValidatorStatus::UNBONDING) {
             if (height - entry.lastActiveHeight >= UNBONDING_PERIOD) {
+                Touch(id);
                 entry.status = ValidatorStatus::INACTIVE;
                 LogPrintf("ValidatorDB: Validator %s unbonding complete, now inactive\n",
                           id.ToString());
@@ -463,6 +549,9 @@ void ValidatorDB::ProcessBlock(int height) {
                       id.ToString());
         }
     }
+
+    journaling = false;
+    return std::exchange(journal, {});
 }
 
 } // namespace validators
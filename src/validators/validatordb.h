@@ -15,6 +15,8 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
+#include <set>
 #include <string>
 #include <vector>
 #include <memory>
@@ -156,6 +158,18 @@ private:
     // Index by stake outpoint for quick lookup
     std::map<COutPoint, CKeyID> outpointIndex;
 
+    // Prior state of validators modified by the block being processed
+    std::map<CKeyID, std::optional<ValidatorEntry>> journal;
+    bool journaling{false};
+
+    // Validators modified since the last flush to disk
+    std::set<CKeyID> dirty;
+
+    /**
+     * Record a validator as about to be modified
+     */
+    void Touch(const CKeyID& validatorId) EXCLUSIVE_LOCKS_REQUIRED(cs_validators);
+
 public:
     explicit ValidatorDB(const Consensus::Params& params);
 
@@ -179,6 +193,11 @@ public:
      */
     const ValidatorEntry* GetValidator(const CKeyID& validatorId) const;
 
+    /**
+     * Get a validator's public key, safe to call while blocks are connected
+     */
+    bool GetValidatorPubKey(const CKeyID& validatorId, CPubKey& pubkey) const;
+
     /**
      * Get validator by stake outpoint
      */
@@ -246,8 +265,26 @@ public:
 
     /**
      * Process block (update heights, check jails, etc.)
+     * Returns the prior state of the validators the block modified
+     * (std::nullopt for validators that did not exist)
+     */
+    std::map<CKeyID, std::optional<ValidatorEntry>> ProcessBlock(int height);
+
+    /**
+     * Replace the contents with entries loaded from disk
+     */
+    void Load(std::map<CKeyID, ValidatorEntry> entries);
+
+    /**
+     * Restore validators to a prior state previously returned by ProcessBlock
+     */
+    void Restore(const std::map<CKeyID, std::optional<ValidatorEntry>>& prior);
+
+    /**
+     * Take the current state of every validator modified since the last flush
+     * (std::nullopt for validators that no longer exist)
      */
-    void ProcessBlock(int height);
+    std::map<CKeyID, std::optional<ValidatorEntry>> TakeDirty();
 
     /**
      * Serialize validators to stream (for persistence)
@@ -0,0 +1,393 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <validators/validatorstore.h>
+
+#include <chain.h>
+#include <common/args.h>
+#include <logging.h>
+#include <node/database_args.h>
+#include <validation.h>
+
+namespace validators {
+
+static constexpr uint8_t DB_VALIDATOR{'v'};
+static constexpr uint8_t DB_DELEGATION{'d'};
+static constexpr uint8_t DB_REWARD_POOL{'p'};
+static constexpr uint8_t DB_UNDO{'u'};
+static constexpr uint8_t DB_BEST_BLOCK{'B'};
+
+// Global instance
+std::unique_ptr<ValidatorStore> g_validator_store;
+
+// ValidatorBlockUndo implementation
+
+ValidatorBlockUndo ValidatorBlockUndo::FromJournals(const uint256& blockHash,
+                                                    const std::map<CKeyID, std::optional<ValidatorEntry>>& validatorJournal,
+                                                    const DelegationChanges& delegationJournal) {
+    ValidatorBlockUndo undo;
+    undo.blockHash = blockHash;
+    undo.Merge(validatorJournal, delegationJournal);
+    return undo;
+}
+
+void ValidatorBlockUndo::Merge(const std::map<CKeyID, std::optional<ValidatorEntry>>& validatorJournal,
+                               const DelegationChanges& delegationJournal) {
+    std::map<CKeyID, std::optional<ValidatorEntry>> validatorChanges = GetValidatorChanges();
+    DelegationChanges delegationChanges = GetDelegationChanges();
+
+    // map::insert keeps the prior state already recorded
+    validatorChanges.insert(validatorJournal.begin(), validatorJournal.end());
+    delegationChanges.delegations.insert(delegationJournal.delegations.begin(), delegationJournal.delegations.end());
+    delegationChanges.rewardPools.insert(delegationJournal.rewardPools.begin(), delegationJournal.rewardPools.end());
+
+    validators.clear();
+    createdValidators.clear();
+    for (const auto& [id, entry] : validatorChanges) {
+        if (entry) {
+            validators.push_back(*entry);
+        } else {
+            createdValidators.push_back(id);
+        }
+    }
+
+    delegations.clear();
+    createdDelegations.clear();
+    for (const auto& [id, entry] : delegationChanges.delegations) {
+        if (entry) {
+            delegations.emplace_back(id, *entry);
+        } else {
+            createdDelegations.push_back(id);
+        }
+    }
+
+    rewardPools.clear();
+    createdRewardPools.clear();
+    for (const auto& [id, pool] : delegationChanges.rewardPools) {
+        if (pool) {
+            rewardPools.emplace_back(id, *pool);
+        } else {
+            createdRewardPools.push_back(id);
+        }
+    }
+}
+
+std::map<CKeyID, std::optional<ValidatorEntry>> ValidatorBlockUndo::GetValidatorChanges() const {
+    std::map<CKeyID, std::optional<ValidatorEntry>> changes;
+    for (const auto& entry : validators) {
+        changes.emplace(entry.validatorId, entry);
+    }
+    for (const auto& id : createdValidators) {
+        changes.emplace(id, std::nullopt);
+    }
+    return changes;
+}
+
+DelegationChanges ValidatorBlockUndo::GetDelegationChanges() const {
+    DelegationChanges changes;
+    for (const auto& [id, entry] : delegations) {
+        changes.delegations.emplace(id, entry);
+    }
+    for (const auto& id : createdDelegations) {
+        changes.delegations.emplace(id, std::nullopt);
+    }
+    for (const auto& [id, pool] : rewardPools) {
+        changes.rewardPools.emplace(id, pool);
+    }
+    for (const auto& id : createdRewardPools) {
+        changes.rewardPools.emplace(id, std::nullopt);
+    }
+    return changes;
+}
+
+// ValidatorStore implementation
+
+ValidatorStore::ValidatorStore(DBParams params)
+    : m_db(params) {}
+
+std::optional<ValidatorBlockUndo> ValidatorStore::ReadUndo(int height) const {
+    AssertLockHeld(cs_store);
+    if (m_erased_undo.count(height) > 0) {
+        return std::nullopt;
+    }
+    ValidatorBlockUndo undo;
+    if (!m_db.Read(std::make_pair(DB_UNDO, height), undo)) {
+        return std::nullopt;
+    }
+    return undo;
+}
+
+bool ValidatorStore::Load(ValidatorDB& validatorDB, DelegationDB& delegationDB) {
+    std::map<CKeyID, ValidatorEntry> validators;
+    std::map<uint256, DelegationEntry> delegations;
+    std::map<CKeyID, ValidatorRewardPool> rewardPools;
+
+    std::unique_ptr<CDBIterator> pcursor(m_db.NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_VALIDATOR, CKeyID()));
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CKeyID> key;
+        if (!pcursor->GetKey(key) || key.first != DB_VALIDATOR) break;
+        ValidatorEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            LogPrintf("ValidatorStore: Failed to read validator %s\n", key.second.ToString());
+            return false;
+        }
+        validators.emplace(key.second, std::move(entry));
+        pcursor->Next();
+    }
+
+    pcursor->Seek(std::make_pair(DB_DELEGATION, uint256()));
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_DELEGATION) break;
+        DelegationEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            LogPrintf("ValidatorStore: Failed to read delegation %s\n", key.second.ToString());
+            return false;
+        }
+        delegations.emplace(key.second, std::move(entry));
+        pcursor->Next();
+    }
+
+    pcursor->Seek(std::make_pair(DB_REWARD_POOL, CKeyID()));
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CKeyID> key;
+        if (!pcursor->GetKey(key) || key.first != DB_REWARD_POOL) break;
+        ValidatorRewardPool pool;
+        if (!pcursor->GetValue(pool)) {
+            LogPrintf("ValidatorStore: Failed to read reward pool %s\n", key.second.ToString());
+            return false;
+        }
+        rewardPools.emplace(key.second, std::move(pool));
+        pcursor->Next();
+    }
+
+    LogPrintf("ValidatorStore: Loaded %u validators, %u delegations\n",
+              validators.size(), delegations.size());
+
+    validatorDB.Load(std::move(validators));
+    delegationDB.Load(std::move(delegations), std::move(rewardPools));
+
+    LOCK(cs_store);
+    m_db.Read(DB_BEST_BLOCK, m_best_block);
+    return true;
+}
+
+uint256 ValidatorStore::GetBestBlock() const {
+    LOCK(cs_store);
+    return m_best_block;
+}
+
+bool ValidatorStore::Sync(ValidatorDB& validatorDB, DelegationDB& delegationDB, ChainstateManager& chainman) {
+    AssertLockHeld(::cs_main);
+    const CChain& chain = chainman.ActiveChain();
+    const CBlockIndex* tip = chain.Tip();
+    if (!tip) {
+        return true;
+    }
+
+    const uint256 bestBlock = GetBestBlock();
+    if (bestBlock.IsNull()) {
+        // A new store starts from the current tip
+        LOCK(cs_store);
+        m_best_block = tip->GetBlockHash();
+        m_best_height = tip->nHeight;
+        m_pruned_height = tip->nHeight - VALIDATOR_UNDO_DEPTH;
+        validatorDB.SetHeight(tip->nHeight);
+        delegationDB.SetHeight(tip->nHeight);
+        return true;
+    }
+
+    const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(bestBlock);
+    if (!pindex) {
+        LogError("ValidatorStore: Best block %s not found in the block index\n", bestBlock.ToString());
+        return false;
+    }
+
+    {
+        LOCK(cs_store);
+        m_best_height = pindex->nHeight;
+        m_pruned_height = pindex->nHeight - VALIDATOR_UNDO_DEPTH;
+    }
+    validatorDB.SetHeight(pindex->nHeight);
+    delegationDB.SetHeight(pindex->nHeight);
+
+    // Roll back blocks that are no longer in the active chain
+    while (!chain.Contains(pindex)) {
+        if (!DisconnectBlock(validatorDB, delegationDB, *pindex)) {
+            LogError("ValidatorStore: Cannot roll back block %s at height %d to the active chain\n",
+                     pindex->GetBlockHash().ToString(), pindex->nHeight);
+            return false;
+        }
+        pindex = pindex->pprev;
+    }
+
+    // Per-block processing only depends on height, so catching up needs no block data
+    int caughtUp = 0;
+    for (const CBlockIndex* next = chain.Next(pindex); next; next = chain.Next(next)) {
+        ConnectBlock(validatorDB, delegationDB, *next);
+        ++caughtUp;
+    }
+    if (caughtUp > 0) {
+        LogPrintf("ValidatorStore: Caught up %d blocks to height %d\n", caughtUp, tip->nHeight);
+    }
+    return true;
+}
+
+void ValidatorStore::ConnectBlock(ValidatorDB& validatorDB, DelegationDB& delegationDB, const CBlockIndex& block) {
+    // Only what the block itself changes is undone by a reorg, registrations and
+    // delegations made through the wallet between blocks are local state
+    std::map<CKeyID, std::optional<ValidatorEntry>> validatorJournal = validatorDB.ProcessBlock(block.nHeight);
+    DelegationChanges delegationJournal = delegationDB.ProcessBlock(block.nHeight);
+
+    LOCK(cs_store);
+    m_pending_undo[block.nHeight] = ValidatorBlockUndo::FromJournals(block.GetBlockHash(),
+                                                                     validatorJournal,
+                                                                     delegationJournal);
+    m_erased_undo.erase(block.nHeight);
+    m_best_block = block.GetBlockHash();
+    m_best_height = block.nHeight;
+}
+
+bool ValidatorStore::DisconnectBlock(ValidatorDB& validatorDB, DelegationDB& delegationDB, const CBlockIndex& block) {
+    LOCK(cs_store);
+
+    std::optional<ValidatorBlockUndo> undo;
+    auto it = m_pending_undo.find(block.nHeight);
+    if (it != m_pending_undo.end()) {
+        undo = std::move(it->second);
+        m_pending_undo.erase(it);
+    } else {
+        undo = ReadUndo(block.nHeight);
+    }
+
+    if (!undo || undo->blockHash != block.GetBlockHash()) {
+        LogPrintf("ValidatorStore: No undo data for block %s at height %d\n",
+                  block.GetBlockHash().ToString(), block.nHeight);
+        return false;
+    }
+
+    validatorDB.Restore(undo->GetValidatorChanges());
+    delegationDB.Restore(undo->GetDelegationChanges());
+
+    m_erased_undo.insert(block.nHeight);
+    m_best_block = block.pprev ? block.pprev->GetBlockHash() : uint256();
+    m_best_height = block.nHeight - 1;
+    validatorDB.SetHeight(m_best_height);
+    delegationDB.SetHeight(m_best_height);
+    return true;
+}
+
+bool ValidatorStore::Flush(ValidatorDB& validatorDB, DelegationDB& delegationDB) {
+    LOCK(cs_store);
+    CDBBatch batch(m_db);
+
+    for (const auto& [id, entry] : validatorDB.TakeDirty()) {
+        if (entry) {
+            batch.Write(std::make_pair(DB_VALIDATOR, id), *entry);
+        } else {
+            batch.Erase(std::make_pair(DB_VALIDATOR, id));
+        }
+    }
+
+    const DelegationChanges dirty = delegationDB.TakeDirty();
+    for (const auto& [id, entry] : dirty.delegations) {
+        if (entry) {
+            batch.Write(std::make_pair(DB_DELEGATION, id), *entry);
+        } else {
+            batch.Erase(std::make_pair(DB_DELEGATION, id));
+        }
+    }
+    for (const auto& [id, pool] : dirty.rewardPools) {
+        if (pool) {
+            batch.Write(std::make_pair(DB_REWARD_POOL, id), *pool);
+        } else {
+            batch.Erase(std::make_pair(DB_REWARD_POOL, id));
+        }
+    }
+
+    for (const int height : m_erased_undo) {
+        batch.Erase(std::make_pair(DB_UNDO, height));
+    }
+    for (const auto& [height, undo] : m_pending_undo) {
+        batch.Write(std::make_pair(DB_UNDO, height), undo);
+    }
+
+    // Undo data deeper than VALIDATOR_UNDO_DEPTH is no longer needed
+    const int pruneHeight = m_best_height - VALIDATOR_UNDO_DEPTH;
+    for (int height = std::max(m_pruned_height + 1, 0); height <= pruneHeight; ++height) {
+        batch.Erase(std::make_pair(DB_UNDO, height));
+    }
+
+    batch.Write(DB_BEST_BLOCK, m_best_block);
+
+    if (!m_db.WriteBatch(batch, /*fSync=*/true)) {
+        return false;
+    }
+
+    m_pending_undo.clear();
+    m_erased_undo.clear();
+    m_pruned_height = std::max(m_pruned_height, pruneHeight);
+    return true;
+}
+
+bool InitValidatorStore(const fs::path& path) {
+    if (!g_validator_db || !g_delegation_db) {
+        return false;
+    }
+
+    try {
+        g_validator_store = std::make_unique<ValidatorStore>(DBParams{
+            .path = path,
+            .cache_bytes = VALIDATOR_STORE_CACHE_SIZE,
+            .options = [] { DBOptions options; node::ReadDatabaseArgs(gArgs, options); return options; }()});
+    } catch (const dbwrapper_error& e) {
+        LogPrintf("ValidatorStore: Failed to open database: %s\n", e.what());
+        return false;
+    }
+
+    if (!g_validator_store->Load(*g_validator_db, *g_delegation_db)) {
+        g_validator_store.reset();
+        return false;
+    }
+
+    LogPrintf("ValidatorStore: Opened validator store at %s\n", fs::PathToString(path));
+    return true;
+}
+
+bool SyncValidatorStore(ChainstateManager& chainman) {
+    AssertLockHeld(::cs_main);
+    if (g_validator_store && g_validator_db && g_delegation_db) {
+        return g_validator_store->Sync(*g_validator_db, *g_delegation_db, chainman);
+    }
+    return true;
+}
+
+void ShutdownValidatorStore() {
+    g_validator_store.reset();
+    LogPrintf("ValidatorStore: Shut down validator store\n");
+}
+
+void ConnectValidatorBlock(const CBlockIndex& block) {
+    if (g_validator_store && g_validator_db && g_delegation_db) {
+        g_validator_store->ConnectBlock(*g_validator_db, *g_delegation_db, block);
+    }
+}
+
+bool DisconnectValidatorBlock(const CBlockIndex& block) {
+    if (g_validator_store && g_validator_db && g_delegation_db) {
+        return g_validator_store->DisconnectBlock(*g_validator_db, *g_delegation_db, block);
+    }
+    return true;
+}
+
+bool FlushValidatorStore() {
+    if (g_validator_store && g_validator_db && g_delegation_db) {
+        return g_validator_store->Flush(*g_validator_db, *g_delegation_db);
+    }
+    return true;
+}
+
+} // namespace validators
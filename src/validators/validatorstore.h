@@ -0,0 +1,168 @@
+// Copyright (c) 2024 The WATTx Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WATTX_VALIDATORS_VALIDATORSTORE_H
+#define WATTX_VALIDATORS_VALIDATORSTORE_H
+
+#include <dbwrapper.h>
+#include <kernel/cs_main.h>
+#include <sync.h>
+#include <uint256.h>
+#include <validators/delegation.h>
+#include <validators/validatordb.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+class ChainstateManager;
+
+namespace validators {
+
+/**
+ * Prior state of everything a connected block changed in ValidatorDB and
+ * DelegationDB. Applying it restores the state as of the block's parent.
+ */
+class ValidatorBlockUndo {
+public:
+    uint256 blockHash;                                                // Block this undo data belongs to
+    std::vector<ValidatorEntry> validators;                           // Prior state of modified validators
+    std::vector<CKeyID> createdValidators;                            // Validators that did not exist before
+    std::vector<std::pair<uint256, DelegationEntry>> delegations;     // Prior state of modified delegations
+    std::vector<uint256> createdDelegations;                          // Delegations that did not exist before
+    std::vector<std::pair<CKeyID, ValidatorRewardPool>> rewardPools;  // Prior state of modified reward pools
+    std::vector<CKeyID> createdRewardPools;                           // Reward pools that did not exist before
+
+    SERIALIZE_METHODS(ValidatorBlockUndo, obj) {
+        READWRITE(obj.blockHash, obj.validators, obj.createdValidators,
+                  obj.delegations, obj.createdDelegations,
+                  obj.rewardPools, obj.createdRewardPools);
+    }
+
+    /**
+     * Build undo data from the journals taken at the end of a block
+     */
+    static ValidatorBlockUndo FromJournals(const uint256& blockHash,
+                                           const std::map<CKeyID, std::optional<ValidatorEntry>>& validatorJournal,
+                                           const DelegationChanges& delegationJournal);
+
+    /**
+     * Fold a more recent journal in; prior state already recorded here wins
+     */
+    void Merge(const std::map<CKeyID, std::optional<ValidatorEntry>>& validatorJournal,
+               const DelegationChanges& delegationJournal);
+
+    /**
+     * Convert back into journal form for ValidatorDB::Restore / DelegationDB::Restore
+     */
+    std::map<CKeyID, std::optional<ValidatorEntry>> GetValidatorChanges() const;
+    DelegationChanges GetDelegationChanges() const;
+};
+
+/**
+ * LevelDB-backed persistence for ValidatorDB and DelegationDB
+ *
+ * The in-memory databases remain authoritative. Every connected block seals
+ * their journals into a ValidatorBlockUndo record, and every chainstate flush
+ * writes the entries modified since the previous flush, the undo records of
+ * the blocks connected since then and the best block hash in one batch.
+ * Startup loads the entries directly instead of replaying the chain, and a
+ * reorg restores prior state from the undo records.
+ */
+class ValidatorStore {
+private:
+    CDBWrapper m_db;
+
+    mutable Mutex cs_store;
+
+    // Undo records of blocks connected since the last flush, by height
+    std::map<int, ValidatorBlockUndo> m_pending_undo GUARDED_BY(cs_store);
+
+    // Heights whose undo record on disk was consumed by a disconnect
+    std::set<int> m_erased_undo GUARDED_BY(cs_store);
+
+    uint256 m_best_block GUARDED_BY(cs_store);
+    int m_best_height GUARDED_BY(cs_store){-1};
+
+    // Highest height whose undo record has been pruned from disk
+    int m_pruned_height GUARDED_BY(cs_store){-1};
+
+    std::optional<ValidatorBlockUndo> ReadUndo(int height) const EXCLUSIVE_LOCKS_REQUIRED(cs_store);
+
+public:
+    explicit ValidatorStore(DBParams params);
+
+    /**
+     * Load all entries into the in-memory databases
+     */
+    bool Load(ValidatorDB& validatorDB, DelegationDB& delegationDB);
+
+    /**
+     * Best block the in-memory state corresponds to
+     */
+    uint256 GetBestBlock() const;
+
+    /**
+     * Bring the loaded state in line with the active chain; fails when the
+     * stored best block is unknown or cannot be rolled back
+     */
+    bool Sync(ValidatorDB& validatorDB, DelegationDB& delegationDB, ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * Apply per-block processing and seal the block's changes as undo data
+     */
+    void ConnectBlock(ValidatorDB& validatorDB, DelegationDB& delegationDB, const CBlockIndex& block);
+
+    /**
+     * Roll back everything changed since the parent of the given block
+     */
+    bool DisconnectBlock(ValidatorDB& validatorDB, DelegationDB& delegationDB, const CBlockIndex& block);
+
+    /**
+     * Write all modifications since the previous flush in one batch
+     */
+    bool Flush(ValidatorDB& validatorDB, DelegationDB& delegationDB);
+};
+
+// Number of blocks of undo data kept on disk
+static constexpr int VALIDATOR_UNDO_DEPTH = 5000;
+
+// LevelDB cache for the validator store
+static constexpr size_t VALIDATOR_STORE_CACHE_SIZE = 8 << 20;
+
+/**
+ * Global validator store instance
+ */
+extern std::unique_ptr<ValidatorStore> g_validator_store;
+
+/**
+ * Open the validator store and load its contents into g_validator_db and
+ * g_delegation_db, which must already be initialized
+ */
+bool InitValidatorStore(const fs::path& path);
+
+/**
+ * Bring the loaded state in line with the active chain after startup
+ */
+bool SyncValidatorStore(ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+/**
+ * Shutdown validator store
+ */
+void ShutdownValidatorStore();
+
+/**
+ * Block connect/disconnect and chainstate flush hooks
+ */
+void ConnectValidatorBlock(const CBlockIndex& block);
+bool DisconnectValidatorBlock(const CBlockIndex& block);
+bool FlushValidatorStore();
+
+} // namespace validators
+
+#endif // WATTX_VALIDATORS_VALIDATORSTORE_H
@@ -44,6 +44,7 @@ void StopStake(CWallet& wallet)
     {
         wallet.m_stop_staking_thread = true;
         wallet.m_enabled_staking = false;
+        wallet.NotifyStaker();
         StakeQtums(wallet, false);
         wallet.stakeThread = 0;
         wallet.m_stop_staking_thread = false;
@@ -673,35 +674,40 @@ void AvailableAddress(const CWallet& wallet, const std::vector<uint256> &matured
 
 bool SelectCoinsForStaking(const CWallet& wallet, CAmount &nTargetValue, std::set<std::pair<const CWalletTx *, unsigned int> > &setCoinsRet, CAmount &nValueRet)
 {
+    LOCK(wallet.cs_wallet);
     std::vector<std::pair<const CWalletTx *, unsigned int> > vCoins;
     vCoins.clear();
 
     bool isDescriptorWallet = wallet.IsWalletFlagSet(WALLET_FLAG_DESCRIPTORS);
     int nHeight = wallet.GetLastBlockHeight() + 1;
     int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
-    std::map<COutPoint, uint32_t> immatureStakes = wallet.chain().getImmatureStakes();
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> pImmatureStakes = wallet.chain().getImmatureStakes();
+    const std::map<COutPoint, uint32_t>& immatureStakes = *pImmatureStakes;
     std::vector<uint256> maturedTx;
     const bool include_watch_only = wallet.GetLegacyScriptPubKeyMan() && wallet.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
     const isminetype is_mine_filter = include_watch_only ? ISMINE_WATCH_ONLY : ISMINE_SPENDABLE;
-    for (auto it = wallet.mapWallet.begin(); it != wallet.mapWallet.end(); ++it)
+    // The candidates confirmed at this height or below have the staking maturity
+    for (const uint256& wtxid : wallet.GetStakeCandidates(nHeight - coinbaseMaturity))
     {
-        // Check the cached data for available coins for the tx
-        const CWalletTx* pcoin = &(*it).second;
-        const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, *pcoin, is_mine_filter | ISMINE_NO)};
-        if(tx_credit_mine == 0)
-            continue;
-
-        const uint256& wtxid = it->first;
-        int nDepth = wallet.GetTxDepthInMainChain(*pcoin);
-
-        if (nDepth < 1)
+        // Check the cached data for available coins for the tx, spent transactions are
+        // dropped from the candidates until their outputs are marked dirty again.
+        // Immature transactions have no available credit but stay candidates,
+        // maturing does not update the wallet transaction.
+        auto it = wallet.mapWallet.find(wtxid);
+        if(it == wallet.mapWallet.end())
+        {
+            wallet.EraseStakeCandidate(wtxid);
             continue;
+        }
 
-        if (nDepth < coinbaseMaturity)
+        if (wallet.GetTxBlocksToMaturity(it->second) > 0)
             continue;
 
-        if (wallet.GetTxBlocksToMaturity(*pcoin) > 0)
+        if(CachedTxGetAvailableCredit(wallet, it->second, is_mine_filter | ISMINE_NO) == 0)
+        {
+            wallet.EraseStakeCandidate(wtxid);
             continue;
+        }
 
         maturedTx.push_back(wtxid);
     }
@@ -819,7 +825,8 @@ bool SelectDelegateCoinsForStaking(const CWallet& wallet, std::vector<COutPoint>
         return false;
     }
 
-    std::map<COutPoint, uint32_t> immatureStakes = wallet.chain().getImmatureStakes();
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> pImmatureStakes = wallet.chain().getImmatureStakes();
+    const std::map<COutPoint, uint32_t>& immatureStakes = *pImmatureStakes;
     std::map<uint256, CSuperStakerInfo> mapStakers = wallet.mapSuperStaker;
 
     std::vector<uint160> delegations;
@@ -868,25 +875,29 @@ bool SelectDelegateCoinsForStaking(const CWallet& wallet, std::vector<COutPoint>
 
 void SelectAddress(const CWallet& wallet, std::map<uint160, bool> &mapAddress)
 {
+    LOCK(wallet.cs_wallet);
     std::vector<uint256> maturedTx;
     const bool include_watch_only = wallet.GetLegacyScriptPubKeyMan() && wallet.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
     const isminetype is_mine_filter = include_watch_only ? ISMINE_WATCH_ONLY : ISMINE_SPENDABLE;
-    for (auto it = wallet.mapWallet.begin(); it != wallet.mapWallet.end(); ++it)
+    for (const uint256& wtxid : wallet.GetStakeCandidates(wallet.GetLastBlockHeight()))
     {
-        // Check the cached data for available coins for the tx
-        const CWalletTx* pcoin = &(*it).second;
-        const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, *pcoin, is_mine_filter | ISMINE_NO)};
-        if(tx_credit_mine == 0)
+        // Check the cached data for available coins for the tx, immature
+        // transactions are skipped but kept as candidates
+        auto it = wallet.mapWallet.find(wtxid);
+        if(it == wallet.mapWallet.end())
+        {
+            wallet.EraseStakeCandidate(wtxid);
             continue;
+        }
 
-        const uint256& wtxid = it->first;
-        int nDepth = wallet.GetTxDepthInMainChain(*pcoin);
-
-        if (nDepth < 1)
+        if (wallet.GetTxBlocksToMaturity(it->second) > 0)
             continue;
 
-        if (wallet.GetTxBlocksToMaturity(*pcoin) > 0)
+        if(CachedTxGetAvailableCredit(wallet, it->second, is_mine_filter | ISMINE_NO) == 0)
+        {
+            wallet.EraseStakeCandidate(wtxid);
             continue;
+        }
 
         maturedTx.push_back(wtxid);
     }
@@ -947,24 +958,30 @@ uint64_t GetStakeWeight(const CWallet& wallet, uint64_t* pStakerWeight, uint64_t
     if(pStakerWeight) *pStakerWeight = nStakerWeight;
     if(pDelegateWeight) *pDelegateWeight = nDelegateWeight;
 
+    // Reuse the weight while the tip and the stake candidates are unchanged
+    LOCK(wallet.cs_wallet);
+    if(wallet.GetCachedStakeWeight(nStakerWeight, nDelegateWeight))
+    {
+        if(pStakerWeight) *pStakerWeight = nStakerWeight;
+        if(pDelegateWeight) *pDelegateWeight = nDelegateWeight;
+        return nStakerWeight + nDelegateWeight;
+    }
+
     // Choose coins to use
     const auto bal = GetBalance(wallet);
     CAmount nBalance = bal.m_mine_trusted;
     if(wallet.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS))
         nBalance += bal.m_watchonly_trusted;
 
-    if (nBalance <= wallet.m_reserve_balance)
-        return nWeight;
-
     std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
     CAmount nValueIn = 0;
 
     CAmount nTargetValue = nBalance - wallet.m_reserve_balance;
-    if (!SelectCoinsForStaking(wallet, nTargetValue, setCoins, nValueIn))
-        return nWeight;
-
-    if (setCoins.empty())
+    if (nBalance <= wallet.m_reserve_balance || !SelectCoinsForStaking(wallet, nTargetValue, setCoins, nValueIn) || setCoins.empty())
+    {
+        wallet.SetCachedStakeWeight(0, 0);
         return nWeight;
+    }
 
     int nHeight = wallet.GetLastBlockHeight() + 1;
     int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
@@ -1001,6 +1018,7 @@ uint64_t GetStakeWeight(const CWallet& wallet, uint64_t* pStakerWeight, uint64_t
     }
 
     nWeight = nStakerWeight + nDelegateWeight;
+    wallet.SetCachedStakeWeight(nStakerWeight, nDelegateWeight);
     if(pStakerWeight) *pStakerWeight = nStakerWeight;
     if(pDelegateWeight) *pDelegateWeight = nDelegateWeight;
 
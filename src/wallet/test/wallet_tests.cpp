@@ -5,11 +5,13 @@
 #include <wallet/wallet.h>
 
 #include <future>
+#include <limits>
 #include <memory>
 #include <stdint.h>
 #include <vector>
 
 #include <addresstype.h>
+#include <chainparams.h>
 #include <interfaces/chain.h>
 #include <key_io.h>
 #include <node/blockstorage.h>
@@ -26,6 +28,7 @@
 #include <wallet/context.h>
 #include <wallet/receive.h>
 #include <wallet/spend.h>
+#include <wallet/stake.h>
 #include <wallet/test/util.h>
 #include <wallet/test/wallet_test_fixture.h>
 
@@ -444,6 +447,95 @@ BOOST_AUTO_TEST_CASE(ComputeTimeSmart)
     BOOST_CHECK_EQUAL(AddTx(*m_node.chainman, m_wallet, 5, 50, 600), 300);
 }
 
+BOOST_AUTO_TEST_CASE(stake_candidates)
+{
+    LOCK(m_wallet.cs_wallet);
+    // The candidates are built from the wallet on first use
+    BOOST_CHECK(m_wallet.GetStakeCandidates(std::numeric_limits<int>::max()).empty());
+
+    auto add = [&](uint32_t lockTime, const TxState& state) {
+        CMutableTransaction tx;
+        tx.nLockTime = lockTime;
+        return m_wallet.AddToWallet(MakeTransactionRef(tx), state, [&](CWalletTx& wtx, bool /* new_tx */) {
+            wtx.m_state = state;
+            return true;
+        })->GetHash();
+    };
+    const uint256 low{add(1, TxStateConfirmed{m_rng.rand256(), 10, /*index=*/0, /*delegation=*/false})};
+    const uint256 high{add(2, TxStateConfirmed{m_rng.rand256(), 20, /*index=*/0, /*delegation=*/false})};
+    add(3, TxStateInactive{});
+
+    // Only confirmed transactions are bucketed by their height
+    BOOST_CHECK(m_wallet.GetStakeCandidates(9).empty());
+    BOOST_CHECK(m_wallet.GetStakeCandidates(10) == std::vector<uint256>{low});
+    BOOST_CHECK_EQUAL(m_wallet.GetStakeCandidates(20).size(), 2U);
+
+    // A dropped candidate comes back when the transaction is updated
+    m_wallet.EraseStakeCandidate(low);
+    BOOST_CHECK(m_wallet.GetStakeCandidates(20) == std::vector<uint256>{high});
+    add(1, TxStateConfirmed{m_rng.rand256(), 10, /*index=*/0, /*delegation=*/false});
+    BOOST_CHECK_EQUAL(m_wallet.GetStakeCandidates(20).size(), 2U);
+
+    // A transaction leaving the chain is no candidate anymore
+    add(2, TxStateInactive{});
+    BOOST_CHECK(m_wallet.GetStakeCandidates(20) == std::vector<uint256>{low});
+}
+
+BOOST_AUTO_TEST_CASE(stake_candidates_mature)
+{
+    LOCK(m_wallet.cs_wallet);
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const int maturity = std::max(consensusParams.nCoinbaseMaturity, consensusParams.nRBTCoinbaseMaturity);
+    m_wallet.SetLastBlockProcessed(100, m_rng.rand256());
+
+    // A coinstake confirmed at the tip
+    CMutableTransaction coinstake;
+    coinstake.vin.emplace_back(COutPoint(Txid::FromUint256(m_rng.rand256()), 0));
+    coinstake.vout.emplace_back(0, CScript());
+    coinstake.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    const TxStateConfirmed state{m_rng.rand256(), 100, /*index=*/1, /*delegation=*/false};
+    const uint256 hash = m_wallet.AddToWallet(MakeTransactionRef(coinstake), state, [&](CWalletTx& wtx, bool /* new_tx */) {
+        wtx.m_state = state;
+        return true;
+    })->GetHash();
+    BOOST_CHECK(m_wallet.mapWallet.at(hash).IsCoinStake());
+    BOOST_CHECK(m_wallet.IsTxImmature(m_wallet.mapWallet.at(hash)));
+
+    // Looking for staking addresses keeps the immature coinstake
+    std::map<uint160, bool> mapAddress;
+    SelectAddress(m_wallet, mapAddress);
+    BOOST_CHECK(m_wallet.GetStakeCandidates(100) == std::vector<uint256>{hash});
+
+    // It is still a candidate once it has matured
+    m_wallet.SetLastBlockProcessed(100 + maturity, m_rng.rand256());
+    BOOST_CHECK(!m_wallet.IsTxImmature(m_wallet.mapWallet.at(hash)));
+    BOOST_CHECK(m_wallet.GetStakeCandidates(100) == std::vector<uint256>{hash});
+}
+
+BOOST_AUTO_TEST_CASE(stake_weight_cache)
+{
+    LOCK(m_wallet.cs_wallet);
+    uint64_t stakerWeight{0}, delegateWeight{0};
+    m_wallet.SetCachedStakeWeight(1, 2);
+    BOOST_CHECK(m_wallet.GetCachedStakeWeight(stakerWeight, delegateWeight));
+    BOOST_CHECK_EQUAL(delegateWeight, 2U);
+
+    // A change of the delegated weight invalidates the delegate part
+    const uint160 delegate{m_rng.randbytes<unsigned char>(20)};
+    m_wallet.updateDelegationsWeight({{delegate, COIN}});
+    BOOST_CHECK(!m_wallet.GetCachedStakeWeight(stakerWeight, delegateWeight));
+    m_wallet.SetCachedStakeWeight(1, 2);
+    m_wallet.updateDelegationsWeight({{delegate, COIN}});
+    BOOST_CHECK(m_wallet.GetCachedStakeWeight(stakerWeight, delegateWeight));
+
+    // So does removing a super staker
+    CSuperStakerInfo superStaker;
+    superStaker.stakerAddress = uint160{m_rng.randbytes<unsigned char>(20)};
+    BOOST_REQUIRE(m_wallet.LoadSuperStaker(superStaker));
+    BOOST_REQUIRE(m_wallet.RemoveSuperStakerEntry(superStaker.GetHash()));
+    BOOST_CHECK(!m_wallet.GetCachedStakeWeight(stakerWeight, delegateWeight));
+}
+
 void TestLoadWallet(const std::string& name, DatabaseFormat format, std::function<void(std::shared_ptr<CWallet>)> f)
 {
     node::NodeContext node;
@@ -816,6 +816,11 @@ void CWallet::RemoveFromSpends(const COutPoint& outpoint, const uint256& wtxid)
             break;
         }
     }
+    auto prev = mapWallet.find(outpoint.hash);
+    if(prev != mapWallet.end())
+    {
+        UpdateStakeCandidate(prev->second);
+    }
     range = mapTxSpends.equal_range(outpoint);
     if(range.first != range.second)
         SyncMetaData(range);
@@ -1173,6 +1178,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
             desc_tx->m_state = inactive_state;
             // Break caches since we have changed the state
             desc_tx->MarkDirty();
+            UpdateStakeCandidate(*desc_tx);
             batch.WriteTx(*desc_tx);
             MarkInputsDirty(desc_tx->tx);
             for (unsigned int i = 0; i < desc_tx->tx->vout.size(); ++i) {
@@ -1225,6 +1231,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    UpdateStakeCandidate(wtx);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1371,6 +1378,8 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
             it->second.MarkDirty();
+            // The outputs may be available again, let the staker check them
+            UpdateStakeCandidate(it->second);
         }
     }
 }
@@ -1468,6 +1477,7 @@ void CWallet::RecursiveUpdateTxState(WalletBatch* batch, const uint256& tx_hash,
         TxUpdate update_state = try_updating_state(wtx);
         if (update_state != TxUpdate::UNCHANGED) {
             wtx.MarkDirty();
+            UpdateStakeCandidate(wtx);
             if (batch) batch->WriteTx(wtx);
             // Iterate over all its outputs, and update those tx states as well (if applicable)
             for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
@@ -1520,6 +1530,8 @@ void CWallet::transactionAddedToMempool(const CTransactionRef& tx) {
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        // The transaction may spend coins the staker selected
+        NotifyStaker(true);
     }
 
     const Txid& txid = tx->GetHash();
@@ -1542,6 +1554,8 @@ void CWallet::transactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRe
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        // Coins spent by an evicted transaction can be staked again
+        if (reason != MemPoolRemovalReason::BLOCK) NotifyStaker(true);
     }
     // Handle transactions that were removed from the mempool because they
     // conflict with transactions in a newly connected block.
@@ -1663,6 +1677,7 @@ void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
 void CWallet::updatedBlockTip()
 {
     m_best_block_time = GetTime();
+    NotifyStaker();
 }
 
 void CWallet::BlockUntilSyncedToCurrentChain() const {
@@ -2743,6 +2758,8 @@ util::Result<void> CWallet::RemoveTxs(WalletBatch& batch, std::vector<uint256>&
             wtxOrdered.erase(it->second.m_it_wtxOrdered);
             for (const auto& txin : it->second.tx->vin)
                 mapTxSpends.erase(txin.prevout);
+            EraseStakeCandidate(hash);
+            MarkInputsDirty(it->second.tx);
             mapWallet.erase(it);
             NotifyTransactionChanged(hash, CT_DELETED);
         }
@@ -3054,6 +3071,7 @@ bool CWallet::LockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     setLockedCoins.insert(output);
+    ++m_stake_candidates_version;
     if (batch) {
         return batch->WriteLockedUTXO(output);
     }
@@ -3064,6 +3082,7 @@ bool CWallet::UnlockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     bool was_locked = setLockedCoins.erase(output);
+    if (was_locked) ++m_stake_candidates_version;
     if (batch && was_locked) {
         return batch->EraseLockedUTXO(output);
     }
@@ -3079,6 +3098,7 @@ bool CWallet::UnlockAllCoins()
         success &= batch.EraseLockedUTXO(*it);
     }
     setLockedCoins.clear();
+    ++m_stake_candidates_version;
     return success;
 }
 
@@ -5479,6 +5499,7 @@ bool CWallet::AddSuperStakerEntry(const CSuperStakerInfo& superStaker, bool fFlu
         return false;
 
     mapSuperStaker[hash] = wsuperStaker;
+    ++m_stake_candidates_version;
 
     NotifySuperStakerChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -5515,6 +5536,7 @@ bool CWallet::RemoveSuperStakerEntry(const uint256& superStakerHash, bool fFlush
             return false;
 
         mapSuperStaker.erase(it);
+        ++m_stake_candidates_version;
 
         NotifySuperStakerChanged(this, superStakerHash, CT_DELETED);
     }
@@ -5545,6 +5567,24 @@ bool CWallet::IsStakeClosing()
     return m_stop_staking_thread;
 }
 
+void CWallet::NotifyStaker(bool fCoinsChanged)
+{
+    if(fCoinsChanged) m_staker_coins_changed = true;
+    WITH_LOCK(m_staker_mutex, m_staker_notified = true);
+    m_staker_cv.notify_all();
+}
+
+bool CWallet::WaitStakerNotification(std::chrono::milliseconds timeout)
+{
+    WAIT_LOCK(m_staker_mutex, lock);
+    m_staker_cv.wait_for(lock, timeout, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_staker_mutex) {
+        return m_staker_notified || IsStakeClosing();
+    });
+    bool notified = m_staker_notified;
+    m_staker_notified = false;
+    return notified;
+}
+
 void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &delegations_staker)
 {
     LOCK(cs_wallet);
@@ -5558,6 +5598,7 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
         {
             it = m_delegations_staker.erase(it);
             m_delegations_weight.erase(addressDelegate);
+            ++m_stake_candidates_version;
             NotifyDelegationsStakerChanged(this, addressDelegate, CT_DELETED);
         }
         else
@@ -5565,6 +5606,7 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
             if(delegation->second != it->second)
             {
                 it->second = delegation->second;
+                ++m_stake_candidates_version;
                 NotifyDelegationsStakerChanged(this, addressDelegate, CT_UPDATED);
             }
             it++;
@@ -5577,6 +5619,7 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
         if(m_delegations_staker.find(it->first) == m_delegations_staker.end())
         {
             m_delegations_staker[it->first] = it->second;
+            ++m_stake_candidates_version;
             NotifyDelegationsStakerChanged(this, it->first, CT_NEW);
         }
     }
@@ -5601,6 +5644,7 @@ void CWallet::updateDelegationsWeight(const std::map<uint160, CAmount>& delegati
         }
 
         m_delegations_weight[delegate] = weight;
+        if(updated) ++m_stake_candidates_version;
 
         if(updated && m_delegations_staker.find(delegate) != m_delegations_staker.end())
         {
@@ -5665,7 +5709,8 @@ void CWallet::GetStakerAddressBalance(const PKHash &staker, CAmount &balance, CA
     weight = 0;
     int nHeight = GetLastBlockHeight() + 1;
     int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
-    std::map<COutPoint, uint32_t> immatureStakes = chain().getImmatureStakes();
+    std::shared_ptr<const std::map<COutPoint, uint32_t>> pImmatureStakes = chain().getImmatureStakes();
+    const std::map<COutPoint, uint32_t>& immatureStakes = *pImmatureStakes;
     for (auto& entry : mapWallet)
     {
         const uint256& wtxid = entry.first;
@@ -5729,6 +5774,84 @@ void CWallet::updateHaveCoinSuperStaker(const std::set<std::pair<const CWalletTx
     }
 }
 
+void CWallet::UpdateStakeCandidate(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    // The candidates are built on the first staking pass
+    if(!m_stake_candidates_loaded)
+        return;
+
+    EraseStakeCandidate(wtx.GetHash());
+    if(auto* conf = wtx.state<TxStateConfirmed>())
+    {
+        m_stake_candidates[conf->confirmed_block_height].insert(wtx.GetHash());
+        m_stake_candidate_heights[wtx.GetHash()] = conf->confirmed_block_height;
+    }
+}
+
+void CWallet::EraseStakeCandidate(const uint256& wtxid) const
+{
+    AssertLockHeld(cs_wallet);
+    ++m_stake_candidates_version;
+    auto it = m_stake_candidate_heights.find(wtxid);
+    if(it == m_stake_candidate_heights.end())
+        return;
+
+    auto bucket = m_stake_candidates.find(it->second);
+    if(bucket != m_stake_candidates.end())
+    {
+        bucket->second.erase(wtxid);
+        if(bucket->second.empty())
+            m_stake_candidates.erase(bucket);
+    }
+    m_stake_candidate_heights.erase(it);
+}
+
+std::vector<uint256> CWallet::GetStakeCandidates(int nMaxHeight) const
+{
+    AssertLockHeld(cs_wallet);
+    if(!m_stake_candidates_loaded)
+    {
+        m_stake_candidates.clear();
+        m_stake_candidate_heights.clear();
+        for(const auto& [wtxid, wtx] : mapWallet)
+        {
+            if(auto* conf = wtx.state<TxStateConfirmed>())
+            {
+                m_stake_candidates[conf->confirmed_block_height].insert(wtxid);
+                m_stake_candidate_heights[wtxid] = conf->confirmed_block_height;
+            }
+        }
+        m_stake_candidates_loaded = true;
+        ++m_stake_candidates_version;
+    }
+
+    std::vector<uint256> candidates;
+    for(auto it = m_stake_candidates.begin(); it != m_stake_candidates.end() && it->first <= nMaxHeight; ++it)
+    {
+        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    }
+    return candidates;
+}
+
+bool CWallet::GetCachedStakeWeight(uint64_t& nStakerWeight, uint64_t& nDelegateWeight) const
+{
+    AssertLockHeld(cs_wallet);
+    if(!m_stake_weight_cache || m_stake_weight_cache->tip != GetLastBlockHash() ||
+       m_stake_weight_cache->version != m_stake_candidates_version || m_stake_weight_cache->reserve != m_reserve_balance)
+        return false;
+
+    nStakerWeight = m_stake_weight_cache->staker;
+    nDelegateWeight = m_stake_weight_cache->delegate;
+    return true;
+}
+
+void CWallet::SetCachedStakeWeight(uint64_t nStakerWeight, uint64_t nDelegateWeight) const
+{
+    AssertLockHeld(cs_wallet);
+    m_stake_weight_cache = StakeWeightCache{GetLastBlockHash(), m_stake_candidates_version, m_reserve_balance, nStakerWeight, nDelegateWeight};
+}
+
 void CWallet::CleanCoinStake()
 {
     LOCK(cs_wallet);
@@ -39,6 +39,8 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -836,6 +838,11 @@ public:
     int32_t m_staker_max_utxo_script_cache{DEFAULT_STAKER_MAX_UTXO_SCRIPT_CACHE};
     uint8_t m_staking_min_fee{DEFAULT_STAKING_MIN_FEE};
     std::atomic<bool> m_stop_staking_thread{false};
+    //! Set when the coins of the wallet changed since the staker selected its coins
+    std::atomic<bool> m_staker_coins_changed{false};
+    Mutex m_staker_mutex;
+    std::condition_variable m_staker_cv;
+    bool m_staker_notified GUARDED_BY(m_staker_mutex){false};
     std::atomic<bool> m_is_staking_thread_stopped{false};
 
     size_t KeypoolCountExternalKeys() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -1258,6 +1265,12 @@ public:
     /* Is staking closing */
     bool IsStakeClosing();
 
+    /* Wake up the staker when the chain tip or the coins of the wallet changed */
+    void NotifyStaker(bool fCoinsChanged = false);
+
+    /* Wait until the staker is notified, staking is closing or the timeout passed; true when notified */
+    bool WaitStakerNotification(std::chrono::milliseconds timeout);
+
     /* Clean coinstake transactions */
     void CleanCoinStake();
 
@@ -1268,6 +1281,16 @@ public:
     void updateDelegationsWeight(const std::map<uint160, CAmount>& delegations_weight);
     void updateHaveCoinSuperStaker(const std::set<std::pair<const CWalletTx*,unsigned int> >& setCoins);
 
+    /** Add a transaction to the stake candidates when it is confirmed, remove it otherwise */
+    void UpdateStakeCandidate(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /** Remove a transaction from the stake candidates until it is updated again */
+    void EraseStakeCandidate(const uint256& wtxid) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /** Stake candidates confirmed at or below nMaxHeight */
+    std::vector<uint256> GetStakeCandidates(int nMaxHeight) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /** Stake weight computed for the current tip if nothing it depends on changed since, see m_stake_candidates_version */
+    bool GetCachedStakeWeight(uint64_t& nStakerWeight, uint64_t& nDelegateWeight) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void SetCachedStakeWeight(uint64_t nStakerWeight, uint64_t nDelegateWeight) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     std::map<uint160, Delegation> m_delegations_staker;
     std::map<uint160, CAmount> m_delegations_weight;
     std::map<uint160, Delegation> m_my_delegations;
@@ -1281,6 +1304,24 @@ public:
     bool fHasMinerStakeCache = false;
     mutable std::map<COutPoint, CScriptCache> prevoutScriptCache;
     mutable std::map<uint160, bool> addressStakeCache;
+
+    //! Confirmed transactions that may hold stakeable outputs, bucketed by the height of their block.
+    //! Spent transactions are dropped by the staker and added back when their inputs are marked dirty.
+    mutable std::map<int, std::set<uint256>> m_stake_candidates GUARDED_BY(cs_wallet);
+    mutable std::map<uint256, int> m_stake_candidate_heights GUARDED_BY(cs_wallet);
+    mutable bool m_stake_candidates_loaded GUARDED_BY(cs_wallet){false};
+    //! Bumped on every change of the stake candidates, the locked coins, the super staker
+    //! entries or the delegations to this staker, which the cached stake weight depends on
+    mutable uint64_t m_stake_candidates_version GUARDED_BY(cs_wallet){0};
+
+    struct StakeWeightCache {
+        uint256 tip;
+        uint64_t version{0};
+        CAmount reserve{0};
+        uint64_t staker{0};
+        uint64_t delegate{0};
+    };
+    mutable std::optional<StakeWeightCache> m_stake_weight_cache GUARDED_BY(cs_wallet);
     std::atomic<bool> fCleanCoinStake = true;
 };
 